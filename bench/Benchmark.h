@@ -0,0 +1,185 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+/*
+ * Tiny benchmark harness shared by the benchmarks in bench/
+ * - The process is pinned to one core so the scheduler doesn't move it in the middle of a measurement
+ * - Each benchmark is run a few times untimed (warmup) to fill the caches and the branch predictors
+ * - Then it is run `repetitions` times. Every run is timed separately and divided by the number of operations of the run
+ * - The median and the 99th percentile of the runs are reported as JSON, so a script can compare 2 results
+ */
+struct BenchmarkResult
+{
+    std::string name;
+    uint64_t opsPerRun;
+    uint32_t repetitions;
+    double median; // nanoseconds per operation
+    double p99;
+    double min;
+    double mean;
+};
+
+class Benchmark
+{
+    public:
+        Benchmark()
+        {
+            warmup = 3;
+            repetitions = 30;
+            core = -1;
+        }
+
+        // Parse: -r <repetitions> -w <warmup> -c <core> -f <name filter> -o <output file>
+        bool ParseArguments(int argc, char **argv)
+        {
+            for (int i = 1; i < argc; ++i)
+            {
+                if ((i + 1 >= argc) || (argv[i][0] != '-'))
+                {
+                    fprintf(stderr, "Usage: %s [-r repetitions] [-w warmup] [-c core] [-f filter] [-o output.json]\n", argv[0]);
+                    return false;
+                }
+                const char *value = argv[++i];
+                switch (argv[i - 1][1])
+                {
+                    case 'r': repetitions = std::max(1, atoi(value)); break;
+                    case 'w': warmup = std::max(0, atoi(value)); break;
+                    case 'c': core = atoi(value); break;
+                    case 'f': filter = value; break;
+                    case 'o': outputFile = value; break;
+                    default:
+                        fprintf(stderr, "Unknown option %s\n", argv[i - 1]);
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        // Pin the process to `core`. By default the last core is used, it is usually the least busy one
+        void PinCore(int core)
+        {
+            this->core = core;
+            PinCore();
+        }
+
+        void PinCore()
+        {
+            if (core < 0)
+            {
+                core = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+            }
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(core, &set);
+            if (sched_setaffinity(0, sizeof(set), &set) != 0)
+            {
+                fprintf(stderr, "Can't pin the benchmark to core %d\n", core);
+                core = -1;
+            }
+        }
+
+        bool IsSelected(const char *name)
+        {
+            return filter.empty() || (strstr(name, filter.c_str()) != NULL);
+        }
+
+        /*
+         * Run `body` (warmup + repetitions) times. `body` does opsPerRun operations, `setup` is called untimed before each run
+         */
+        template<class Setup, class Body>
+        void Run(const char *name, uint64_t opsPerRun, Setup setup, Body body)
+        {
+            if (!IsSelected(name))
+            {
+                return;
+            }
+            for (uint32_t i = 0; i < warmup; ++i)
+            {
+                setup();
+                body();
+            }
+            std::vector<double> samples;
+            for (uint32_t i = 0; i < repetitions; ++i)
+            {
+                setup();
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                body();
+                std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+                samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / opsPerRun);
+            }
+            std::sort(samples.begin(), samples.end());
+            BenchmarkResult result;
+            result.name = name;
+            result.opsPerRun = opsPerRun;
+            result.repetitions = repetitions;
+            result.median = samples[samples.size() / 2];
+            result.p99 = samples[std::min(samples.size() - 1, (samples.size() * 99) / 100)];
+            result.min = samples[0];
+            result.mean = 0;
+            for (size_t i = 0; i < samples.size(); ++i)
+            {
+                result.mean += samples[i] / samples.size();
+            }
+            fprintf(stderr, "%-32s median %10.2f ns  p99 %10.2f ns\n", name, result.median, result.p99);
+            results.push_back(result);
+        }
+
+        template<class Body>
+        void Run(const char *name, uint64_t opsPerRun, Body body)
+        {
+            Run(name, opsPerRun, [](){}, body);
+        }
+
+        // Write the results to the output file (stdout by default)
+        bool WriteJSON(const char *suite)
+        {
+            FILE *file = outputFile.empty() ? stdout : fopen(outputFile.c_str(), "w");
+            if (file == NULL)
+            {
+                fprintf(stderr, "Can't open %s\n", outputFile.c_str());
+                return false;
+            }
+            fprintf(file, "{\n  \"suite\": \"%s\",\n  \"core\": %d,\n  \"warmup\": %u,\n  \"benchmarks\": [\n", suite, core, warmup);
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                const BenchmarkResult &result = results[i];
+                fprintf(file, "    {\"name\": \"%s\", \"unit\": \"ns/op\", \"ops_per_run\": %llu, \"repetitions\": %u, "
+                        "\"median\": %.3f, \"p99\": %.3f, \"min\": %.3f, \"mean\": %.3f}%s\n",
+                        result.name.c_str(), (unsigned long long)result.opsPerRun, result.repetitions,
+                        result.median, result.p99, result.min, result.mean, (i + 1 < results.size()) ? "," : "");
+            }
+            fprintf(file, "  ]\n}\n");
+            if (file != stdout)
+            {
+                fclose(file);
+            }
+            return true;
+        }
+
+    private:
+        uint32_t warmup;
+        uint32_t repetitions;
+        int core;
+        std::string filter;
+        std::string outputFile;
+        std::vector<BenchmarkResult> results;
+};
+
+// Keep the compiler from removing a computation whose result is never used
+template<class T>
+inline void DoNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#endif //_BENCHMARK_H_
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <time.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define private public
+#define protected public
+
+#include "Console.h"
+#include "Platforms.h"
+#include "Ticks.h"
+#include "Palette.h"
+#include "Benchmark.h"
+
+/*
+ * End-to-end benchmark: boot the bundled ROMs headless and run a fixed number of frames with a scripted input
+ * For each ROM it reports
+ * - Emulated frames per second and host nanoseconds per emulated CPU cycle (from an uninstrumented run)
+ * - The time split between CPU, PPU, bus (CPU/PPU memory accesses) and present (frame buffer -> RGB) from a second,
+ *   instrumented run. The instrumentation has its own cost so only the ratios are meaningful
+ * The results of a run are appended as one JSON line to the output file so runs can be compared over time
+ * Usage: ./fps [-n frames] [-c core] [-f filter] [-o history.jsonl]
+ */
+
+#define DEFAULT_FRAMES 300
+
+static const char *romFiles[] =
+{
+    "../../rom/Mario.nes",
+    "../../rom/Contra.nes",
+    "../../test/ppu/sprite0hit/01.basics.nes",
+    "../../test/ppu/sprite0hit/02.alignment.nes",
+    "../../test/ppu/sprite0hit/03.corners.nes",
+    "../../test/ppu/sprite0hit/04.flip.nes",
+    "../../test/ppu/sprite0hit/05.left_clip.nes",
+    "../../test/ppu/sprite0hit/06.right_edge.nes",
+    "../../test/ppu/sprite0hit/07.screen_bottom.nes",
+    "../../test/ppu/sprite0hit/08.double_height.nes",
+    "../../test/ppu/sprite0hit/09.timing_basics.nes",
+    "../../test/ppu/sprite0hit/10.timing_order.nes",
+    "../../test/ppu/sprite0hit/11.edge_timing.nes",
+};
+
+struct Result
+{
+    std::string rom;
+    double framesPerSecond;
+    double nsPerCycle;
+    // Percentage of the instrumented run
+    double cpu;
+    double ppu;
+    double bus;
+    double present;
+};
+
+/*
+ * Scripted input, the same for every ROM: press Start twice to leave the title screen,
+ * then walk right and jump every 40 frames
+ */
+void ApplyInput(Controller *controller, uint32_t frame)
+{
+    controller->SetButton(ButtonStart, ((frame >= 30) && (frame < 35)) || ((frame >= 90) && (frame < 95)));
+    controller->SetButton(ButtonRight, frame >= 120);
+    controller->SetButton(ButtonA, (frame >= 120) && ((frame % 40) < 10));
+}
+
+// Headless version of UpdateTexture in main.cpp
+uint8_t screenData[SCREEN_HEIGHT][SCREEN_WIDTH][3];
+
+void Present(PPU *ppu)
+{
+    for (int y = 0; y < SCREEN_HEIGHT; ++y)
+    {
+        for (int x = 0; x < SCREEN_WIDTH; ++x)
+        {
+            uint32_t color = palette[ppu->frontBuffer[y][x]];
+            screenData[y][x][0] = uint8_t(color >> 16);
+            screenData[y][x][1] = uint8_t(color >> 8);
+            screenData[y][x][2] = uint8_t(color);
+        }
+    }
+    DoNotOptimize(screenData);
+}
+
+// Forward the accesses to the real memory and count the time spent in it
+class TimedMemory : public Memory
+{
+    public:
+        TimedMemory(Memory *memory)
+        {
+            this->memory = memory;
+            ticks = 0;
+        }
+        uint8_t Read(uint16_t address)
+        {
+            uint64_t start = ReadTicks();
+            uint8_t value = memory->Read(address);
+            ticks += ReadTicks() - start;
+            return value;
+        }
+        void Write(uint16_t address, uint8_t value)
+        {
+            uint64_t start = ReadTicks();
+            memory->Write(address, value);
+            ticks += ReadTicks() - start;
+        }
+        Memory *memory;
+        uint64_t ticks;
+};
+
+bool RunPlain(const char *fileName, uint32_t frames, Result &result)
+{
+    Console console;
+    if (!console.LoadNESFile(fileName))
+    {
+        return false;
+    }
+    uint64_t cpuCycles = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; ++frame)
+    {
+        ApplyInput(console.GetController(), frame);
+        uint32_t frameCount = console.GetPPU()->GetFrameCount();
+        while (frameCount == console.GetPPU()->GetFrameCount())
+        {
+            cpuCycles += console.Step();
+        }
+        Present(console.GetPPU());
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    result.framesPerSecond = frames * 1e9 / ns;
+    result.nsPerCycle = ns / cpuCycles;
+    return true;
+}
+
+bool RunInstrumented(const char *fileName, uint32_t frames, Result &result)
+{
+    Console console;
+    if (!console.LoadNESFile(fileName))
+    {
+        return false;
+    }
+    CPU *cpu = console.cpu;
+    PPU *ppu = console.ppu;
+    TimedMemory memoryCPU(cpu->cpuMemory);
+    TimedMemory memoryPPU(ppu->vram);
+    cpu->cpuMemory = &memoryCPU;
+    ppu->vram = &memoryPPU;
+    uint64_t cpuTicks = 0;
+    uint64_t ppuTicks = 0;
+    uint64_t presentTicks = 0;
+    for (uint32_t frame = 0; frame < frames; ++frame)
+    {
+        ApplyInput(console.GetController(), frame);
+        uint32_t frameCount = ppu->GetFrameCount();
+        while (frameCount == ppu->GetFrameCount())
+        {
+            uint64_t start = ReadTicks();
+            uint16_t ppuCycles = cpu->Step() * 3;
+            uint64_t middle = ReadTicks();
+            for (uint16_t i = 0; i < ppuCycles; ++i)
+            {
+                ppu->Step();
+            }
+            uint64_t end = ReadTicks();
+            cpuTicks += middle - start;
+            ppuTicks += end - middle;
+        }
+        uint64_t start = ReadTicks();
+        Present(ppu);
+        presentTicks += ReadTicks() - start;
+    }
+    // The CPU writes to the PPU registers through its bus, the time is counted as bus time
+    double total = cpuTicks + ppuTicks + presentTicks;
+    result.bus = 100.0 * (memoryCPU.ticks + memoryPPU.ticks) / total;
+    result.cpu = 100.0 * (cpuTicks - std::min(cpuTicks, memoryCPU.ticks)) / total;
+    result.ppu = 100.0 * (ppuTicks - std::min(ppuTicks, memoryPPU.ticks)) / total;
+    result.present = 100.0 * presentTicks / total;
+    // Put the real memories back before the console deletes them
+    cpu->cpuMemory = memoryCPU.memory;
+    ppu->vram = memoryPPU.memory;
+    return true;
+}
+
+std::string GetCommit()
+{
+    std::string commit = "unknown";
+    FILE *pipe = popen("git rev-parse --short HEAD 2>/dev/null", "r");
+    if (pipe != NULL)
+    {
+        char buffer[64];
+        if (fgets(buffer, sizeof(buffer), pipe) != NULL)
+        {
+            commit = buffer;
+            commit.erase(commit.find_last_not_of("\r\n") + 1);
+        }
+        pclose(pipe);
+    }
+    return commit;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = DEFAULT_FRAMES;
+    int core = -1;
+    const char *filter = NULL;
+    const char *outputFile = NULL;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        switch (argv[i][1])
+        {
+            case 'n': frames = atoi(argv[i + 1]); break;
+            case 'c': core = atoi(argv[i + 1]); break;
+            case 'f': filter = argv[i + 1]; break;
+            case 'o': outputFile = argv[i + 1]; break;
+        }
+    }
+    Benchmark benchmark;
+    benchmark.PinCore(core);
+    std::vector<Result> results;
+    for (size_t i = 0; i < sizeof(romFiles) / sizeof(romFiles[0]); ++i)
+    {
+        if ((filter != NULL) && (strstr(romFiles[i], filter) == NULL))
+        {
+            continue;
+        }
+        Result result;
+        result.rom = romFiles[i];
+        result.rom = result.rom.substr(result.rom.find_last_of('/') + 1);
+        if (!RunPlain(romFiles[i], frames, result) || !RunInstrumented(romFiles[i], frames, result))
+        {
+            LOGI("Can't run %s", romFiles[i]);
+            return 1;
+        }
+        fprintf(stderr, "%-24s %8.1f fps %6.2f ns/cycle  cpu %5.1f%%  ppu %5.1f%%  bus %5.1f%%  present %5.1f%%\n",
+                result.rom.c_str(), result.framesPerSecond, result.nsPerCycle, result.cpu, result.ppu, result.bus, result.present);
+        results.push_back(result);
+    }
+    // One JSON line per run
+    FILE *file = (outputFile == NULL) ? stdout : fopen(outputFile, "a");
+    if (file == NULL)
+    {
+        LOGI("Can't open %s", outputFile);
+        return 1;
+    }
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    fprintf(file, "{\"date\": \"%s\", \"commit\": \"%s\", \"frames\": %u, \"roms\": [", date, GetCommit().c_str(), frames);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &result = results[i];
+        fprintf(file, "%s{\"rom\": \"%s\", \"fps\": %.2f, \"ns_per_cycle\": %.3f, "
+                "\"split\": {\"cpu\": %.1f, \"ppu\": %.1f, \"bus\": %.1f, \"present\": %.1f}}",
+                (i > 0) ? ", " : "", result.rom.c_str(), result.framesPerSecond, result.nsPerCycle,
+                result.cpu, result.ppu, result.bus, result.present);
+    }
+    fprintf(file, "]}\n");
+    if (file != stdout)
+    {
+        fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <fstream>
+#include <vector>
+
+#define private public
+#define protected public
+
+#include "PPU.h"
+#include "Cartridge.h"
+#include "Platforms.h"
+#include "Mapper.h"
+#include "MapperRegistry.h"
+#include "MemoryCPU.h"
+#include "MemoryPPU.h"
+#include "CPU.h"
+#include "Controller.h"
+#include "Benchmark.h"
+
+/*
+ * Microbenchmarks of the hot paths of the emulator:
+ * - CPU::Step on synthetic opcode mixes and on the full nestest.nes run
+ * - PPU::Step for a whole frame with the rendering on and off
+ * - MemoryCPU Read/Write by address region
+ * - MemoryPPU nametable/palette accesses
+ * Usage: ./micro [-r repetitions] [-w warmup] [-c core] [-f filter] [-o output.json]
+ */
+
+#define NESTEST_FILE "../../test/cpu/nestest/nestest.nes"
+#define MARIO_FILE "../../rom/Mario.nes"
+#define PROGRAM_FILE "program.nes"
+// Number of instructions in nestest.log
+#define NESTEST_STEPS 8991
+#define CPU_STEPS 100000
+#define MEMORY_ACCESSES 100000
+#define PPU_CYCLES_PER_FRAME (341 * 262)
+
+struct System
+{
+    Cartridge *cartridge;
+    Mapper *mapper;
+    Memory *memoryPPU;
+    PPU *ppu;
+    Memory *memoryCPU;
+    CPU *cpu;
+    Controller *controller;
+
+    System()
+    {
+        cartridge = NULL;
+        mapper = NULL;
+        memoryPPU = NULL;
+        ppu = NULL;
+        memoryCPU = NULL;
+        cpu = NULL;
+        controller = NULL;
+    }
+
+    ~System()
+    {
+        SAFE_DEL(cpu);
+        SAFE_DEL(memoryCPU);
+        SAFE_DEL(ppu);
+        SAFE_DEL(memoryPPU);
+        SAFE_DEL(mapper);
+        SAFE_DEL(cartridge);
+        SAFE_DEL(controller);
+    }
+
+    bool Load(const char *fileName)
+    {
+        cartridge = new Cartridge();
+        if (!cartridge->LoadNESFile(fileName))
+        {
+            return false;
+        }
+        mapper = Mapper::GetMapper(cartridge);
+        if (mapper == NULL)
+        {
+            return false;
+        }
+        memoryPPU = MapperRegistry::CreateMemoryPPU(cartridge->GetMapperNumber());
+        memoryPPU->SetMapper(mapper);
+        ppu = new PPU(memoryPPU);
+        memoryCPU = MapperRegistry::CreateMemoryCPU(cartridge->GetMapperNumber());
+        memoryCPU->SetMapper(mapper);
+        memoryCPU->SetPPU(ppu);
+        controller = new Controller();
+        memoryCPU->SetController(controller);
+        cpu = new CPU(memoryCPU);
+        ppu->SetCPU(cpu);
+        return true;
+    }
+
+    void StepFrames(uint32_t frames)
+    {
+        for (uint32_t cycles = 0; cycles < frames * PPU_CYCLES_PER_FRAME / 3;)
+        {
+            uint8_t cpuCycles = cpu->Step();
+            for (uint16_t i = 0; i < cpuCycles * 3; ++i)
+            {
+                ppu->Step();
+            }
+            cycles += cpuCycles;
+        }
+    }
+};
+
+/*
+ * Synthetic opcode mixes. Each program is an endless loop at $8000
+ */
+struct OpcodeMix
+{
+    const char *name;
+    std::vector<uint8_t> program;
+};
+
+static const OpcodeMix opcodeMixes[] =
+{
+    // Register and immediate ALU instructions
+    {"cpu_step_alu", {
+        0xA9, 0x01,         // LDA #$01
+        0x69, 0x03,         // ADC #$03
+        0x29, 0x7F,         // AND #$7F
+        0x49, 0x55,         // EOR #$55
+        0x0A,               // ASL A
+        0xE8,               // INX
+        0x88,               // DEY
+        0xC9, 0x10,         // CMP #$10
+        0xAA,               // TAX
+        0x4C, 0x00, 0x80}}, // JMP $8000
+    // Loads/stores to RAM and PRG-ROM with the common address modes
+    {"cpu_step_memory", {
+        0xA5, 0x10,         // LDA $10
+        0x85, 0x11,         // STA $11
+        0xAD, 0x00, 0x02,   // LDA $0200
+        0x8D, 0x01, 0x02,   // STA $0201
+        0xB1, 0x20,         // LDA ($20),Y
+        0x91, 0x22,         // STA ($22),Y
+        0xBD, 0x00, 0x80,   // LDA $8000,X
+        0xE6, 0x12,         // INC $12
+        0x4C, 0x00, 0x80}}, // JMP $8000
+    // Branches, subroutine calls and stack
+    {"cpu_step_branch", {
+        0xA2, 0x08,         // LDX #$08
+        0xCA,               // DEX
+        0xD0, 0xFD,         // BNE -3
+        0x20, 0x0E, 0x80,   // JSR $800E
+        0x48,               // PHA
+        0x68,               // PLA
+        0x4C, 0x00, 0x80,   // JMP $8000
+        0xEA,               // NOP (padding)
+        0x60}},             // RTS ($800E)
+};
+
+bool WriteProgram(const std::vector<uint8_t> &program)
+{
+    // NROM: 16KB PRG-ROM mirrored at $C000, 8KB CHR-ROM
+    std::vector<uint8_t> data(16 + 0x4000 + 0x2000, 0);
+    data[0] = 'N';
+    data[1] = 'E';
+    data[2] = 'S';
+    data[3] = 0x1A;
+    data[4] = 1;
+    data[5] = 1;
+    std::copy(program.begin(), program.end(), data.begin() + 16);
+    // Reset vector: $8000
+    data[16 + 0x3FFC] = 0x00;
+    data[16 + 0x3FFD] = 0x80;
+    std::ofstream os(PROGRAM_FILE, std::ofstream::binary);
+    os.write(reinterpret_cast<char *>(&data[0]), data.size());
+    return os.good();
+}
+
+void BenchmarkCPU(Benchmark &benchmark)
+{
+    for (size_t i = 0; i < sizeof(opcodeMixes) / sizeof(opcodeMixes[0]); ++i)
+    {
+        System system;
+        bool isLoaded = WriteProgram(opcodeMixes[i].program) && system.Load(PROGRAM_FILE);
+        remove(PROGRAM_FILE);
+        if (!isLoaded)
+        {
+            LOGI("Can't load the program of %s", opcodeMixes[i].name);
+            continue;
+        }
+        CPU *cpu = system.cpu;
+        benchmark.Run(opcodeMixes[i].name, CPU_STEPS, [cpu]()
+        {
+            for (uint32_t step = 0; step < CPU_STEPS; ++step)
+            {
+                cpu->Step();
+            }
+        });
+    }
+
+    System system;
+    if (!system.Load(NESTEST_FILE))
+    {
+        LOGI("Can't load %s", NESTEST_FILE);
+        return;
+    }
+    // Same start state as nestest.log
+    benchmark.Run("cpu_nestest_run", NESTEST_STEPS, [&system]()
+    {
+        system.cpu->PC = 0xC000;
+        system.cpu->SP = 0xFD;
+        system.cpu->SetStatus(0x24);
+        system.cpu->A = system.cpu->X = system.cpu->Y = 0;
+    },
+    [&system]()
+    {
+        for (uint32_t step = 0; step < NESTEST_STEPS; ++step)
+        {
+            uint8_t cpuCycles = system.cpu->Step();
+            for (uint16_t i = 0; i < cpuCycles * 3; ++i)
+            {
+                system.ppu->Step();
+            }
+        }
+    });
+}
+
+void BenchmarkPPU(Benchmark &benchmark)
+{
+    System system;
+    if (!system.Load(MARIO_FILE))
+    {
+        LOGI("Can't load %s", MARIO_FILE);
+        return;
+    }
+    // Run to the title screen so the nametables, palette and OAM hold a real picture
+    system.StepFrames(120);
+    PPU *ppu = system.ppu;
+    Memory *memoryCPU = system.memoryCPU;
+    auto stepFrame = [ppu]()
+    {
+        for (uint32_t cycle = 0; cycle < PPU_CYCLES_PER_FRAME; ++cycle)
+        {
+            ppu->Step();
+        }
+    };
+    // Show background and sprites
+    memoryCPU->Write(0x2001, 0x1E);
+    benchmark.Run("ppu_frame_rendering_on", 1, stepFrame);
+    memoryCPU->Write(0x2001, 0x00);
+    benchmark.Run("ppu_frame_rendering_off", 1, stepFrame);
+}
+
+void BenchmarkMemoryCPU(Benchmark &benchmark)
+{
+    System system;
+    if (!system.Load(MARIO_FILE))
+    {
+        LOGI("Can't load %s", MARIO_FILE);
+        return;
+    }
+    Memory *memory = system.memoryCPU;
+    struct Region
+    {
+        const char *readName;
+        const char *writeName;
+        uint16_t start;
+        uint16_t mask;
+    };
+    // PRG-ROM writes go to the mapper register and PPU register writes change the PPU state so they are measured separately
+    static const Region regions[] =
+    {
+        {"memory_cpu_read_ram", "memory_cpu_write_ram", 0x0000, 0x1FFF},
+        {"memory_cpu_read_ppu_register", NULL, 0x2000, 0x0007},
+        {"memory_cpu_read_sram", "memory_cpu_write_sram", 0x6000, 0x1FFF},
+        {"memory_cpu_read_prg", NULL, 0x8000, 0x7FFF},
+    };
+    for (size_t i = 0; i < sizeof(regions) / sizeof(regions[0]); ++i)
+    {
+        const Region region = regions[i];
+        benchmark.Run(region.readName, MEMORY_ACCESSES, [memory, region]()
+        {
+            uint8_t sum = 0;
+            for (uint32_t j = 0; j < MEMORY_ACCESSES; ++j)
+            {
+                sum += memory->Read(region.start + ((j * 7) & region.mask));
+            }
+            DoNotOptimize(sum);
+        });
+        if (region.writeName == NULL)
+        {
+            continue;
+        }
+        benchmark.Run(region.writeName, MEMORY_ACCESSES, [memory, region]()
+        {
+            for (uint32_t j = 0; j < MEMORY_ACCESSES; ++j)
+            {
+                memory->Write(region.start + ((j * 7) & region.mask), j);
+            }
+        });
+    }
+    // Writing all PPU registers would change the PPU state, $2003/$2004 (OAM) are the harmless ones
+    benchmark.Run("memory_cpu_write_ppu_register", MEMORY_ACCESSES, [memory]()
+    {
+        for (uint32_t j = 0; j < MEMORY_ACCESSES; ++j)
+        {
+            memory->Write(0x2003 + (j & 1), j);
+        }
+    });
+}
+
+void BenchmarkMemoryPPU(Benchmark &benchmark)
+{
+    System system;
+    if (!system.Load(MARIO_FILE))
+    {
+        LOGI("Can't load %s", MARIO_FILE);
+        return;
+    }
+    Memory *memory = system.memoryPPU;
+    benchmark.Run("memory_ppu_read_pattern", MEMORY_ACCESSES, [memory]()
+    {
+        uint8_t sum = 0;
+        for (uint32_t j = 0; j < MEMORY_ACCESSES; ++j)
+        {
+            sum += memory->Read((j * 7) & 0x1FFF);
+        }
+        DoNotOptimize(sum);
+    });
+    benchmark.Run("memory_ppu_read_nametable", MEMORY_ACCESSES, [memory]()
+    {
+        uint8_t sum = 0;
+        for (uint32_t j = 0; j < MEMORY_ACCESSES; ++j)
+        {
+            sum += memory->Read(0x2000 + ((j * 7) & 0x0FFF));
+        }
+        DoNotOptimize(sum);
+    });
+    benchmark.Run("memory_ppu_write_nametable", MEMORY_ACCESSES, [memory]()
+    {
+        for (uint32_t j = 0; j < MEMORY_ACCESSES; ++j)
+        {
+            memory->Write(0x2000 + ((j * 7) & 0x0FFF), j);
+        }
+    });
+    benchmark.Run("memory_ppu_read_palette", MEMORY_ACCESSES, [memory]()
+    {
+        uint8_t sum = 0;
+        for (uint32_t j = 0; j < MEMORY_ACCESSES; ++j)
+        {
+            sum += memory->Read(0x3F00 + (j & 0x1F));
+        }
+        DoNotOptimize(sum);
+    });
+    benchmark.Run("memory_ppu_write_palette", MEMORY_ACCESSES, [memory]()
+    {
+        for (uint32_t j = 0; j < MEMORY_ACCESSES; ++j)
+        {
+            memory->Write(0x3F00 + (j & 0x1F), j & 0x3F);
+        }
+    });
+}
+
+int main(int argc, char **argv)
+{
+    Benchmark benchmark;
+    if (!benchmark.ParseArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark.PinCore();
+    BenchmarkCPU(benchmark);
+    BenchmarkPPU(benchmark);
+    BenchmarkMemoryCPU(benchmark);
+    BenchmarkMemoryPPU(benchmark);
+    return benchmark.WriteJSON("micro") ? 0 : 1;
+}
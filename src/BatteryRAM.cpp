@@ -0,0 +1,98 @@
+#include "BatteryRAM.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <chrono>
+#include "Platforms.h"
+
+BatteryRAM::BatteryRAM()
+{
+    fileDescriptor = -1;
+    data = NULL;
+    size = 0;
+    isRunning = false;
+}
+
+BatteryRAM::~BatteryRAM()
+{
+    Close();
+}
+
+uint8_t* BatteryRAM::Open(std::string fileName, uint32_t size)
+{
+    Close();
+    fileDescriptor = open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fileDescriptor < 0)
+    {
+        LOGI("Can't open save file %s", fileName.c_str());
+        return NULL;
+    }
+    // A new save file is filled with zero by ftruncate. An existing one keeps its content
+    struct stat fileStat;
+    if ((fstat(fileDescriptor, &fileStat) < 0) ||
+        ((fileStat.st_size < size) && (ftruncate(fileDescriptor, size) < 0)))
+    {
+        LOGI("Can't resize save file %s", fileName.c_str());
+        close(fileDescriptor);
+        fileDescriptor = -1;
+        return NULL;
+    }
+    void *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    if (address == MAP_FAILED)
+    {
+        LOGI("Can't map save file %s", fileName.c_str());
+        close(fileDescriptor);
+        fileDescriptor = -1;
+        return NULL;
+    }
+    data = reinterpret_cast<uint8_t *>(address);
+    this->size = size;
+    isRunning = true;
+    flushThread = std::thread(&BatteryRAM::FlushLoop, this);
+    return data;
+}
+
+void BatteryRAM::Flush()
+{
+    if (data != NULL)
+    {
+        // The kernel tracks the dirty pages of the mapping so msync only writes the pages the game has changed
+        msync(data, size, MS_SYNC);
+    }
+}
+
+void BatteryRAM::FlushLoop()
+{
+    std::unique_lock<std::mutex> lock(flushMutex);
+    while (isRunning)
+    {
+        flushCondition.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL));
+        Flush();
+    }
+}
+
+void BatteryRAM::Close()
+{
+    if (flushThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            isRunning = false;
+        }
+        flushCondition.notify_one();
+        flushThread.join();
+    }
+    if (data != NULL)
+    {
+        Flush();
+        munmap(data, size);
+        data = NULL;
+    }
+    if (fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+}
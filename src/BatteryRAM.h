@@ -0,0 +1,42 @@
+#ifndef _BATTERY_RAM_H_
+#define _BATTERY_RAM_H_
+
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * Battery-backed SRAM ($6000-$7FFF) is kept in a .sav file next to the NES file
+ * The save file is mapped into memory with MAP_SHARED so the mapper can read/write SRAM with a plain load/store
+ * A background thread flushes the dirty pages to disk every FLUSH_INTERVAL milliseconds and once more when the game is closed
+ * so we never call a syscall when the game writes to SRAM
+ */
+#define FLUSH_INTERVAL 1000
+
+class BatteryRAM
+{
+    public:
+        BatteryRAM();
+        ~BatteryRAM();
+        // Map the save file into memory. Return NULL if the save file can't be created or mapped
+        uint8_t* Open(std::string fileName, uint32_t size);
+        // Write all dirty pages to the save file and wait until it is done
+        void Flush();
+
+    private:
+        int fileDescriptor;
+        uint8_t *data;
+        uint32_t size;
+        // Flush thread
+        std::thread flushThread;
+        std::mutex flushMutex;
+        std::condition_variable flushCondition;
+        bool isRunning;
+
+        void FlushLoop();
+        void Close();
+};
+
+#endif //_BATTERY_RAM_H_
@@ -0,0 +1,36 @@
+#include "BusClock.h"
+#include "PPU.h"
+
+BusClock::BusClock()
+{
+    ppu = NULL;
+    busCycles = 0;
+}
+
+void BusClock::SetPPU(PPU *ppu)
+{
+    this->ppu = ppu;
+}
+
+void BusClock::Tick(uint8_t busCycles)
+{
+    this->busCycles += busCycles;
+    if (ppu != NULL)
+    {
+        for (uint16_t i = 0; i < busCycles * 3; ++i)
+        {
+            ppu->Step();
+        }
+    }
+}
+
+void BusClock::EndInstruction(uint8_t cycles)
+{
+    if (cycles > busCycles)
+    {
+        uint8_t remainingCycles = cycles - busCycles;
+        busCycles = 0;
+        Tick(remainingCycles);
+    }
+    busCycles = 0;
+}
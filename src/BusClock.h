@@ -0,0 +1,50 @@
+#ifndef _BUS_CLOCK_H_
+#define _BUS_CLOCK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Platforms.h"
+
+/*
+ * Bus-level timing of the CPU. Enabled by defining _CYCLE_ACCURATE_ in Platforms.h
+ * - Without it CPU::Step runs a whole instruction and Console::Step runs the PPU for the instruction cycles afterwards, so every
+ *   memory access of the instruction happens at the PPU dot of the instruction start
+ * - With it every CPU bus cycle (opcode and operand fetches, reads, writes, stack, and the dummy cycles of the indexed address
+ *   modes and of the read-modify-write instructions) first runs the PPU for 1 CPU cycle (3 dots), then does the access. So the
+ *   loads, stores and read-modify-writes reach the PPU registers at the dot of their own cycle
+ * - The other cycles of the instruction (internal operations, interrupt sequence, DMA stall, JIT blocks) are run at the end of the
+ *   instruction, and CPU::Step still returns the cycles of the instruction. Console::Step doesn't run the PPU again
+ * The stack and vector accesses may happen 1-2 cycles earlier than on the real CPU: they only reach the RAM and the cartridge
+ * When the mode is compiled out the CPU uses NullBusClock, which does nothing
+ */
+class PPU;
+class BusClock
+{
+    public:
+        BusClock();
+        void SetPPU(PPU *ppu);
+        // Run the PPU for the given number of bus cycles of the current instruction
+        void Tick(uint8_t busCycles = 1);
+        // Run the PPU for the cycles of the instruction that didn't use the bus
+        void EndInstruction(uint8_t cycles);
+
+    private:
+        PPU *ppu;
+        uint8_t busCycles; // Cycles already run for the current instruction
+};
+
+class NullBusClock
+{
+    public:
+        void SetPPU(PPU *ppu) {}
+        void Tick(uint8_t busCycles = 1) {}
+        void EndInstruction(uint8_t cycles) {}
+};
+
+#ifdef _CYCLE_ACCURATE_
+typedef BusClock CPUBusClock;
+#else
+typedef NullBusClock CPUBusClock;
+#endif
+
+#endif //_BUS_CLOCK_H_
@@ -1,6 +1,7 @@
 #include "CPU.h"
 #include <assert.h>
 #include "Platforms.h"
+#include "Timeline.h"
 
 CPU::CPU(Memory *cpuMemory)
 {
@@ -8,24 +9,100 @@ CPU::CPU(Memory *cpuMemory)
     X = 0;
     Y = 0;
     SP = 0xFF;
-    P.byte = 0x24;
+    SetStatus(0x24);
     cycles = 0;
     stall = 0;
+    instructionCount = 0;
+    stallCycleCount = 0;
     this->cpuMemory = cpuMemory;
-    interrupt = InterruptNone;
+    pendingEvents = 0;
+    irqLines = 0;
+    delayedI = CLEAR;
     uint16_t lo = cpuMemory->Read(RESET_VECTOR_LOW);
     uint16_t hi = cpuMemory->Read(RESET_VECTOR_HIGH);
     PC = (hi << 8) | lo;
+    guestProfiler.SetMemory(cpuMemory);
+    tracer.SetMemory(cpuMemory);
+    jit.SetMemory(cpuMemory);
+    uint8_t addressModes[256];
+    for (uint16_t opcode = 0; opcode < 256; ++opcode)
+    {
+        addressModes[opcode] = opcodeAddressModes[opcode];
+    }
+    decodeCache.SetAddressModes(addressModes);
+    decodeCache.SetMemory(cpuMemory);
+    idleLoop.SetMemory(cpuMemory);
+    idleLoop.SetOpcodes(opcodeNames, addressModes);
+#ifdef _TRACE_INSTRUCTIONS_
+    tracer.Open(TRACE_FILE, opcodeNames, addressModes);
+#endif
+}
+
+CPU::~CPU()
+{
+#ifdef _PROFILE_GUEST_
+    guestProfiler.Report(GUEST_PROFILE_FILE, GUEST_HOTSPOT_FILE, opcodeNames);
+#endif
+#ifdef _PROFILE_OPCODES_
+    static const char *addressModeNames[] =
+    {
+        "Absolute", "AbsoluteX", "AbsoluteY", "Accumulator", "Immediate", "Implied", "IndirectX",
+        "Indirect", "IndirectY", "Relative", "ZeroPage", "ZeroPageX", "ZeroPageY"
+    };
+    const char *opcodeAddressModeNames[256];
+    for (uint16_t opcode = 0; opcode < 256; ++opcode)
+    {
+        opcodeAddressModeNames[opcode] = addressModeNames[opcodeAddressModes[opcode]];
+    }
+    profiler.Report(OPCODE_PROFILE_FILE, opcodeNames, opcodeAddressModeNames);
+#endif
 }
 
 uint8_t CPU::Step()
 {
-    if (stall > 0)
+    Interrupt interrupt = InterruptNone;
+    if (pendingEvents != 0)
     {
-        // Suspend CPU after writting DMA. It will take 1 cycle for each step
-        --stall;
-        return 1;
+        if (pendingEvents & EventStall)
+        {
+            // Suspend CPU after writting DMA. The console runs the PPU for the whole stall, at most 255 cycles per step
+            uint8_t stallCycles = (stall > 0xFF) ? 0xFF : uint8_t(stall);
+            stall -= stallCycles;
+            if (stall == 0)
+            {
+                pendingEvents &= ~EventStall;
+            }
+            stallCycleCount += stallCycles;
+            busClock.EndInstruction(stallCycles);
+            return stallCycles;
+        }
+        interrupt = PollInterrupt();
     }
+    else
+    {
+        // Run a translated block of PRG-ROM code if there is one (see Jit.h). The blocks don't poll the interrupts, so they only
+        // run when no event is pending
+        uint8_t blockInstructions = 0;
+        bool isRAMWritten = false;
+        uint16_t blockAddress = PC;
+        uint8_t status = GetStatus();
+        uint8_t blockCycles = jit.Execute(A, X, Y, status, PC, blockInstructions, isRAMWritten);
+        if (blockCycles > 0)
+        {
+            SetStatus(status);
+            idleLoop.Execute(blockAddress);
+            if (isRAMWritten)
+            {
+                // The block stores to the RAM without the bus
+                decodeCache.InvalidateRAM();
+            }
+            cycles += blockCycles;
+            instructionCount += blockInstructions;
+            busClock.EndInstruction(blockCycles);
+            return blockCycles;
+        }
+    }
+    ++instructionCount;
     uint64_t preCycles = cycles;
     switch (interrupt)
     {
@@ -36,13 +113,46 @@ uint8_t CPU::Step()
             IRQ();
             break;
     }
-    interrupt = InterruptNone;
-    currentOpcode = cpuMemory->Read(PC++); 
+    profiler.Begin();
+    uint16_t opcodeAddress = PC;
+    cpuMemory->GetWatch().Execute(PC);
+    idleLoop.Execute(PC);
+    const DecodeCache::Instruction &instruction = decodeCache.Fetch(PC);
+    tracer.Trace(PC, instruction.opcode, instruction.operand, A, X, Y, GetStatus(), SP, cycles);
+    currentOpcode = instruction.opcode;
+    operand = instruction.operand;
+    PC += instruction.size;
+    busClock.Tick(instruction.size);
     // Implement this opcode
     (this->*opcodeFunctions[currentOpcode])();
+    if ((PC <= opcodeAddress) && (opcodeAddress - PC < IDLE_LOOP_MAX_BYTES))
+    {
+        // Backward jump: it may be an idle loop
+        idleLoop.Jump(opcodeAddress, PC, A, X, Y, GetStatus(), SP, cycles, instructionCount);
+    }
+    // The interrupt cycles are counted in the opcode
+    profiler.End(currentOpcode, uint8_t(cycles - preCycles));
+    guestProfiler.Sample(opcodeAddress, currentOpcode, cycles);
+    busClock.EndInstruction(uint8_t(cycles - preCycles));
     return uint8_t(cycles - preCycles);
 }
 
+uint64_t CPU::GetInstructionCount()
+{
+    return instructionCount;
+}
+
+uint64_t CPU::GetStallCycleCount()
+{
+    return stallCycleCount;
+}
+
+void CPU::SkipIdleIterations(uint32_t iterations)
+{
+    cycles += uint64_t(iterations) * idleLoop.GetIterationCycles();
+    instructionCount += uint64_t(iterations) * idleLoop.GetIterationInstructions();
+}
+
 // Address mode
 uint8_t CPU::ReadMemory(bool checkPage)
 {
@@ -88,45 +198,57 @@ uint8_t CPU::ReadMemory(bool checkPage)
 uint8_t CPU::AddressAbsolute()
 {
     // 6502 is little endian
-    uint16_t lo = cpuMemory->Read(PC++);
-    uint16_t hi = cpuMemory->Read(PC++);
+    uint16_t lo = operand & 0xFF;
+    uint16_t hi = operand >> 8;
     uint16_t address = (hi << 8) | lo;
     lastAddress = address;
-    return cpuMemory->Read(address);
+    return Read(address);
 }
 
 uint8_t CPU::AddressAbsoluteX(bool checkPage)
 {
     // 6502 is little endian
-    uint16_t lo = cpuMemory->Read(PC++);
-    uint16_t hi = cpuMemory->Read(PC++);
+    uint16_t lo = operand & 0xFF;
+    uint16_t hi = operand >> 8;
     uint16_t address = (hi << 8) | lo;
     // If the result of Base+Index is greater than $FFFF, wrapping will occur.
     if (checkPage && ((address & 0xFF00) != ((address + X) & 0xFF00)))
     {
         // page cross
         ++cycles;
+        busClock.Tick();
+    }
+    else if (!checkPage)
+    {
+        // Read-modify-write: the dummy read is always done
+        busClock.Tick();
     }
     address = address + X;
     lastAddress = address;
-    return cpuMemory->Read(address);    
+    return Read(address);    
 }
 
 uint8_t CPU::AddressAbsoluteY(bool checkPage)
 {
     // 6502 is little endian
-    uint16_t lo = cpuMemory->Read(PC++);
-    uint16_t hi = cpuMemory->Read(PC++);
+    uint16_t lo = operand & 0xFF;
+    uint16_t hi = operand >> 8;
     uint16_t address = (hi << 8) | lo;
     // If the result of Base+Index is greater than $FFFF, wrapping will occur.
     if (checkPage && ((address & 0xFF00) != ((address + Y) & 0xFF00))) 
     {
         // page crossed
         ++cycles;
+        busClock.Tick();
+    }
+    else if (!checkPage)
+    {
+        // Read-modify-write: the dummy read is always done
+        busClock.Tick();
     }
     address = address + Y;
     lastAddress = address;
-    return cpuMemory->Read(address);
+    return Read(address);
 }
 
 uint8_t CPU::AddressAccumulator()
@@ -136,66 +258,75 @@ uint8_t CPU::AddressAccumulator()
 
 uint8_t CPU::AddressImmediate()
 {
-    return cpuMemory->Read(PC++);
+    return uint8_t(operand);
 }
 
 uint8_t CPU::AddressIndirectX()
 {
+    busClock.Tick(); // Dummy read of the base address
     // 6502 is little endian
-    uint16_t baseAddress = cpuMemory->Read(PC++);
+    uint16_t baseAddress = operand & 0xFF;
     baseAddress = (baseAddress + X) & 0xFF;
-    uint16_t lo = cpuMemory->Read(baseAddress);
-    uint16_t hi = cpuMemory->Read((baseAddress + 1) & 0xFF);
+    uint16_t lo = Read(baseAddress);
+    uint16_t hi = Read((baseAddress + 1) & 0xFF);
     uint16_t address = (hi << 8) | lo;
     lastAddress = address;
-    return cpuMemory->Read(address);
+    return Read(address);
 }
 
 uint8_t CPU::AddressIndirectY(bool checkPage)
 {
     // 6502 is little endian
-    uint16_t baseAddress = cpuMemory->Read(PC++);
-    uint16_t lo = cpuMemory->Read(baseAddress);
-    uint16_t hi = cpuMemory->Read((baseAddress + 1) & 0xFF);
+    uint16_t baseAddress = operand & 0xFF;
+    uint16_t lo = Read(baseAddress);
+    uint16_t hi = Read((baseAddress + 1) & 0xFF);
     uint16_t address = (hi << 8) | lo;
     // If Base_Location+Index is greater than $FFFF, wrapping will occur.
     if (checkPage && ((address & 0xFF00) != ((address + Y) & 0xFF00)))
     {
         // page crossed
         ++cycles;
+        busClock.Tick();
+    }
+    else if (!checkPage)
+    {
+        // Read-modify-write: the dummy read is always done
+        busClock.Tick();
     }
     address = (address + Y);
     lastAddress = address;
-    return cpuMemory->Read(address);
+    return Read(address);
 }
 
 uint8_t CPU::AddressRelative()
 {
-    return cpuMemory->Read(PC++);
+    return uint8_t(operand);
 }
 
 uint8_t CPU::AddressZeroPage()
 {
-    uint16_t address = cpuMemory->Read(PC++);
+    uint16_t address = operand & 0xFF;
     address &= 0x00FF;
     lastAddress = address;
-    return cpuMemory->Read(address);
+    return Read(address);
 }
 
 uint8_t CPU::AddressZeroPageX()
 {
-    uint16_t address = cpuMemory->Read(PC++);
+    busClock.Tick(); // Dummy read of the base address
+    uint16_t address = operand & 0xFF;
     address = (address + X) & 0x00FF;
     lastAddress = address;
-    return cpuMemory->Read(address);
+    return Read(address);
 }
 
 uint8_t CPU::AddressZeroPageY()
 {
-    uint16_t address = cpuMemory->Read(PC++);
+    busClock.Tick(); // Dummy read of the base address
+    uint16_t address = operand & 0xFF;
     address = (address + Y) & 0x00FF;
     lastAddress = address;
-    return cpuMemory->Read(address);
+    return Read(address);
 }
 
 // Write
@@ -235,114 +366,195 @@ void CPU::WriteMemory(uint8_t value)
 void CPU::WriteAddressAbsolute(uint8_t value)
 {
     // 6502 is little endian
-    uint16_t lo = cpuMemory->Read(PC++);
-    uint16_t hi = cpuMemory->Read(PC++);
+    uint16_t lo = operand & 0xFF;
+    uint16_t hi = operand >> 8;
     uint16_t address = (hi << 8) | lo;
-    cpuMemory->Write(address, value);
+    Write(address, value);
 }
 
 void CPU::WriteAddressAbsoluteX(uint8_t value)
 {
     // 6502 is little endian
-    uint16_t lo = cpuMemory->Read(PC++);
-    uint16_t hi = cpuMemory->Read(PC++);
+    uint16_t lo = operand & 0xFF;
+    uint16_t hi = operand >> 8;
     uint16_t address = (hi << 8) | lo;
     address = address + X;
-    cpuMemory->Write(address, value);    
+    busClock.Tick(); // Dummy read before the page of the address is fixed
+    Write(address, value);    
 }
 
 void CPU::WriteAddressAbsoluteY(uint8_t value)
 {
     // 6502 is little endian
-    uint16_t lo = cpuMemory->Read(PC++);
-    uint16_t hi = cpuMemory->Read(PC++);
+    uint16_t lo = operand & 0xFF;
+    uint16_t hi = operand >> 8;
     uint16_t address = (hi << 8) | lo;
     address = address + Y;
-    cpuMemory->Write(address, value);
+    busClock.Tick(); // Dummy read before the page of the address is fixed
+    Write(address, value);
 }
 
 void CPU::WriteAddressIndirectX(uint8_t value)
 {
+    busClock.Tick(); // Dummy read of the base address
     // 6502 is little endian
-    uint16_t baseAddress = cpuMemory->Read(PC++);
+    uint16_t baseAddress = operand & 0xFF;
     baseAddress = (baseAddress + X) & 0xFF;
-    uint16_t lo = cpuMemory->Read(baseAddress);
-    uint16_t hi = cpuMemory->Read((baseAddress + 1) & 0xFF);
+    uint16_t lo = Read(baseAddress);
+    uint16_t hi = Read((baseAddress + 1) & 0xFF);
     uint16_t address = (hi << 8) | lo;
-    cpuMemory->Write(address, value);
+    Write(address, value);
 }
 
 void CPU::WriteAddressIndirectY(uint8_t value)
 {
     // 6502 is little endian
-    uint16_t baseAddress = cpuMemory->Read(PC++);
-    uint16_t lo = cpuMemory->Read(baseAddress);
-    uint16_t hi = cpuMemory->Read((baseAddress + 1) & 0xFF);
+    uint16_t baseAddress = operand & 0xFF;
+    uint16_t lo = Read(baseAddress);
+    uint16_t hi = Read((baseAddress + 1) & 0xFF);
     uint16_t address = (hi << 8) | lo;
     address = (address + Y);
-    cpuMemory->Write(address, value);
+    busClock.Tick(); // Dummy read before the page of the address is fixed
+    Write(address, value);
+}
+
+void CPU::WriteAddressHigh(uint8_t value)
+{
+    // 6502 is little endian
+    uint16_t baseAddress;
+    uint8_t index;
+    switch(opcodeAddressModes[currentOpcode])
+    {
+        case AbsoluteX:
+            baseAddress = operand;
+            index = X;
+            break;
+        case AbsoluteY:
+            baseAddress = operand;
+            index = Y;
+            break;
+        case IndirectY:
+        {
+            uint16_t lo = Read(operand & 0xFF);
+            uint16_t hi = Read((operand + 1) & 0xFF);
+            baseAddress = (hi << 8) | lo;
+            index = Y;
+            break;
+        }
+        default:
+            assert(0);
+            return;
+    }
+    uint16_t address = baseAddress + index;
+    value = value & uint8_t((baseAddress >> 8) + 1);
+    if ((address & 0xFF00) != (baseAddress & 0xFF00))
+    {
+        // The value replaces the high byte of the address when the index crosses a page
+        address = (uint16_t(value) << 8) | (address & 0xFF);
+    }
+    busClock.Tick(); // Dummy read before the page of the address is fixed
+    Write(address, value);
 }
 
 void CPU::WriteAddressZeroPage(uint8_t value)
 {
-    uint16_t address = cpuMemory->Read(PC++);
+    uint16_t address = operand & 0xFF;
     address &= 0x00FF;
-    cpuMemory->Write(address, value);
+    Write(address, value);
 }
 
 void CPU::WriteAddressZeroPageX(uint8_t value)
 {
-    uint16_t address = cpuMemory->Read(PC++);
+    busClock.Tick(); // Dummy read of the base address
+    uint16_t address = operand & 0xFF;
     address = (address + X) & 0x00FF;
-    cpuMemory->Write(address, value);
+    Write(address, value);
 }
 
 void CPU::WriteAddressZeroPageY(uint8_t value)
 {
-    uint16_t address = cpuMemory->Read(PC++);
+    busClock.Tick(); // Dummy read of the base address
+    uint16_t address = operand & 0xFF;
     address = (address + Y) & 0x00FF;
-    cpuMemory->Write(address, value);
+    Write(address, value);
 }
 // Memory
 void CPU::StackPush(uint8_t value)
 {
-    cpuMemory->Write(0x0100 | SP, value);
+    Write(0x0100 | SP, value);
     --SP;
 }
 
 uint8_t CPU::StackPull()
 {
     ++SP;
-    return cpuMemory->Read(0x0100 | SP);
+    return Read(0x0100 | SP);
 }
 
 // Interrupt
-void CPU::TriggerNMI()
+void CPU::SetIRQLine(IRQSource source, bool isAsserted)
 {
-    interrupt = InterruptNMI;
+    if (isAsserted)
+    {
+        irqLines |= source;
+    }
+    else
+    {
+        irqLines &= ~source;
+    }
+    if (irqLines != 0)
+    {
+        pendingEvents |= EventIRQ;
+    }
+    else
+    {
+        pendingEvents &= ~EventIRQ;
+    }
+}
+
+Interrupt CPU::PollInterrupt()
+{
+    uint8_t I = (pendingEvents & EventDelayedI) ? delayedI : P.bits.I;
+    pendingEvents &= ~EventDelayedI;
+    if (pendingEvents & EventNMI)
+    {
+        pendingEvents &= ~EventNMI;
+        return InterruptNMI;
+    }
+    if ((pendingEvents & EventIRQ) && (I == CLEAR))
+    {
+        // The line stays asserted until the device releases it, I prevents the handler from being interrupted again
+        return InterruptIRQ;
+    }
+    return InterruptNone;
 }
 
 void CPU::NMI()
 {
+    TIMELINE_INSTANT("NMI", "CPU", PC);
+    uint8_t previousSP = SP;
     StackPush((PC >> 8) & 0xFF);
     StackPush(PC & 0xFF);
-    StackPush(P.byte | FLAG_BREAK);
+    StackPush(GetStatus() | FLAG_BREAK);
     P.bits.I = SET;
-    uint16_t lo = cpuMemory->Read(NMI_VECTOR_LOW);
-    uint16_t hi = cpuMemory->Read(NMI_VECTOR_HIGH);
+    uint16_t lo = Read(NMI_VECTOR_LOW);
+    uint16_t hi = Read(NMI_VECTOR_HIGH);
     PC = (hi << 8) | lo;
+    guestProfiler.Call(PC, previousSP);
     cycles += 7;
 }
 
 void CPU::IRQ()
 {
+    uint8_t previousSP = SP;
     StackPush((PC >> 8) & 0xFF);
     StackPush(PC & 0xFF);
-    StackPush(P.byte | FLAG_BREAK);
+    StackPush(GetStatus() | FLAG_BREAK);
     P.bits.I = SET;
-    uint16_t lo = cpuMemory->Read(IRQ_VECTOR_LOW);
-    uint16_t hi = cpuMemory->Read(IRQ_VECTOR_HIGH);
+    uint16_t lo = Read(IRQ_VECTOR_LOW);
+    uint16_t hi = Read(IRQ_VECTOR_HIGH);
     PC = (hi << 8) | lo;
+    guestProfiler.Call(PC, previousSP);
     cycles += 7;
 }
 // Helper functions
@@ -387,21 +599,48 @@ void CPU::ADC()
      * + Add 1 cycle if page boundary crossed
      */
     uint8_t value = ReadMemory(true);
-    uint16_t result = A + value + P.bits.C;
-    P.bits.V = (((A & 0x80) != (result & 0x80)) && ((value & 0x80) != (result & 0x80))) ? SET : CLEAR;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = ((result & 0xFF) == 0) ? SET : CLEAR;
-    P.bits.C = (result > 0xFF) ? SET : CLEAR;
+    uint16_t result = A + value + flagC;
+    flagV = (A ^ result) & (value ^ result) & 0x80;
+    SetZN(uint8_t(result));
+    flagC = (result > 0xFF) ? SET : CLEAR;
     A = (uint8_t)(result & 0xFF);
     cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::ALR()
 {
+    /*
+     * AND byte with accumulator, then shift right one bit in accumulator
+     * Affects Flags: N Z C
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Immediate   |ALR #arg   |$4B| 2 | 2
+     */
+    uint8_t value = ReadMemory();
+    A = A & value;
+    flagC = A & 0x01;
+    A = (A >> 1) & 0x7F; // make sure that the highest bit is equal 0
+    SetZN(A);
+    cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::ANC()
 {
+    /*
+     * AND byte with accumulator. If the result is negative then carry is set
+     * Affects Flags: N Z C
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Immediate   |ANC #arg   |$0B| 2 | 2
+     * Immediate   |ANC #arg   |$2B| 2 | 2
+     */
+    uint8_t value = ReadMemory();
+    A = A & value;
+    SetZN(A);
+    flagC = ((A & 0x80) == 0x80) ? SET : CLEAR;
+    cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::AND()
@@ -424,13 +663,28 @@ void CPU::AND()
      */
     uint8_t value = ReadMemory(true);
     A = A & value;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::ARR()
 {
+    /*
+     * AND byte with accumulator, then rotate one bit right in accumulator
+     * Affects Flags: N V Z C
+     * C is bit 6 of the result and V is bit 6 xor bit 5 of the result
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Immediate   |ARR #arg   |$6B| 2 | 2
+     */
+    uint8_t value = ReadMemory();
+    A = A & value;
+    A = ((A >> 1) & 0x7F) | ((flagC == SET) ? 0x80 : 0x00); // assign P.C to the highest bit of the result
+    SetZN(A);
+    flagC = ((A & 0x40) == 0x40) ? SET : CLEAR;
+    flagV = (A ^ (A << 1)) & 0x40;
+    cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::ASL()
@@ -447,17 +701,16 @@ void CPU::ASL()
      * Absolute,X    ASL $4400,X   $1E  3   7
      */
     uint8_t value = ReadMemory();
-    P.bits.C = ((value & 0x80) == 0x80) ? SET : CLEAR;
+    flagC = ((value & 0x80) == 0x80) ? SET : CLEAR;
     uint8_t result = (value << 1) & 0xFE; // make sure that the lowest bit is equal 0
-    P.bits.Z = (result == 0) ? SET : CLEAR;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
+    SetZN(result);
     switch(opcodeAddressModes[currentOpcode])
     {
         case Accumulator:
             A = result;
             break;
         default:
-            cpuMemory->Write(lastAddress, result);
+            WriteBack(result);
             break;
     }
     cycles += opcodeCycles[currentOpcode];
@@ -465,10 +718,35 @@ void CPU::ASL()
 
 void CPU::AXA()
 {
+    /*
+     * AND X register with accumulator then AND result with the high byte of the target address + 1. Store result in memory
+     * Affects Flags: None
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Absolute,Y  |AXA arg,Y  |$9F| 3 | 5
+     * Indirect,Y  |AXA (arg),Y|$93| 2 | 6
+     */
+    WriteAddressHigh(A & X);
+    cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::AXS()
 {
+    /*
+     * AND X register with accumulator and store result in X register, then subtract byte from X register (without borrow)
+     * Affects Flags: N Z C
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Immediate   |AXS #arg   |$CB| 2 | 2
+     */
+    uint8_t value = ReadMemory();
+    uint8_t temp = A & X;
+    X = temp - value;
+    SetZN(X);
+    flagC = (temp >= value) ? SET : CLEAR;
+    cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::BCC()
@@ -484,7 +762,7 @@ void CPU::BCC()
      */
     assert(opcodeAddressModes[currentOpcode] == Relative);
     uint8_t offset = AddressRelative();
-    if (P.bits.C == CLEAR)
+    if (flagC == CLEAR)
     {
         Branch(offset);
     }
@@ -504,7 +782,7 @@ void CPU::BCS()
      */
     assert(opcodeAddressModes[currentOpcode] == Relative);
     uint8_t offset = AddressRelative();
-    if (P.bits.C == SET)
+    if (flagC == SET)
     {
         Branch(offset);
     }
@@ -524,7 +802,7 @@ void CPU::BEQ()
      */
     assert(opcodeAddressModes[currentOpcode] == Relative);
     uint8_t offset = AddressRelative();
-    if (P.bits.Z == SET)
+    if (flagZ == 0)
     {
         Branch(offset);
     }
@@ -544,9 +822,9 @@ void CPU::BIT()
     uint8_t value = ReadMemory();
     uint8_t result = A & value;
     //NOTE: Refer here http://www.6502.org/tutorials/6502opcodes.html#BIT to know how to implement this opcode
-    P.bits.N = ((value & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.V = ((value & 0x40) == 0x40) ? SET : CLEAR;
-    P.bits.Z = (result == 0) ? SET : CLEAR;
+    flagN = value;
+    flagV = value & 0x40;
+    flagZ = result;
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -563,7 +841,7 @@ void CPU::BMI()
      */
     assert(opcodeAddressModes[currentOpcode] == Relative);
     uint8_t offset = AddressRelative();
-    if (P.bits.N == SET)
+    if ((flagN & 0x80) != 0)
     {
         Branch(offset);
     }
@@ -583,7 +861,7 @@ void CPU::BNE()
      */
     assert(opcodeAddressModes[currentOpcode] == Relative);
     uint8_t offset = AddressRelative();
-    if (P.bits.Z == CLEAR)
+    if (flagZ != 0)
     {
         Branch(offset);    
     }
@@ -603,7 +881,7 @@ void CPU::BPL()
      */
     assert(opcodeAddressModes[currentOpcode] == Relative);
     uint8_t offset = AddressRelative();
-    if (P.bits.N == CLEAR)
+    if ((flagN & 0x80) == 0)
     {
         Branch(offset);
     }
@@ -621,13 +899,15 @@ void CPU::BRK()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     ++PC;
+    uint8_t previousSP = SP;
     StackPush((PC >> 8) & 0xFF);
     StackPush(PC & 0xFF);
-    StackPush(P.byte | FLAG_BREAK);
+    StackPush(GetStatus() | FLAG_BREAK);
     P.bits.I = SET;
-    uint16_t lo = cpuMemory->Read(IRQ_VECTOR_LOW);
-    uint16_t hi = cpuMemory->Read(IRQ_VECTOR_HIGH);
+    uint16_t lo = Read(IRQ_VECTOR_LOW);
+    uint16_t hi = Read(IRQ_VECTOR_HIGH);
     PC = (hi << 8) | lo;
+    guestProfiler.Call(PC, previousSP);
     cycles += opcodeCycles[currentOpcode]; 
 }
 
@@ -644,7 +924,7 @@ void CPU::BVC()
      */
     assert(opcodeAddressModes[currentOpcode] == Relative);
     uint8_t offset = AddressRelative();
-    if (P.bits.V == CLEAR)
+    if (flagV == 0)
     {
         Branch(offset);
     }
@@ -664,7 +944,7 @@ void CPU::BVS()
      */
     assert(opcodeAddressModes[currentOpcode] == Relative);
     uint8_t offset = AddressRelative();
-    if (P.bits.V == SET)
+    if (flagV != 0)
     {
         Branch(offset);
     }
@@ -681,7 +961,7 @@ void CPU::CLC()
      * Implied     CLC         $18  1   2
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
-    P.bits.C = CLEAR;
+    flagC = CLEAR;
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -709,6 +989,7 @@ void CPU::CLI()
      * Implied     CLI         $58  1   2
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
+    DelayIRQPoll();
     P.bits.I = CLEAR;
     cycles += opcodeCycles[currentOpcode];
 }
@@ -723,7 +1004,7 @@ void CPU::CLV()
      * Implied     CLV         $B8  1   2
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
-    P.bits.V = CLEAR;
+    flagV = CLEAR;
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -747,9 +1028,8 @@ void CPU::CMP()
      */
     uint8_t value = ReadMemory(true);
     uint8_t result = A - value;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (result == 0) ? SET : CLEAR;
-    P.bits.C = (A >= value) ? SET : CLEAR;
+    SetZN(result);
+    flagC = (A >= value) ? SET : CLEAR;
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -766,9 +1046,8 @@ void CPU::CPX()
      */
     uint8_t value = ReadMemory();
     uint8_t result = X - value;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (result == 0) ? SET : CLEAR;
-    P.bits.C = (X >= value) ? SET : CLEAR;
+    SetZN(result);
+    flagC = (X >= value) ? SET : CLEAR;
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -785,9 +1064,8 @@ void CPU::CPY()
      */
     uint8_t value = ReadMemory();
     uint8_t result = Y - value;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (result == 0) ? SET : CLEAR;
-    P.bits.C = (Y >= value) ? SET : CLEAR;
+    SetZN(result);
+    flagC = (Y >= value) ? SET : CLEAR;
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -812,10 +1090,9 @@ void CPU::DCP()
     --value;
     // CMP
     uint8_t result = A - value;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (result == 0) ? SET : CLEAR;
-    P.bits.C = (A >= value) ? SET : CLEAR;
-    cpuMemory->Write(lastAddress, value);
+    SetZN(result);
+    flagC = (A >= value) ? SET : CLEAR;
+    WriteBack(value);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -833,9 +1110,8 @@ void CPU::DEC()
      */
     uint8_t value = ReadMemory();
     uint8_t result = (value - 1) & 0xFF;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (result == 0) ? SET : CLEAR;
-    cpuMemory->Write(lastAddress, result);
+    SetZN(result);
+    WriteBack(result);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -850,8 +1126,7 @@ void CPU::DEX()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     X = X - 1;
-    P.bits.N = ((X & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (X == 0) ? SET : CLEAR;
+    SetZN(X);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -866,8 +1141,7 @@ void CPU::DEY()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     Y = Y - 1;
-    P.bits.N = ((Y & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (Y == 0) ? SET : CLEAR;
+    SetZN(Y);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -891,8 +1165,7 @@ void CPU::EOR()
      */
     uint8_t value = ReadMemory(true);
     A = A ^ value;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -910,9 +1183,8 @@ void CPU::INC()
      */
     uint8_t value = ReadMemory();
     uint8_t result = (value + 1) & 0xFF;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (result == 0) ? SET : CLEAR;
-    cpuMemory->Write(lastAddress, result);
+    SetZN(result);
+    WriteBack(result);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -927,8 +1199,7 @@ void CPU::INX()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     X = X + 1;
-    P.bits.N = ((X & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (X == 0) ? SET : CLEAR;
+    SetZN(X);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -943,8 +1214,7 @@ void CPU::INY()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     Y = Y + 1;
-    P.bits.N = ((Y & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (Y == 0) ? SET : CLEAR;
+    SetZN(Y);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -968,13 +1238,12 @@ void CPU::ISC()
     uint8_t value = ReadMemory();
     // INC
     ++value;
-    cpuMemory->Write(lastAddress, value);
-    int16_t result = A - value - (1 - P.bits.C);   
-    // I know it is not correctly. But clear it can pass the test :)
-    P.bits.V = CLEAR; 
-    P.bits.C = (result >= 0) ? SET : CLEAR;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = ((result & 0xFF) == 0) ? SET : CLEAR;
+    WriteBack(value);
+    int16_t result = A - value - (1 - flagC);   
+    // Overflow when A and value have different signs and the sign of the result isn't the sign of A
+    flagV = (A ^ value) & (A ^ result) & 0x80;
+    flagC = (result >= 0) ? SET : CLEAR;
+    SetZN(uint8_t(result));
     A = (uint8_t)(result & 0xFF);
     cycles += opcodeCycles[currentOpcode];
 }
@@ -988,8 +1257,8 @@ void CPU::JMP()
      * Absolute      JMP $5597     $4C  3   3
      * Indirect      JMP ($5597)   $6C  3   5
      */
-    uint16_t lo = cpuMemory->Read(PC++);
-    uint16_t hi = cpuMemory->Read(PC++);
+    uint16_t lo = operand & 0xFF;
+    uint16_t hi = operand >> 8;
     uint16_t address = (hi << 8) | lo;
     switch(opcodeAddressModes[currentOpcode])
     {
@@ -998,11 +1267,11 @@ void CPU::JMP()
             break;
         case Indirect:
         {
-            uint16_t low = cpuMemory->Read(address);
+            uint16_t low = Read(address);
             //NOTE: http://forums.nesdev.com/viewtopic.php?t=6621&start=15
             ++lo;
             address = (hi << 8) | (lo & 0xFF);
-            uint16_t high = cpuMemory->Read(address);
+            uint16_t high = Read(address);
             address = (high << 8) | low;
             PC = address;
             break;
@@ -1022,10 +1291,11 @@ void CPU::JSR()
      * MODE           SYNTAX       HEX LEN TIM
      * Absolute      JSR $5597     $20  3   6
      */ 
-    uint16_t lo = cpuMemory->Read(PC++);
-    uint16_t hi = cpuMemory->Read(PC++);
+    uint16_t lo = operand & 0xFF;
+    uint16_t hi = operand >> 8;
     uint16_t address = (hi << 8) | lo;
     --PC;
+    guestProfiler.Call(address, SP);
     StackPush((PC >> 8) & 0xFF);
     StackPush(PC & 0xFF);
     PC = address;
@@ -1038,6 +1308,22 @@ void CPU::KIL()
 
 void CPU::LAS()
 {
+    /*
+     * AND memory with stack pointer, transfer result to accumulator, X register and stack pointer
+     * Affects Flags: N Z
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Absolute,Y  |LAS arg,Y  |$BB| 3 | 4+
+     *
+     * + Add 1 cycle if page boundary crossed
+     */
+    uint8_t value = ReadMemory(true);
+    SP = SP & value;
+    A = SP;
+    X = SP;
+    SetZN(A);
+    cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::LAX()
@@ -1060,8 +1346,7 @@ void CPU::LAX()
     uint8_t value = ReadMemory(true);
     A = value;
     X = value;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 
 }
@@ -1086,8 +1371,7 @@ void CPU::LDA()
      */
     uint8_t value = ReadMemory(true);
     A = value;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1108,8 +1392,7 @@ void CPU::LDX()
      */
     uint8_t value = ReadMemory(true);
     X = value;
-    P.bits.N = ((X & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (X == 0) ? SET : CLEAR;
+    SetZN(X);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1130,8 +1413,7 @@ void CPU::LDY()
      */
     uint8_t value = ReadMemory(true);
     Y = value;
-    P.bits.N = ((Y & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (Y == 0) ? SET : CLEAR;
+    SetZN(Y);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1149,17 +1431,16 @@ void CPU::LSR()
      * Absolute,X    LSR $4400,X   $5E  3   7
      */
     uint8_t value = ReadMemory();
-    P.bits.N = CLEAR;
-    P.bits.C = value & 0x01;
+    flagC = value & 0x01;
     uint8_t result = (value >> 1) & 0x7F; // make sure that the highest bit is equal 0
-    P.bits.Z = (result == 0) ? SET : CLEAR;
+    SetZN(result); // N is CLEAR
     switch(opcodeAddressModes[currentOpcode])
     {
         case Accumulator:
             A = result;
             break;
         default:
-            cpuMemory->Write(lastAddress, result);
+            WriteBack(result);
             break;
     }
     cycles += opcodeCycles[currentOpcode];
@@ -1204,8 +1485,7 @@ void CPU::ORA()
      */
     uint8_t value = ReadMemory(true);
     A = A | value;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 
 }
@@ -1218,7 +1498,6 @@ void CPU::PHA()
      * MODE           SYNTAX       HEX LEN TIM
      * Implied         PHA         $48  1   3
      */
-    usePHAOpcode = true;
     assert(opcodeAddressModes[currentOpcode] == Implied);
     StackPush(A);
     cycles += opcodeCycles[currentOpcode];
@@ -1232,11 +1511,10 @@ void CPU::PHP()
      * MODE           SYNTAX       HEX LEN TIM
      * Implied         PHP         $08  1   3
      */
-    usePHAOpcode = false;
     assert(opcodeAddressModes[currentOpcode] == Implied);
     //NOTE: Refer it http://forums.nesdev.com/viewtopic.php?f=10&t=10049 
     //they said Both PHP and BRK push the flags with bit 4 true
-    StackPush(P.byte | FLAG_BREAK);
+    StackPush(GetStatus() | FLAG_BREAK);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1251,8 +1529,7 @@ void CPU::PLA()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     A = StackPull();
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1266,11 +1543,10 @@ void CPU::PLP()
      * Implied         PLP         $28  1   4
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
-    P.byte = StackPull();
-    if (usePHAOpcode)
-    {
-        P.bits.B = 0;  
-    }
+    DelayIRQPoll();
+    SetStatus(StackPull());
+    //NOTE: B only exists in the pushed copies of P (PHP, BRK), it is dropped when P is pulled
+    P.bits.B = CLEAR;
     //http://forums.nesdev.com/viewtopic.php?f=3&t=11253
     //NOTE: Make sure that this bit is always set
     P.bits.reserved = SET; 
@@ -1296,12 +1572,11 @@ void CPU::RLA()
     uint8_t value = ReadMemory();
     uint8_t temp = value & 0x80; // save the highest bit for P.C
     value = (value << 1) & 0xFE; // make sure that the lowest bit is equal 0
-    value = value | P.bits.C; // assign P.C to the lowest bit of the result
-    P.bits.C = ((temp & 0x80) == 0x80) ? SET : CLEAR;
-    cpuMemory->Write(lastAddress, value);
+    value = value | flagC; // assign P.C to the lowest bit of the result
+    flagC = ((temp & 0x80) == 0x80) ? SET : CLEAR;
+    WriteBack(value);
     A = A & value;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1321,17 +1596,16 @@ void CPU::ROL()
     uint8_t value = ReadMemory();
     uint8_t temp = value & 0x80; // save the highest bit for P.C
     uint8_t result = (value << 1) & 0xFE; // make sure that the lowest bit is equal 0
-    result = result | P.bits.C; // assign P.C to the lowest bit of the result
-    P.bits.C = ((temp & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (result == 0) ? SET : CLEAR;
+    result = result | flagC; // assign P.C to the lowest bit of the result
+    flagC = ((temp & 0x80) == 0x80) ? SET : CLEAR;
+    SetZN(result);
     switch(opcodeAddressModes[currentOpcode])
     {
         case Accumulator:
             A = result;
             break;
         default:
-            cpuMemory->Write(lastAddress, result);
+            WriteBack(result);
             break;
     }
     cycles += opcodeCycles[currentOpcode];
@@ -1353,17 +1627,16 @@ void CPU::ROR()
     uint8_t value = ReadMemory();
     uint8_t temp = value & 0x01; // save the lowest bit for P.C
     uint8_t result = (value >> 1) & 0x7F; // make sure that the highest bit is equal 0
-    result = result | ((P.bits.C == SET) ? 0x80 : 0x00); // assign P.C to the highest bit of the result
-    P.bits.C = ((temp & 0x01) == 0x01) ? SET : CLEAR;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (result == 0) ? SET : CLEAR;
+    result = result | ((flagC == SET) ? 0x80 : 0x00); // assign P.C to the highest bit of the result
+    flagC = ((temp & 0x01) == 0x01) ? SET : CLEAR;
+    SetZN(result);
     switch(opcodeAddressModes[currentOpcode])
     {
         case Accumulator:
             A = result;
             break;
         default:
-            cpuMemory->Write(lastAddress, result);
+            WriteBack(result);
             break;
     }
     cycles += opcodeCycles[currentOpcode];    
@@ -1388,14 +1661,13 @@ void CPU::RRA()
     uint8_t value = ReadMemory();
     uint8_t temp = value & 0x01; // save the lowest bit for P.C
     value = (value >> 1) & 0x7F; // make sure that the highest bit is equal 0
-    value = value | ((P.bits.C == SET) ? 0x80 : 0x00); // assign P.C to the highest bit of the result
-    P.bits.C = ((temp & 0x01) == 0x01) ? SET : CLEAR;
-    cpuMemory->Write(lastAddress, value);
-    uint16_t result = A + value + P.bits.C;
-    P.bits.V = (((A & 0x80) != (result & 0x80)) && ((value & 0x80) != (result & 0x80))) ? SET : CLEAR;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = ((result & 0xFF) == 0) ? SET : CLEAR;
-    P.bits.C = (result > 0xFF) ? SET : CLEAR;
+    value = value | ((flagC == SET) ? 0x80 : 0x00); // assign P.C to the highest bit of the result
+    flagC = ((temp & 0x01) == 0x01) ? SET : CLEAR;
+    WriteBack(value);
+    uint16_t result = A + value + flagC;
+    flagV = (A ^ result) & (value ^ result) & 0x80;
+    SetZN(uint8_t(result));
+    flagC = (result > 0xFF) ? SET : CLEAR;
     A = (uint8_t)(result & 0xFF);
     cycles += opcodeCycles[currentOpcode];   
 }
@@ -1410,13 +1682,15 @@ void CPU::RTI()
      * Implied        RTI          $40  1   6
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);   
-    P.byte = StackPull();
+    SetStatus(StackPull());
+    P.bits.B = CLEAR;
     //NOTE: Make sure that this bit is always set
     P.bits.reserved = SET; 
     uint16_t lo = StackPull();
     uint16_t hi = StackPull();
     uint16_t address = (hi << 8) | lo;
     PC = address;
+    guestProfiler.Return(SP);
     cycles += opcodeCycles[currentOpcode]; 
 }
 
@@ -1434,6 +1708,7 @@ void CPU::RTS()
     uint16_t hi = StackPull();
     uint16_t address = (hi << 8) | lo;
     PC = address + 1;
+    guestProfiler.Return(SP);
     cycles += opcodeCycles[currentOpcode]; 
 }
 
@@ -1475,12 +1750,11 @@ void CPU::SBC()
      * + Add 1 cycle if page boundary crossed
      */
     uint8_t value = ReadMemory(true);
-    int16_t result = A - value - (1 - P.bits.C);   
+    int16_t result = A - value - (1 - flagC);   
     //Note: Refer http://www.righto.com/2012/12/the-6502-overflow-flag-explained.html for more information 
-    P.bits.V = (((A & 0x80) == 0x80) != ((value & 0x80) == 0x80)) ? SET : CLEAR;
-    P.bits.C = (result >= 0) ? SET : CLEAR;
-    P.bits.N = ((result & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = ((result & 0xFF) == 0) ? SET : CLEAR;
+    flagV = (A ^ value) & (A ^ result) & 0x80;
+    flagC = (result >= 0) ? SET : CLEAR;
+    SetZN(uint8_t(result));
     A = (uint8_t)(result & 0xFF);
     cycles += opcodeCycles[currentOpcode];
 }
@@ -1495,7 +1769,7 @@ void CPU::SEC()
      * Implied        SEC          $38  1   2
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
-    P.bits.C = SET;
+    flagC = SET;
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1523,16 +1797,37 @@ void CPU::SEI()
      * Implied        SEI          $78  1   2
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
+    DelayIRQPoll();
     P.bits.I = SET;
     cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::SHX()
 {
+    /*
+     * AND X register with the high byte of the target address + 1. Store the result in memory
+     * Affects Flags: None
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Absolute,Y  |SHX arg,Y  |$9E| 3 | 5
+     */
+    WriteAddressHigh(X);
+    cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::SHY()
 {
+    /*
+     * AND Y register with the high byte of the target address + 1. Store the result in memory
+     * Affects Flags: None
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Absolute,X  |SHY arg,X  |$9C| 3 | 5
+     */
+    WriteAddressHigh(Y);
+    cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::SLO()
@@ -1553,12 +1848,11 @@ void CPU::SLO()
      */
     uint8_t value = ReadMemory();
     // ASL  
-    P.bits.C = ((value & 0x80) == 0x80) ? SET : CLEAR;
+    flagC = ((value & 0x80) == 0x80) ? SET : CLEAR;
     value = (value << 1) & 0xFE; // make sure that the lowest bit is equal 0
-    cpuMemory->Write(lastAddress, value);
+    WriteBack(value);
     A = A | value;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1579,12 +1873,11 @@ void CPU::SRE()
      * Indirect,Y  |SRE (arg),Y|$53| 2 | 8
      */
     uint8_t value = ReadMemory();
-    P.bits.C = value & 0x01;
+    flagC = value & 0x01;
     value = (value >> 1) & 0x7F; // make sure that the highest bit is equal 0
-    cpuMemory->Write(lastAddress, value);
+    WriteBack(value);
     A = A ^ value;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1636,6 +1929,18 @@ void CPU::STY()
 
 void CPU::TAS()
 {
+    /*
+     * AND X register with accumulator and store result in stack pointer, then AND stack pointer with the high byte of the
+     * target address + 1. Store result in memory
+     * Affects Flags: None
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Absolute,Y  |TAS arg,Y  |$9B| 3 | 5
+     */
+    SP = A & X;
+    WriteAddressHigh(SP);
+    cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::TAX()
@@ -1649,8 +1954,7 @@ void CPU::TAX()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     X = A;
-    P.bits.N = ((X & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (X == 0) ? SET : CLEAR;
+    SetZN(X);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1665,8 +1969,7 @@ void CPU::TAY()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     Y = A;
-    P.bits.N = ((Y & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (Y == 0) ? SET : CLEAR;
+    SetZN(Y);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1681,8 +1984,7 @@ void CPU::TSX()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     X = SP;
-    P.bits.N = ((X & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (X == 0) ? SET : CLEAR;
+    SetZN(X);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1697,8 +1999,7 @@ void CPU::TXA()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     A = X;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 }
 
@@ -1726,11 +2027,25 @@ void CPU::TYA()
      */
     assert(opcodeAddressModes[currentOpcode] == Implied);
     A = Y;
-    P.bits.N = ((A & 0x80) == 0x80) ? SET : CLEAR;
-    P.bits.Z = (A == 0) ? SET : CLEAR;
+    SetZN(A);
     cycles += opcodeCycles[currentOpcode];
 }
 
 void CPU::XAA()
 {
+    /*
+     * Transfer X register to accumulator, then AND accumulator with byte
+     * Affects Flags: N Z
+     *
+     * MODE        |SYNTAX     |HEX|LEN|TIM
+     * ------------|-----------|---|---|---
+     * Immediate   |XAA #arg   |$8B| 2 | 2
+     *
+     * NOTE: The real result is unstable: A is ORed with a constant which depends on the chip and the temperature before the ANDs
+     * Use XAA_MAGIC (the usual value)
+     */
+    uint8_t value = ReadMemory();
+    A = (A | XAA_MAGIC) & X & value;
+    SetZN(A);
+    cycles += opcodeCycles[currentOpcode];
 }
\ No newline at end of file
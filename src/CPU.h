@@ -4,7 +4,15 @@
 #include <stdint.h>
 #include <string>
 
+#include "Platforms.h"
 #include "MemoryCPU.h"
+#include "OpcodeProfiler.h"
+#include "GuestProfiler.h"
+#include "InstructionTrace.h"
+#include "Jit.h"
+#include "DecodeCache.h"
+#include "IdleLoop.h"
+#include "BusClock.h"
 
 enum Interrupt
 {
@@ -13,6 +21,27 @@ enum Interrupt
     InterruptIRQ // APU
 };
 
+// The devices which can hold the IRQ line asserted (see CPU::SetIRQLine)
+enum IRQSource
+{
+    IRQSourceAPU = 0x01,
+    IRQSourceMapper = 0x02
+};
+
+/*
+ * Bits of CPU::pendingEvents. The word is tested once before each instruction, the events are only handled when it isn't 0
+ * - NMI is edge triggered: the PPU latches it when its line is asserted and the CPU clears it when it runs the sequence
+ * - IRQ is level triggered: the bit follows the IRQ line, and the sequence runs while the line is asserted and I is clear
+ * - CLI, SEI and PLP change I after the interrupt poll, so the next poll still sees the previous I (see CPU::PollInterrupt)
+ */
+enum Event
+{
+    EventNMI = 0x01,
+    EventIRQ = 0x02,
+    EventStall = 0x04, // OAM DMA
+    EventDelayedI = 0x08 // The next poll uses delayedI instead of P.I
+};
+
 union ProcessorStatus
 {
     uint8_t byte;
@@ -86,16 +115,47 @@ enum AddressMode
     ZeroPageY
 };
 
+// Number of bytes of an instruction, opcode included
+inline uint8_t GetInstructionSize(uint8_t addressMode)
+{
+    switch (addressMode)
+    {
+        case Accumulator:
+        case Implied:
+            return 1;
+        case Absolute:
+        case AbsoluteX:
+        case AbsoluteY:
+        case Indirect:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
 class CPU
 {
     friend class PPU;
     public:
         CPU(Memory *cpuMemory);
+        ~CPU();
         // return the number of cycles CPU
         uint8_t Step();
+        // Number of instructions executed and cycles stalled by the OAM DMA since power up (see Stats.h)
+        uint64_t GetInstructionCount();
+        uint64_t GetStallCycleCount();
+        // The CPU is at the start of an idle loop iteration and can skip it (see IdleLoop.h)
+        bool IsIdle();
+        CPUIdleLoop& GetIdleLoop();
+        // Account for iterations of the idle loop that the console didn't run
+        void SkipIdleIterations(uint32_t iterations);
+        // The exact status register (P), built from the lazy flags
+        uint8_t GetStatus();
+        void SetStatus(uint8_t status);
+        // Assert or release the IRQ line of a device
+        void SetIRQLine(IRQSource source, bool isAsserted);
 
     private:
-        bool usePHAOpcode;
         /*
          * Accumulator: The accumulator is an 8-bit register which stores the results of arithmetic and logic
          * operations. The accumulator can also be set to a value retrieved from memory
@@ -126,11 +186,25 @@ class CPU
          */
         uint16_t PC;
         // The status register contains a number of single bit flags which are set or cleared when instructions are executed
+        // Only I, D, B and the reserved bit are kept in P. N, V, Z and C are the lazy flags below (see GetStatus)
         ProcessorStatus P;
+        /*
+         * Lazy flags: the instructions only store the values the flags come from, and the status byte is built when P is
+         * observed (PHP, BRK, NMI/IRQ, the trace and the tests)
+         * - N is bit 7 of flagN and Z is set when flagZ is 0. Both are the last result, except after BIT and SetStatus
+         * - V is set when flagV isn't 0
+         * - C is flagC (SET or CLEAR)
+         */
+        uint8_t flagN;
+        uint8_t flagZ;
+        uint8_t flagV;
+        uint8_t flagC;
         // Number of cycles
         uint64_t cycles;
         // Use for suspending CPU (after writting DMA)
         uint16_t stall; // number of cycles to stall
+        uint64_t instructionCount;
+        uint64_t stallCycleCount;
         // CPU memory
         Memory *cpuMemory;
         /*
@@ -138,12 +212,26 @@ class CPU
          * We need this value to access the opcodeAddressModes or opcodeCycles in Opcode implementation function
          */
         uint8_t currentOpcode;
+        // The operand bytes of the current opcode (little endian), fetched by the decode cache. PC is already after them
+        uint16_t operand;
         /*
          * Contain the last address that we read value from the memory 
          * Used to write the value back to this address in ASL, LSR, ROL opcode
          */
         uint16_t lastAddress;
-        Interrupt interrupt;
+        // Events to handle before the next instruction (see Event)
+        uint8_t pendingEvents;
+        // The devices holding the IRQ line asserted (see IRQSource)
+        uint8_t irqLines;
+        // I before the last CLI, SEI or PLP
+        uint8_t delayedI;
+        CPUProfiler profiler;
+        CPUGuestProfiler guestProfiler;
+        CPUTrace tracer;
+        CPUJit jit;
+        DecodeCache decodeCache;
+        CPUIdleLoop idleLoop;
+        CPUBusClock busClock;
         // Opcodes table
         std::string opcodeNames[256] = 
         {
@@ -254,16 +342,31 @@ class CPU
         void WriteAddressZeroPage(uint8_t value);
         void WriteAddressZeroPageX(uint8_t value);
         void WriteAddressZeroPageY(uint8_t value);
+        // AXA, SHX, SHY, TAS: write value & (high byte of the base address + 1)
+        void WriteAddressHigh(uint8_t value);
+        // Bus: every access is 1 CPU cycle (see BusClock.h)
+        uint8_t Read(uint16_t address);
+        void Write(uint16_t address, uint8_t value);
+        // Read-modify-write: the unmodified value is written back to lastAddress first, then the result
+        void WriteBack(uint8_t value);
         // Memory
         void StackPush(uint8_t value);  
         uint8_t StackPull();
         // Interrupt
         // NMI will be generated by PPU at the start of the VBI
         void TriggerNMI();
+        // Suspend the CPU for the given number of cycles (OAM DMA)
+        void Stall(uint16_t cycles);
+        // The interrupt sequence to run before the next instruction
+        Interrupt PollInterrupt();
+        // Remember I for the next poll before CLI, SEI and PLP change it
+        void DelayIRQPoll();
         void NMI();
         void IRQ();
         // Helper functions
         void Branch(uint8_t offset);
+        // Set N and Z from the result of an instruction
+        void SetZN(uint8_t result);
         // Opcodes
         void ADC();
         void ALR();
@@ -357,4 +460,74 @@ class CPU
         void XAA();
 };
 
+inline bool CPU::IsIdle()
+{
+    return idleLoop.IsIdle() && (pendingEvents == 0);
+}
+
+inline void CPU::TriggerNMI()
+{
+    pendingEvents |= EventNMI;
+}
+
+inline void CPU::Stall(uint16_t cycles)
+{
+    stall += cycles;
+    pendingEvents |= EventStall;
+}
+
+inline void CPU::DelayIRQPoll()
+{
+    delayedI = P.bits.I;
+    pendingEvents |= EventDelayedI;
+}
+
+inline CPUIdleLoop& CPU::GetIdleLoop()
+{
+    return idleLoop;
+}
+
+inline uint8_t CPU::GetStatus()
+{
+    uint8_t status = P.byte & (FLAG_INTERRUPT | FLAG_DECIMAL | FLAG_BREAK | FLAG_CONSTANT);
+    status |= flagN & FLAG_NEGATIVE;
+    status |= (flagV != 0) ? FLAG_OVERFLOW : 0;
+    status |= (flagZ == 0) ? FLAG_ZERO : 0;
+    status |= flagC;
+    return status;
+}
+
+inline void CPU::SetStatus(uint8_t status)
+{
+    P.byte = status;
+    flagN = status;
+    flagV = status & FLAG_OVERFLOW;
+    flagZ = ((status & FLAG_ZERO) == FLAG_ZERO) ? 0 : 1;
+    flagC = status & FLAG_CARRY;
+}
+
+inline uint8_t CPU::Read(uint16_t address)
+{
+    busClock.Tick();
+    return cpuMemory->Read(address);
+}
+
+inline void CPU::Write(uint16_t address, uint8_t value)
+{
+    busClock.Tick();
+    cpuMemory->Write(address, value);
+}
+
+inline void CPU::WriteBack(uint8_t value)
+{
+    busClock.Tick(); // Dummy write of the unmodified value
+    Write(lastAddress, value);
+}
+
+inline void CPU::SetZN(uint8_t result)
+{
+    flagN = result;
+    flagZ = result;
+}
+
 #endif //_CPU_H_
\ No newline at end of file
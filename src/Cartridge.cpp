@@ -1,11 +1,17 @@
 #include "Cartridge.h"
 #include <fstream> 
+#include <string.h>
 #include "Platforms.h"
+#include "RomDatabase.h"
 
 Cartridge::Cartridge()
 {
     prgRom = NULL;
     chrRomRam = NULL;
+    isCHRRam = false;
+    hasBattery = false;
+    sram = NULL;
+    isSRAMFileBacked = false;
 }
 
 Cartridge::~Cartridge()
@@ -24,6 +30,10 @@ Cartridge::~Cartridge()
     }
     SAFE_DEL_ARRAY(prgRom);
     SAFE_DEL_ARRAY(chrRomRam);
+    if (!isSRAMFileBacked)
+    {
+        SAFE_DEL_ARRAY(sram);
+    }
 }
 
 bool Cartridge::LoadNESFile(std::string fileName)
@@ -56,7 +66,7 @@ bool Cartridge::LoadNESFile(std::string fileName)
         if (header.numCHR == 0)
         {
             // If this value is equal 0. It mean we have 8192 byte charactor RAM pages instead of charactor ROM pages
-            isCHRRam = true; 
+            isCHRRam = true;
             chrRomRam = new uint8_t*[1];
             chrRomRam[0] = new uint8_t[8192]; //8KB
 
@@ -84,7 +94,50 @@ bool Cartridge::LoadNESFile(std::string fileName)
         mapper |= (header.romControlByte1.bits.mapperNumber & 0x0F);
         mirroring = (header.romControlByte1.bits.mirroring == CLEAR) ? Horizontal : Vertical;
         mirroring = (header.romControlByte1.bits.fourScreenMode == SET) ? FourScreen : mirroring;
+        hasBattery = (header.romControlByte1.bits.batteryBackedPresent == SET);
         is.close();
+        // Correct the header with the ROM database
+        uint32_t crc = 0;
+        for (uint8_t i = 0; i < header.numPRG; ++i)
+        {
+            crc = RomDatabase::CRC32(crc, prgRom[i], 16384);
+        }
+        for (uint8_t i = 0; !isCHRRam && (i < header.numCHR); ++i)
+        {
+            crc = RomDatabase::CRC32(crc, chrRomRam[i], 8192);
+        }
+        const RomInfo *romInfo = RomDatabase::Find(crc);
+        if (romInfo != NULL)
+        {
+            if ((romInfo->mapper != mapper) || (romInfo->mirroring != mirroring) || (romInfo->hasBattery != hasBattery))
+            {
+                LOGI("Bad header (CRC32 %08X): mapper %d -> %d, mirroring %d -> %d, battery %d -> %d", crc,
+                     mapper, romInfo->mapper, mirroring, romInfo->mirroring, hasBattery, romInfo->hasBattery);
+            }
+            mapper = romInfo->mapper;
+            mirroring = romInfo->mirroring;
+            hasBattery = romInfo->hasBattery;
+        }
+        // SRAM
+        if (hasBattery)
+        {
+            // The save file has the same name as the NES file with .sav extension
+            std::string saveFileName = fileName;
+            size_t slash = saveFileName.find_last_of('/');
+            size_t extension = saveFileName.find_last_of('.');
+            if ((extension != std::string::npos) && ((slash == std::string::npos) || (extension > slash)))
+            {
+                saveFileName.erase(extension);
+            }
+            saveFileName += ".sav";
+            sram = batteryRAM.Open(saveFileName, 0x2000);
+            isSRAMFileBacked = (sram != NULL);
+        }
+        if (sram == NULL)
+        {
+            sram = new uint8_t[0x2000];
+            memset(sram, 0, 0x2000);
+        }
     }
     else
     {
@@ -94,45 +147,53 @@ bool Cartridge::LoadNESFile(std::string fileName)
     return true;
 }
 
-uint8_t Cartridge::ReadPRG(uint8_t bank, uint16_t address)
+uint8_t Cartridge::GetMapperNumber()
 {
-    return prgRom[bank][address];
+    return mapper;
 }
 
-uint8_t Cartridge::ReadCHR(uint8_t bank, uint16_t address)
+uint8_t Cartridge::GetNumPRG()
 {
-    return chrRomRam[bank][address];
+    return header.numPRG;
 }
 
-void Cartridge::WriteCHR(uint8_t bank, uint16_t address, uint8_t value)
+uint8_t Cartridge::GetNumCHR()
 {
-    if (isCHRRam)
-    {
-        chrRomRam[bank][address] = value;  
-    }
+    // CHR-RAM has only 1 bank
+    return isCHRRam ? 1 : header.numCHR;
 }
 
-uint8_t Cartridge::ReadSRAM(uint16_t address)
+bool Cartridge::HasCHRRam()
 {
-    return sram[address];
+    return isCHRRam;
 }
 
-void Cartridge::WriteSRAM(uint16_t address, uint8_t value)
+uint8_t* Cartridge::GetPRGBank(uint8_t bank)
 {
-    sram[address] = value;
+    return prgRom[bank];
 }
 
-uint8_t Cartridge::GetMapperNumber()
+uint8_t* Cartridge::GetCHRBank(uint8_t bank)
 {
-    return mapper;
+    return chrRomRam[bank];
 }
 
-uint8_t Cartridge::GetNumPRG()
+Mirroring Cartridge::GetMirroring()
 {
-    return header.numPRG;
+    return mirroring;
 }
 
-Mirroring Cartridge::GetMirroring()
+bool Cartridge::HasBattery()
 {
-    return mirroring;
+    return hasBattery;
+}
+
+bool Cartridge::IsSRAMFileBacked()
+{
+    return isSRAMFileBacked;
+}
+
+void Cartridge::FlushSRAM()
+{
+    batteryRAM.Flush();
 }
\ No newline at end of file
@@ -3,13 +3,15 @@
 
 #include <stdint.h>
 #include <string>
+#include "BatteryRAM.h"
 
 enum Mirroring 
 { 
     Horizontal = 0,
     Vertical,
     FourScreen,
-    SingleScreen
+    SingleScreenLower, // All nametables refer to $2000
+    SingleScreenUpper // All nametables refer to $2400
 };
 
 struct NESFileHeader
@@ -85,7 +87,20 @@ class Cartridge
         void WriteSRAM(uint16_t address, uint8_t value);
         uint8_t GetMapperNumber();
         uint8_t GetNumPRG();
+        uint8_t GetNumCHR();
+        bool HasCHRRam();
+        // Return the pointer to a 16KB PRG-ROM bank/8KB CHR-ROM/RAM bank. Used by mappers that switch banks by pointers
+        uint8_t* GetPRGBank(uint8_t bank);
+        uint8_t* GetCHRBank(uint8_t bank);
+        // Return the pointer to the 8KB SRAM ($6000-$7FFF)
+        uint8_t* GetSRAM();
         Mirroring GetMirroring();
+        // The header (or the ROM database) says that the SRAM is battery-backed
+        bool HasBattery();
+        // The SRAM is the mapped save file. False without battery, or when the save file can't be mapped (see BatteryRAM::Open)
+        bool IsSRAMFileBacked();
+        // Write the battery-backed SRAM to the save file
+        void FlushSRAM();
     private:
         NESFileHeader header;
         uint8_t **prgRom;
@@ -93,7 +108,48 @@ class Cartridge
         Mirroring mirroring;
         uint8_t mapper;
         bool isCHRRam;
-        uint8_t sram[0x2000];
+        bool hasBattery;
+        /*
+         * $6000-$7FFF: 8KB SRAM. If the cartridge has a battery, sram points to the mapped save file (see BatteryRAM)
+         * otherwise it is a plain array that is lost when the game is closed
+         */
+        uint8_t *sram;
+        bool isSRAMFileBacked;
+        BatteryRAM batteryRAM;
 };
 
+// PRG/CHR/SRAM accesses are on the hot path of the CPU/PPU memory so they are inlined
+inline uint8_t Cartridge::ReadPRG(uint8_t bank, uint16_t address)
+{
+    return prgRom[bank][address];
+}
+
+inline uint8_t Cartridge::ReadCHR(uint8_t bank, uint16_t address)
+{
+    return chrRomRam[bank][address];
+}
+
+inline void Cartridge::WriteCHR(uint8_t bank, uint16_t address, uint8_t value)
+{
+    if (isCHRRam)
+    {
+        chrRomRam[bank][address] = value;  
+    }
+}
+
+inline uint8_t Cartridge::ReadSRAM(uint16_t address)
+{
+    return sram[address];
+}
+
+inline void Cartridge::WriteSRAM(uint16_t address, uint8_t value)
+{
+    sram[address] = value;
+}
+
+inline uint8_t* Cartridge::GetSRAM()
+{
+    return sram;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "Console.h"
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include "MapperRegistry.h"
+#include "Platforms.h"
+#include "Timeline.h"
+
+Console::Console()
+{
+    cartridge = NULL;
+    mapper = NULL;
+    memoryPPU = NULL;
+    ppu = NULL;
+    memoryCPU = NULL;
+    cpu = NULL;
+    controller = NULL;
+    ppuDotCount = 0;
+    isTurbo = false;
+    pipeline = NULL;
+}
+
+Console::~Console()
+{
+    if (pipeline != NULL)
+    {
+        // The PPU thread may use the CPU
+        pipeline->Stop();
+    }
+#ifdef _WATCH_MEMORY_
+    if ((memoryCPU != NULL) && (memoryPPU != NULL))
+    {
+        memoryCPU->GetWatch().WriteHeatmap(WATCH_CPU_HEATMAP_FILE);
+        memoryPPU->GetWatch().WriteHeatmap(WATCH_PPU_HEATMAP_FILE);
+    }
+#endif
+    SAFE_DEL(cpu);
+    SAFE_DEL(memoryCPU);
+    SAFE_DEL(ppu);
+    SAFE_DEL(memoryPPU);
+    SAFE_DEL(controller);
+    SAFE_DEL(mapper);
+    SAFE_DEL(cartridge);
+}
+
+bool Console::LoadNESFile(std::string fileName)
+{
+    cartridge = new Cartridge();
+    if (cartridge->LoadNESFile(fileName) == false)
+    {
+        LOGI("Invalid NES file");
+        return false;
+    }
+    mapper = Mapper::GetMapper(cartridge);
+    if (mapper == NULL)
+    {
+        LOGI("We haven't supported this mapper");
+        return false;
+    }
+    memoryPPU = MapperRegistry::CreateMemoryPPU(cartridge->GetMapperNumber());
+    memoryPPU->SetMapper(mapper);
+    ppu = new PPU(memoryPPU);
+
+    memoryCPU = MapperRegistry::CreateMemoryCPU(cartridge->GetMapperNumber());
+    memoryCPU->SetMapper(mapper);
+    memoryCPU->SetPPU(ppu);
+
+    controller = new Controller();
+    memoryCPU->SetController(controller);
+
+    cpu = new CPU(memoryCPU);
+    ppu->SetCPU(cpu);
+    pipeline = &static_cast<MemoryCPU *>(memoryCPU)->GetPipeline();
+    pipeline->Start(ppu);
+#ifdef _WATCH_MEMORY_
+    MemoryWatch::LoadWatchpoints(WATCH_FILE, memoryCPU->GetWatch(), memoryPPU->GetWatch());
+#endif
+    return true;
+}
+
+void Console::StepSeconds(double seconds)
+{
+    TIMELINE_SCOPE("Emulate", "Console");
+    int32_t cycles = uint32_t(CPU_FREQUENCY * seconds);
+    while ((cycles > 0) && !IsBreakRequested())
+    {
+        cycles -= Step();
+    }
+}
+
+uint8_t Console::SkipIdleLoop()
+{
+    CPUIdleLoop &idleLoop = cpu->GetIdleLoop();
+    uint32_t iterationCycles = idleLoop.GetIterationCycles();
+    // The skipped time must end before the PPU raises an NMI, and fit in the cycles returned by Step
+    // The idle loop reads the PPU state
+    pipeline->BeginAccess();
+    uint32_t maxCycles = std::min(ppu->GetCyclesUntilVBlank() / 3, uint32_t(0xFF));
+    uint32_t cycles = 0;
+    uint32_t iterations = 0;
+    while ((iterationCycles > 0) && (cycles + iterationCycles <= maxCycles))
+    {
+        if (idleLoop.ReadsStatus() && (ppu->GetStatus() != idleLoop.GetStatus()))
+        {
+            // The loop would read another value and may leave
+            break;
+        }
+        for (uint32_t i = 0; i < iterationCycles * 3; ++i)
+        {
+            ppu->Step();
+        }
+        cycles += iterationCycles;
+        ++iterations;
+    }
+    cpu->SkipIdleIterations(iterations);
+    pipeline->EndAccess(cycles * 3);
+    ppuDotCount += cycles * 3;
+    return uint8_t(cycles);
+}
+
+void Console::StepFrame()
+{
+    TIMELINE_SCOPE("Emulate frame", "Console");
+    uint32_t frame = GetFrameCount();
+    while ((frame == GetFrameCount()) && !IsBreakRequested())
+    {
+        Step();
+    }
+}
+
+void Console::StepHostSeconds(double seconds)
+{
+    TIMELINE_SCOPE("Emulate turbo", "Console");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        StepFrame();
+    }
+    while ((std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds) && !IsBreakRequested());
+}
+
+void Console::SetTurbo(bool isTurbo)
+{
+    this->isTurbo = isTurbo;
+    pipeline->BeginAccess();
+    ppu->SetRenderInterval(isTurbo ? TURBO_RENDER_INTERVAL : 1);
+    pipeline->EndAccess();
+}
+
+bool Console::IsTurbo()
+{
+    return isTurbo;
+}
+
+void Console::Resume()
+{
+    memoryCPU->GetWatch().Resume();
+    memoryPPU->GetWatch().Resume();
+}
+
+void Console::FlushSRAM()
+{
+    cartridge->FlushSRAM();
+}
+
+StatsCounters Console::GetCounters()
+{
+    StatsCounters counters;
+    counters.frames = GetFrameCount();
+    counters.instructions = cpu->GetInstructionCount();
+    counters.ppuDots = ppuDotCount;
+    counters.dmaStallCycles = cpu->GetStallCycleCount();
+    return counters;
+}
+
+uint32_t Console::GetFrameCount()
+{
+    return pipeline->IsRunning() ? pipeline->GetFrameCount() : ppu->GetFrameCount();
+}
+
+uint32_t Console::CopyFrame(uint8_t buffer[SCREEN_HEIGHT][SCREEN_WIDTH], uint32_t frameCount)
+{
+    // The PPU thread swaps frontBuffer at the end of each frame
+    pipeline->BeginAccess();
+    if (ppu->GetRenderedFrameCount() != frameCount)
+    {
+        frameCount = ppu->GetRenderedFrameCount();
+        memcpy(buffer, ppu->frontBuffer, SCREEN_HEIGHT * SCREEN_WIDTH);
+    }
+    pipeline->EndAccess();
+    return frameCount;
+}
+
+Cartridge* Console::GetCartridge()
+{
+    return cartridge;
+}
+
+CPU* Console::GetCPU()
+{
+    return cpu;
+}
+
+PPU* Console::GetPPU()
+{
+    return ppu;
+}
+
+Controller* Console::GetController()
+{
+    return controller;
+}
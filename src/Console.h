@@ -0,0 +1,99 @@
+#ifndef _CONSOLE_H_
+#define _CONSOLE_H_
+
+#include <stdint.h>
+#include <string>
+#include "Cartridge.h"
+#include "Mapper.h"
+#include "Memory.h"
+#include "PPU.h"
+#include "CPU.h"
+#include "Controller.h"
+#include "Stats.h"
+
+/*
+ * The console wires the NES components together and drives them: 1 CPU cycle = 3 PPU cycles
+ * It doesn't know anything about the window, so it can be used headless by the tests and the benchmarks
+ */
+class Console
+{
+    public:
+        Console();
+        ~Console();
+        bool LoadNESFile(std::string fileName);
+        // Run 1 CPU instruction and the PPU for the same time. Return the number of CPU cycles
+        uint8_t Step();
+        // Run for the given time, or until a watchpoint breaks (see MemoryWatch.h)
+        void StepSeconds(double seconds);
+        // Run until the PPU finishes the current frame, or until a watchpoint breaks
+        void StepFrame();
+        // Run whole frames for the given host time, or until a watchpoint breaks
+        void StepHostSeconds(double seconds);
+        // Fast forward: the frontend uses StepHostSeconds and the PPU outputs 1 frame out of TURBO_RENDER_INTERVAL
+        void SetTurbo(bool isTurbo);
+        bool IsTurbo();
+        // A watchpoint has stopped the emulation. Always false when _WATCH_MEMORY_ is not defined
+        bool IsBreakRequested();
+        void Resume();
+        // Write the battery-backed SRAM to the save file
+        void FlushSRAM();
+        // Performance counters since power up. Must be called from the emulation thread
+        StatsCounters GetCounters();
+        // Frames finished by the PPU, also when the PPU thread is behind the CPU (see PPUPipeline.h)
+        uint32_t GetFrameCount();
+        // Copy the last frame output by the PPU to buffer unless it is already frame number frameCount (see PPU::GetRenderedFrameCount)
+        // Return the number of the frame in buffer. The frontend reads the frames through it, never from the PPU thread directly
+        uint32_t CopyFrame(uint8_t buffer[SCREEN_HEIGHT][SCREEN_WIDTH], uint32_t frameCount);
+        Cartridge* GetCartridge();
+        CPU* GetCPU();
+        PPU* GetPPU();
+        Controller* GetController();
+
+    private:
+        Cartridge *cartridge;
+        Mapper *mapper;
+        Memory *memoryPPU;
+        PPU *ppu;
+        Memory *memoryCPU;
+        CPU *cpu;
+        Controller *controller;
+        uint64_t ppuDotCount;
+        bool isTurbo;
+        PPUPipelinePolicy *pipeline;
+
+        // Run the PPU for the iterations of the idle loop that can be skipped. Return the number of CPU cycles (see IdleLoop.h)
+        uint8_t SkipIdleLoop();
+};
+
+inline uint8_t Console::Step()
+{
+    if (cpu->IsIdle())
+    {
+        uint8_t skippedCycles = SkipIdleLoop();
+        if (skippedCycles > 0)
+        {
+            return skippedCycles;
+        }
+    }
+    uint8_t cpuCycles = cpu->Step();
+    uint16_t ppuCycles = uint16_t(cpuCycles) * 3;
+#if defined(_PARALLEL_PPU_)
+    // The PPU thread runs them (see PPUPipeline.h)
+    pipeline->Run(ppuCycles);
+#elif !defined(_CYCLE_ACCURATE_)
+    for (uint16_t i = 0; i < ppuCycles; ++i)
+    {
+        ppu->Step();
+    }
+#endif
+    // In the cycle accurate mode the CPU has already run the PPU on its bus cycles (see BusClock.h)
+    ppuDotCount += ppuCycles;
+    return cpuCycles;
+}
+
+inline bool Console::IsBreakRequested()
+{
+    return memoryCPU->GetWatch().IsBreakRequested() || memoryPPU->GetWatch().IsBreakRequested();
+}
+
+#endif //_CONSOLE_H_
@@ -0,0 +1,104 @@
+#include "DecodeCache.h"
+#include <string.h>
+#include "MemoryCPU.h"
+#include "CPU.h"
+
+DecodeCache::DecodeCache()
+{
+    memory = NULL;
+    mapper = NULL;
+    memset(opcodeSizes, 1, sizeof(opcodeSizes));
+    windowInstructions[0] = NULL;
+    windowInstructions[1] = NULL;
+    prgBankVersion = 0;
+    memset(ramInstructions, 0, sizeof(ramInstructions));
+    memset(ramCode, 0, sizeof(ramCode));
+    ramInstructionCount = 0;
+    cacheRAM = false;
+    memset(&uncached, 0, sizeof(uncached));
+}
+
+DecodeCache::~DecodeCache()
+{
+    MemoryCPU *memoryCPU = dynamic_cast<MemoryCPU *>(memory);
+    if (memoryCPU != NULL)
+    {
+        memoryCPU->SetDecodeCache(NULL);
+    }
+}
+
+void DecodeCache::SetMemory(Memory *memory)
+{
+    this->memory = memory;
+    mapper = memory->GetMapper();
+    if (mapper != NULL)
+    {
+        SelectWindows();
+    }
+    // The RAM instructions are only cached when the RAM writes are reported
+    MemoryCPU *memoryCPU = dynamic_cast<MemoryCPU *>(memory);
+    if (memoryCPU != NULL)
+    {
+        memoryCPU->SetDecodeCache(this);
+        cacheRAM = true;
+    }
+}
+
+void DecodeCache::SetAddressModes(const uint8_t *addressModes)
+{
+    for (uint16_t opcode = 0; opcode < 256; ++opcode)
+    {
+        opcodeSizes[opcode] = GetInstructionSize(addressModes[opcode]);
+    }
+}
+
+void DecodeCache::SelectWindows()
+{
+    prgBankVersion = mapper->GetPRGBankVersion();
+    for (uint8_t window = 0; window < 2; ++window)
+    {
+        std::vector<Instruction> &instructions = bankInstructions[mapper->GetPRGBankNumber(0x8000 + window * 0x4000)];
+        if (instructions.empty())
+        {
+            Instruction none = {0, 0, 0};
+            instructions.resize(0x4000, none);
+        }
+        windowInstructions[window] = &instructions[0];
+    }
+}
+
+void DecodeCache::Decode(uint16_t PC, Instruction &instruction)
+{
+    instruction.opcode = memory->Read(PC);
+    instruction.size = opcodeSizes[instruction.opcode];
+    uint16_t lo = (instruction.size > 1) ? memory->Read(PC + 1) : 0;
+    uint16_t hi = (instruction.size > 2) ? memory->Read(PC + 2) : 0;
+    instruction.operand = (hi << 8) | lo;
+}
+
+const DecodeCache::Instruction& DecodeCache::FetchRAM(uint16_t PC)
+{
+    Instruction &instruction = ramInstructions[PC & 0x07FF];
+    if (instruction.size == 0)
+    {
+        uint8_t size = opcodeSizes[memory->Read(PC)];
+        if ((PC + size > 0x2000) || !cacheRAM)
+        {
+            // The operand is in the I/O registers or the RAM writes aren't reported
+            return FetchUncached(PC);
+        }
+        Decode(PC, instruction);
+        for (uint16_t i = 0; i < instruction.size; ++i)
+        {
+            ++ramCode[(PC + i) & 0x07FF];
+        }
+        ++ramInstructionCount;
+    }
+    return instruction;
+}
+
+const DecodeCache::Instruction& DecodeCache::FetchUncached(uint16_t PC)
+{
+    Decode(PC, uncached);
+    return uncached;
+}
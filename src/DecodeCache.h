@@ -0,0 +1,123 @@
+#ifndef _DECODE_CACHE_H_
+#define _DECODE_CACHE_H_
+
+#include <stdint.h>
+#include <vector>
+#include "Memory.h"
+
+/*
+ * Cache of the decoded instructions (opcode, operand and length) so CPU::Step doesn't fetch and decode them again through the bus
+ * - PRG-ROM instructions are keyed by (16KB PRG bank, offset in the bank). The cache follows the bank switches with the PRG bank
+ *   version of the mapper (see Mapper::GetPRGBankVersion): the content of a bank never changes, so its instructions stay valid
+ *   and are used again when the bank comes back
+ * - Internal RAM instructions are keyed by their address in the 2KB RAM. MemoryCPU reports the RAM writes and a write to a byte
+ *   of a cached instruction drops it
+ * - The other instructions (SRAM, instructions crossing the end of a PRG window or of the RAM) are decoded again every time
+ * The operand fetches of a cached instruction don't go through the bus, so the memory watch only counts them once
+ */
+class DecodeCache
+{
+    public:
+        struct Instruction
+        {
+            uint16_t operand; // Little endian operand bytes
+            uint8_t opcode;
+            uint8_t size; // 1-3 bytes, 0 if not decoded
+        };
+        DecodeCache();
+        ~DecodeCache();
+        void SetMemory(Memory *memory);
+        // Address mode of each opcode (see AddressMode in CPU.h). Must be set before the first fetch
+        void SetAddressModes(const uint8_t *addressModes);
+        const Instruction& Fetch(uint16_t PC);
+        // Called by MemoryCPU when address ($0000-$07FF) of the internal RAM is written
+        void WriteRAM(uint16_t address);
+        // Drop every RAM instruction. Used when the RAM is written without the bus (see Jit.h)
+        void InvalidateRAM();
+
+    private:
+        Memory *memory;
+        Mapper *mapper;
+        uint8_t opcodeSizes[256];
+        // Per 16KB PRG bank: the instructions of the bank, allocated when the bank first runs code
+        std::vector<Instruction> bankInstructions[256];
+        // Instructions of the banks mapped at $8000-$BFFF and $C000-$FFFF for prgBankVersion of the mapper
+        Instruction *windowInstructions[2];
+        uint32_t prgBankVersion;
+        Instruction ramInstructions[0x800];
+        // Number of cached RAM instructions covering each RAM byte
+        uint8_t ramCode[0x800];
+        uint32_t ramInstructionCount;
+        bool cacheRAM;
+        // Instruction that can't be cached
+        Instruction uncached;
+
+        void SelectWindows();
+        void Decode(uint16_t PC, Instruction &instruction);
+        const Instruction& FetchRAM(uint16_t PC);
+        const Instruction& FetchUncached(uint16_t PC);
+};
+
+inline const DecodeCache::Instruction& DecodeCache::Fetch(uint16_t PC)
+{
+    if ((PC >= 0x8000) && (mapper != NULL))
+    {
+        if (mapper->GetPRGBankVersion() != prgBankVersion)
+        {
+            SelectWindows();
+        }
+        uint16_t offset = PC & 0x3FFF;
+        Instruction &instruction = windowInstructions[(PC >> 14) & 0x01][offset];
+        if (instruction.size == 0)
+        {
+            if (offset + opcodeSizes[memory->Read(PC)] > 0x4000)
+            {
+                // The operand is in the other window, which can be switched independently
+                return FetchUncached(PC);
+            }
+            Decode(PC, instruction);
+        }
+        return instruction;
+    }
+    if (PC < 0x2000)
+    {
+        return FetchRAM(PC);
+    }
+    return FetchUncached(PC);
+}
+
+inline void DecodeCache::WriteRAM(uint16_t address)
+{
+    if (ramCode[address] != 0)
+    {
+        // The instructions starting at address and at the 2 bytes before may cover address
+        for (uint16_t i = 0; i < 3; ++i)
+        {
+            Instruction &instruction = ramInstructions[(address - i) & 0x07FF];
+            if (instruction.size > i)
+            {
+                for (uint16_t j = 0; j < instruction.size; ++j)
+                {
+                    --ramCode[(address - i + j) & 0x07FF];
+                }
+                instruction.size = 0;
+                --ramInstructionCount;
+            }
+        }
+    }
+}
+
+inline void DecodeCache::InvalidateRAM()
+{
+    if (ramInstructionCount != 0)
+    {
+        for (uint16_t address = 0; address < 0x800; ++address)
+        {
+            ramInstructions[address].size = 0;
+            ramCode[address] = 0;
+        }
+        ramInstructionCount = 0;
+    }
+}
+
+#endif //_DECODE_CACHE_H_
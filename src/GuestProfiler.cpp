@@ -0,0 +1,124 @@
+#include "GuestProfiler.h"
+#include <stdio.h>
+#include <algorithm>
+
+// Frames deeper than this are dropped. A game that never returns from its subroutines can't grow the stack forever
+#define MAX_STACK_DEPTH 64
+
+GuestProfiler::GuestProfiler()
+{
+    memory = NULL;
+    nextSample = 0;
+    numSamples = 0;
+}
+
+void GuestProfiler::SetMemory(Memory *memory)
+{
+    this->memory = memory;
+}
+
+uint8_t GuestProfiler::GetBank(uint16_t address)
+{
+    if ((address < 0x8000) || (memory == NULL) || (memory->GetMapper() == NULL))
+    {
+        // RAM/SRAM
+        return 0;
+    }
+    return memory->GetMapper()->GetPRGBankNumber(address);
+}
+
+std::string GuestProfiler::GetName(uint16_t address, uint8_t bank)
+{
+    if (memory != NULL)
+    {
+        const uint16_t vectors[] = {RESET_VECTOR_LOW, NMI_VECTOR_LOW, IRQ_VECTOR_LOW};
+        const char *names[] = {"reset", "nmi", "irq"};
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            if (address == ((memory->Read(vectors[i] + 1) << 8) | memory->Read(vectors[i])))
+            {
+                return names[i];
+            }
+        }
+    }
+    char name[16];
+    sprintf(name, "%02X_%04X", bank, address);
+    return name;
+}
+
+void GuestProfiler::Call(uint16_t target, uint8_t sp)
+{
+    if (stack.size() < MAX_STACK_DEPTH)
+    {
+        Frame frame;
+        frame.address = target;
+        frame.bank = GetBank(target);
+        frame.sp = sp;
+        stack.push_back(frame);
+    }
+}
+
+void GuestProfiler::Return(uint8_t sp)
+{
+    // The stack grows down: after the matching return the stack pointer is back to the value before the call
+    while (!stack.empty() && (stack.back().sp <= sp))
+    {
+        stack.pop_back();
+    }
+}
+
+void GuestProfiler::Report(const char *foldedFileName, const char *hotspotFileName, const std::string *opcodeNames)
+{
+    FILE *file = fopen(foldedFileName, "w");
+    if (file == NULL)
+    {
+        LOGI("Can't write the guest profile to %s", foldedFileName);
+        return;
+    }
+    for (std::map<std::string, uint32_t>::iterator it = stacks.begin(); it != stacks.end(); ++it)
+    {
+        fprintf(file, "%s %u\n", it->first.c_str(), it->second);
+    }
+    fclose(file);
+
+    file = fopen(hotspotFileName, "w");
+    if (file == NULL)
+    {
+        LOGI("Can't write the guest hot spots to %s", hotspotFileName);
+        return;
+    }
+    struct Hotspot
+    {
+        uint32_t count;
+        uint8_t bank;
+        uint16_t pc;
+        bool operator<(const Hotspot &other) const
+        {
+            return count > other.count;
+        }
+    };
+    std::vector<Hotspot> hotspots;
+    for (uint16_t bank = 0; bank < 256; ++bank)
+    {
+        for (uint32_t pc = 0; pc < histograms[bank].counts.size(); ++pc)
+        {
+            if (histograms[bank].counts[pc] > 0)
+            {
+                Hotspot hotspot = {histograms[bank].counts[pc], uint8_t(bank), uint16_t(pc)};
+                hotspots.push_back(hotspot);
+            }
+        }
+    }
+    std::sort(hotspots.begin(), hotspots.end());
+    fprintf(file, "Guest hot spots: %llu samples (1 sample every %d cycles)\n\n", (unsigned long long)numSamples, GUEST_PROFILE_SAMPLE_CYCLES);
+    fprintf(file, "%-4s %-5s %-6s %10s %7s\n", "Bank", "PC", "Opcode", "Samples", "%");
+    for (size_t i = 0; (i < hotspots.size()) && (i < GUEST_HOTSPOT_COUNT); ++i)
+    {
+        const Hotspot &hotspot = hotspots[i];
+        uint8_t opcode = histograms[hotspot.bank].opcodes[hotspot.pc];
+        fprintf(file, "%02X   $%04X %02X %s %10u %6.2f%%\n", hotspot.bank, hotspot.pc, opcode, opcodeNames[opcode].c_str(),
+                hotspot.count, 100.0 * hotspot.count / numSamples);
+    }
+    fclose(file);
+    LOGI("Guest profile is written to %s and %s", foldedFileName, hotspotFileName);
+}
@@ -0,0 +1,101 @@
+#ifndef _GUEST_PROFILER_H_
+#define _GUEST_PROFILER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "Memory.h"
+#include "Platforms.h"
+
+/*
+ * Sampling profiler of the game code. Enabled by defining _PROFILE_GUEST_ in Platforms.h
+ * - Every GUEST_PROFILE_SAMPLE_CYCLES emulated cycles the PC of the current instruction is counted in a 64K entries
+ *   histogram (indexed by PC) of the PRG-ROM bank mapped at PC
+ * - A shadow call stack is kept from JSR/RTS and NMI/IRQ/RTI, so each sample is also counted with its call stack
+ *   Games often return with a manipulated stack (RTS jump tables, dropping the return address...), so a return
+ *   drops every frame whose stack pointer is at or below the stack pointer after the return instead of exactly one
+ * When the CPU is destroyed it writes
+ * - GUEST_PROFILE_FILE: collapsed stacks ("frame;frame;frame count") for flamegraph.pl
+ * - GUEST_HOTSPOT_FILE: the hottest PCs with their instruction
+ * The routines are named bank_address (e.g. 03_C5F5), or reset/nmi/irq for the entries of the interrupt vectors
+ */
+class GuestProfiler
+{
+    public:
+        GuestProfiler();
+        void SetMemory(Memory *memory);
+        // pc: address of the instruction that was executed, cycles: total number of CPU cycles
+        void Sample(uint16_t pc, uint8_t opcode, uint64_t cycles);
+        // target: address of the subroutine/interrupt handler, sp: stack pointer before the return address is pushed
+        void Call(uint16_t target, uint8_t sp);
+        // sp: stack pointer after the return address is pulled
+        void Return(uint8_t sp);
+        void Report(const char *foldedFileName, const char *hotspotFileName, const std::string *opcodeNames);
+
+    private:
+        struct Frame
+        {
+            uint16_t address;
+            uint8_t bank;
+            uint8_t sp;
+        };
+        struct Histogram
+        {
+            std::vector<uint32_t> counts; // Indexed by PC
+            std::vector<uint8_t> opcodes;
+        };
+        Memory *memory;
+        uint64_t nextSample;
+        uint64_t numSamples;
+        std::vector<Frame> stack;
+        Histogram histograms[256]; // Indexed by PRG bank. Allocated when the bank is sampled for the first time
+        std::map<std::string, uint32_t> stacks;
+
+        uint8_t GetBank(uint16_t address);
+        std::string GetName(uint16_t address, uint8_t bank);
+};
+
+inline void GuestProfiler::Sample(uint16_t pc, uint8_t opcode, uint64_t cycles)
+{
+    if (cycles >= nextSample)
+    {
+        nextSample = cycles + GUEST_PROFILE_SAMPLE_CYCLES;
+        Histogram &histogram = histograms[GetBank(pc)];
+        if (histogram.counts.empty())
+        {
+            histogram.counts.resize(0x10000, 0);
+            histogram.opcodes.resize(0x10000, 0);
+        }
+        ++histogram.counts[pc];
+        histogram.opcodes[pc] = opcode;
+        ++numSamples;
+        // Collapsed stack: the frames from the root, then the sampled PC
+        std::string key = "main";
+        for (size_t i = 0; i < stack.size(); ++i)
+        {
+            key += ";" + GetName(stack[i].address, stack[i].bank);
+        }
+        char leaf[16];
+        sprintf(leaf, ";$%04X", pc);
+        key += leaf;
+        ++stacks[key];
+    }
+}
+
+class NullGuestProfiler
+{
+    public:
+        void SetMemory(Memory *memory) {}
+        void Sample(uint16_t pc, uint8_t opcode, uint64_t cycles) {}
+        void Call(uint16_t target, uint8_t sp) {}
+        void Return(uint8_t sp) {}
+};
+
+#ifdef _PROFILE_GUEST_
+typedef GuestProfiler CPUGuestProfiler;
+#else
+typedef NullGuestProfiler CPUGuestProfiler;
+#endif
+
+#endif //_GUEST_PROFILER_H_
@@ -0,0 +1,157 @@
+#include "IdleLoop.h"
+#include <string.h>
+#include "CPU.h"
+#include "MemoryCPU.h"
+
+IdleLoop::IdleLoop()
+{
+    memory = NULL;
+    memoryCPU = NULL;
+    memset(opcodeSizes, 0, sizeof(opcodeSizes));
+    memset(absoluteOpcodes, 0, sizeof(absoluteOpcodes));
+    state = LoopNone;
+    atHead = false;
+    head = 0;
+    end = 0;
+    memset(registers, 0, sizeof(registers));
+    headCycles = 0;
+    headInstructions = 0;
+    iterationCycles = 0;
+    iterationInstructions = 0;
+    readsStatus = false;
+    status = 0;
+    iterationStatus = 0;
+    rejectedHead = 0;
+    rejectedEnd = 0;
+}
+
+void IdleLoop::SetMemory(Memory *memory)
+{
+    this->memory = memory;
+    memoryCPU = dynamic_cast<MemoryCPU *>(memory);
+}
+
+void IdleLoop::SetOpcodes(const std::string *opcodeNames, const uint8_t *addressModes)
+{
+    // Instructions whose only effects are on A, X, Y, P (and PC), whatever their address mode
+    static const char *allowedNames[] =
+    {
+        "LDA", "LDX", "LDY", "BIT", "CMP", "CPX", "CPY", "AND", "ORA", "EOR", "ADC", "SBC",
+        "INX", "INY", "DEX", "DEY", "TAX", "TAY", "TXA", "TYA", "CLC", "SEC", "CLD", "SED", "CLV",
+        "BPL", "BMI", "BVC", "BVS", "BCC", "BCS", "BNE", "BEQ"
+    };
+    for (uint16_t opcode = 0; opcode < 256; ++opcode)
+    {
+        bool allowed = false;
+        for (size_t i = 0; i < sizeof(allowedNames) / sizeof(allowedNames[0]); ++i)
+        {
+            allowed = allowed || (opcodeNames[opcode] == allowedNames[i]);
+        }
+        // Shifts of A, JMP to an absolute address and the official NOP
+        if ((opcodeNames[opcode] == "ASL") || (opcodeNames[opcode] == "LSR") || (opcodeNames[opcode] == "ROL") || (opcodeNames[opcode] == "ROR"))
+        {
+            allowed = (addressModes[opcode] == Accumulator);
+        }
+        else if ((opcodeNames[opcode] == "JMP") || (opcodeNames[opcode] == "NOP"))
+        {
+            allowed = (addressModes[opcode] == Absolute) || (opcode == 0xEA);
+        }
+        switch (addressModes[opcode])
+        {
+            case Absolute:
+                absoluteOpcodes[opcode] = (opcodeNames[opcode] == "JMP") ? 0 : 1;
+                break;
+            case AbsoluteX:
+            case AbsoluteY:
+                absoluteOpcodes[opcode] = 2;
+                break;
+            case IndirectX:
+            case Indirect:
+            case IndirectY:
+                // The indirect addresses aren't checked
+                allowed = false;
+                break;
+            default:
+                break;
+        }
+        opcodeSizes[opcode] = allowed ? GetInstructionSize(addressModes[opcode]) : 0;
+    }
+}
+
+void IdleLoop::Jump(uint16_t address, uint16_t PC, uint8_t A, uint8_t X, uint8_t Y, uint8_t P, uint8_t SP, uint64_t cycles, uint64_t instructions)
+{
+    uint8_t newRegisters[5] = {A, X, Y, P, SP};
+    if ((state != LoopNone) && (PC == head) && (address == end))
+    {
+        if ((memcmp(registers, newRegisters, sizeof(registers)) == 0) && (cycles - headCycles <= 0xFF))
+        {
+            // A full iteration didn't change anything
+            state = LoopIdle;
+            iterationCycles = uint8_t(cycles - headCycles);
+            iterationInstructions = uint8_t(instructions - headInstructions);
+            iterationStatus = status;
+        }
+        else
+        {
+            state = LoopCandidate;
+        }
+    }
+    else if (((PC != rejectedHead) || (address != rejectedEnd)) && Analyze(PC, address))
+    {
+        state = LoopCandidate;
+        head = PC;
+        end = address;
+    }
+    else
+    {
+        state = LoopNone;
+        rejectedHead = PC;
+        rejectedEnd = address;
+    }
+    memcpy(registers, newRegisters, sizeof(registers));
+    headCycles = cycles;
+    headInstructions = instructions;
+    atHead = (state == LoopIdle);
+}
+
+bool IdleLoop::Analyze(uint16_t head, uint16_t end)
+{
+    bool readsStatus = false;
+    uint16_t address = head;
+    while (address < end)
+    {
+        uint8_t opcode = memory->Read(address);
+        if (opcodeSizes[opcode] == 0)
+        {
+            return false;
+        }
+        if (absoluteOpcodes[opcode] != 0)
+        {
+            uint16_t operand = memory->Read(address + 1) | (uint16_t(memory->Read(address + 2)) << 8);
+            // The RAM and the cartridge only change when the CPU writes them
+            uint16_t last = (absoluteOpcodes[opcode] == 2) ? operand + 0xFF : operand;
+            bool isMemory = ((last < 0x2000) && (last >= operand)) || ((operand >= 0x6000) && (last >= operand));
+            // PPUSTATUS is checked by Console::Step before every iteration, so it must be read at the start of the iteration
+            bool isStatus = (absoluteOpcodes[opcode] == 1) && (operand >= 0x2000) && (operand < 0x4000) && ((operand & 0x07) == 0x02) &&
+                            (address == head) && (memoryCPU != NULL);
+            if (!isMemory && !isStatus)
+            {
+                return false;
+            }
+            readsStatus = readsStatus || isStatus;
+        }
+        address += opcodeSizes[opcode];
+    }
+    if ((address != end) || (opcodeSizes[memory->Read(end)] == 0))
+    {
+        return false;
+    }
+    this->readsStatus = readsStatus;
+    return true;
+}
+
+uint8_t IdleLoop::ReadPPUStatus()
+{
+    // Waits for the PPU thread if the PPU is behind the CPU (see PPUPipeline.h)
+    return memoryCPU->GetPPUStatus();
+}
@@ -0,0 +1,140 @@
+#ifndef _IDLE_LOOP_H_
+#define _IDLE_LOOP_H_
+
+#include <stdint.h>
+#include <string>
+#include "Memory.h"
+#include "Platforms.h"
+
+/*
+ * Detection of the idle loops (JMP *, LDA $2002/BPL, LDA counter/BEQ...) so Console::Step can skip their iterations and
+ * only run the PPU until the next event. Enabled by defining _SKIP_IDLE_LOOPS_ in Platforms.h
+ * - The CPU reports every backward jump of less than IDLE_LOOP_MAX_BYTES. The loop body is accepted if every instruction only
+ *   changes A, X, Y and P and only reads the RAM, the cartridge or PPUSTATUS ($2002), which must be read by the first
+ *   instruction of the loop
+ * - The loop is idle when the registers are the same after a full iteration run inside the body: the next iterations read the
+ *   same memory, so they do the same thing as long as PPUSTATUS doesn't change
+ * - Console::Step then runs the PPU for whole iterations without running the CPU. It checks PPUSTATUS before each iteration and
+ *   stops before the PPU can raise an NMI, so the CPU leaves the loop at the same instruction and cycle as without skipping
+ * The skipped iterations aren't seen by the instruction trace, the memory watch and the profilers, and the loops run by the JIT
+ * aren't detected. When the skipping is compiled out the CPU uses NullIdleLoop, which never reports an idle loop
+ */
+#define IDLE_LOOP_MAX_BYTES 16
+
+class MemoryCPU;
+class IdleLoop
+{
+    public:
+        IdleLoop();
+        void SetMemory(Memory *memory);
+        // Name and address mode (see AddressMode in CPU.h) of each opcode. Must be set before the first jump
+        void SetOpcodes(const std::string *opcodeNames, const uint8_t *addressModes);
+        // Called before every instruction with its address, when the PPU has caught up with the CPU
+        void Execute(uint16_t address);
+        // Called after a backward jump from the instruction at address to PC, with the CPU state after the jump
+        void Jump(uint16_t address, uint16_t PC, uint8_t A, uint8_t X, uint8_t Y, uint8_t P, uint8_t SP, uint64_t cycles, uint64_t instructions);
+        // The CPU is at the first instruction of an idle loop
+        bool IsIdle();
+        // Iterations can only be skipped while PPUSTATUS has this value (see PPU::GetStatus)
+        bool ReadsStatus();
+        uint8_t GetStatus();
+        // CPU cycles and instructions of 1 iteration
+        uint8_t GetIterationCycles();
+        uint8_t GetIterationInstructions();
+
+    private:
+        enum LoopState
+        {
+            LoopNone,
+            LoopCandidate, // The body is accepted, waiting for an iteration with the same registers
+            LoopIdle
+        };
+        Memory *memory;
+        MemoryCPU *memoryCPU; // NULL if memory isn't the CPU bus, then PPUSTATUS is never read
+        // Per opcode: size in bytes, 0 if the opcode isn't allowed in an idle loop
+        uint8_t opcodeSizes[256];
+        uint8_t absoluteOpcodes[256]; // The opcode reads an absolute address (+X/Y if 2)
+        LoopState state;
+        bool atHead;
+        uint16_t head;
+        uint16_t end; // Address of the jump back to head
+        uint8_t registers[5]; // A, X, Y, P, SP at head
+        uint64_t headCycles;
+        uint64_t headInstructions;
+        uint8_t iterationCycles;
+        uint8_t iterationInstructions;
+        bool readsStatus;
+        uint8_t status; // PPUSTATUS read by the first instruction of the current iteration
+        uint8_t iterationStatus; // PPUSTATUS read by the last full iteration
+        // Last rejected loop, so a busy loop isn't analyzed at every iteration
+        uint16_t rejectedHead;
+        uint16_t rejectedEnd;
+
+        // Return true if the body from head to end can be an idle loop. Set readsStatus
+        bool Analyze(uint16_t head, uint16_t end);
+        uint8_t ReadPPUStatus();
+};
+
+inline void IdleLoop::Execute(uint16_t address)
+{
+    atHead = false;
+    if (state != LoopNone)
+    {
+        if ((address < head) || (address > end))
+        {
+            // The CPU left the loop
+            state = LoopNone;
+        }
+        else if ((address == head) && readsStatus)
+        {
+            status = ReadPPUStatus();
+        }
+    }
+}
+
+inline bool IdleLoop::IsIdle()
+{
+    return atHead;
+}
+
+inline bool IdleLoop::ReadsStatus()
+{
+    return readsStatus;
+}
+
+inline uint8_t IdleLoop::GetStatus()
+{
+    return iterationStatus;
+}
+
+inline uint8_t IdleLoop::GetIterationCycles()
+{
+    return iterationCycles;
+}
+
+inline uint8_t IdleLoop::GetIterationInstructions()
+{
+    return iterationInstructions;
+}
+
+class NullIdleLoop
+{
+    public:
+        void SetMemory(Memory *memory) {}
+        void SetOpcodes(const std::string *opcodeNames, const uint8_t *addressModes) {}
+        void Execute(uint16_t address) {}
+        void Jump(uint16_t address, uint16_t PC, uint8_t A, uint8_t X, uint8_t Y, uint8_t P, uint8_t SP, uint64_t cycles, uint64_t instructions) {}
+        bool IsIdle() { return false; }
+        bool ReadsStatus() { return false; }
+        uint8_t GetStatus() { return 0; }
+        uint8_t GetIterationCycles() { return 0; }
+        uint8_t GetIterationInstructions() { return 0; }
+};
+
+#ifdef _SKIP_IDLE_LOOPS_
+typedef IdleLoop CPUIdleLoop;
+#else
+typedef NullIdleLoop CPUIdleLoop;
+#endif
+
+#endif //_IDLE_LOOP_H_
@@ -0,0 +1,235 @@
+#include "InstructionTrace.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include "CPU.h"
+#include "PPU.h"
+
+static_assert(sizeof(TraceHeader) <= TRACE_HEADER_SIZE, "The trace header must fit before the records");
+static_assert(sizeof(TraceRecord) == 24, "The trace records must have a fixed size");
+static_assert((TRACE_RING_RECORDS & (TRACE_RING_RECORDS - 1)) == 0, "TRACE_RING_RECORDS must be a power of 2");
+
+InstructionTrace::InstructionTrace()
+{
+    memory = NULL;
+    fileDescriptor = -1;
+    size = 0;
+    header = NULL;
+    records = NULL;
+    memset(opcodeSizes, 1, sizeof(opcodeSizes));
+}
+
+InstructionTrace::~InstructionTrace()
+{
+    Close();
+}
+
+void InstructionTrace::SetMemory(Memory *memory)
+{
+    this->memory = memory;
+}
+
+bool InstructionTrace::Open(const char *fileName, const std::string *opcodeNames, const uint8_t *addressModes)
+{
+    Close();
+    fileDescriptor = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fileDescriptor < 0)
+    {
+        LOGI("Can't open trace file %s", fileName);
+        return false;
+    }
+    // The file is sparse: the disk blocks are only allocated when the ring reaches them
+    size = TRACE_HEADER_SIZE + size_t(TRACE_RING_RECORDS) * sizeof(TraceRecord);
+    void *address = MAP_FAILED;
+    if (ftruncate(fileDescriptor, size) == 0)
+    {
+        address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    }
+    if (address == MAP_FAILED)
+    {
+        LOGI("Can't map trace file %s", fileName);
+        close(fileDescriptor);
+        fileDescriptor = -1;
+        return false;
+    }
+    header = reinterpret_cast<TraceHeader *>(address);
+    records = reinterpret_cast<TraceRecord *>(reinterpret_cast<uint8_t *>(address) + TRACE_HEADER_SIZE);
+    header->magic = TRACE_MAGIC;
+    header->version = TRACE_VERSION;
+    header->recordSize = sizeof(TraceRecord);
+    header->capacity = TRACE_RING_RECORDS;
+    header->count = 0;
+    for (uint16_t opcode = 0; opcode < 256; ++opcode)
+    {
+        strncpy(header->opcodeNames[opcode], opcodeNames[opcode].c_str(), sizeof(header->opcodeNames[opcode]));
+        header->addressModes[opcode] = addressModes[opcode];
+        opcodeSizes[opcode] = GetInstructionSize(addressModes[opcode]);
+    }
+    return true;
+}
+
+void InstructionTrace::Close()
+{
+    if (header != NULL)
+    {
+        munmap(header, size);
+        header = NULL;
+        records = NULL;
+    }
+    if (fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+}
+
+void InstructionTrace::Trace(uint16_t PC, uint8_t opcode, uint16_t operand, uint8_t A, uint8_t X, uint8_t Y, uint8_t P, uint8_t SP,
+                             uint64_t cycle)
+{
+    if (header == NULL)
+    {
+        return;
+    }
+    uint64_t count = header->count;
+    TraceRecord &record = records[count & (TRACE_RING_RECORDS - 1)];
+    record.cycle = cycle;
+    record.PC = PC;
+    record.opcode = opcode;
+    uint8_t opcodeSize = opcodeSizes[opcode];
+    record.operands[0] = (opcodeSize > 1) ? uint8_t(operand) : 0;
+    record.operands[1] = (opcodeSize > 2) ? uint8_t(operand >> 8) : 0;
+    record.A = A;
+    record.X = X;
+    record.Y = Y;
+    record.P = P;
+    record.SP = SP;
+    record.reserved = 0;
+    PPU *ppu = memory->GetPPU();
+    record.scanline = (ppu != NULL) ? ppu->GetScanline() : 0;
+    record.dot = (ppu != NULL) ? ppu->GetCycle() : 0;
+    // The count is published after the record, so a reader (even of a crashed session) never sees a half written record
+    __atomic_store_n(&header->count, count + 1, __ATOMIC_RELEASE);
+}
+
+const TraceHeader* InstructionTrace::Map(const char *fileName, size_t &size)
+{
+    int fileDescriptor = open(fileName, O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        return NULL;
+    }
+    struct stat fileStat;
+    void *address = MAP_FAILED;
+    if ((fstat(fileDescriptor, &fileStat) == 0) && (size_t(fileStat.st_size) >= TRACE_HEADER_SIZE))
+    {
+        size = fileStat.st_size;
+        address = mmap(NULL, size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    }
+    close(fileDescriptor);
+    if (address == MAP_FAILED)
+    {
+        return NULL;
+    }
+    const TraceHeader *header = reinterpret_cast<const TraceHeader *>(address);
+    if ((header->magic != TRACE_MAGIC) || (header->version != TRACE_VERSION) || (header->recordSize != sizeof(TraceRecord)) ||
+        (header->capacity == 0) || ((header->capacity & (header->capacity - 1)) != 0) ||
+        (size < TRACE_HEADER_SIZE + size_t(header->capacity) * sizeof(TraceRecord)))
+    {
+        munmap(address, size);
+        return NULL;
+    }
+    return header;
+}
+
+void InstructionTrace::Unmap(const TraceHeader *header, size_t size)
+{
+    munmap(const_cast<TraceHeader *>(header), size);
+}
+
+uint64_t InstructionTrace::GetCount(const TraceHeader *header)
+{
+    return __atomic_load_n(&header->count, __ATOMIC_ACQUIRE);
+}
+
+uint64_t InstructionTrace::GetFirstRecord(const TraceHeader *header)
+{
+    uint64_t count = GetCount(header);
+    return (count > header->capacity) ? count - header->capacity : 0;
+}
+
+const TraceRecord& InstructionTrace::GetRecord(const TraceHeader *header, uint64_t index)
+{
+    const TraceRecord *records = reinterpret_cast<const TraceRecord *>(reinterpret_cast<const uint8_t *>(header) + TRACE_HEADER_SIZE);
+    return records[index & (header->capacity - 1)];
+}
+
+void InstructionTrace::Format(const TraceHeader *header, const TraceRecord &record, char *line)
+{
+    uint8_t addressMode = header->addressModes[record.opcode];
+    uint16_t address = (record.operands[1] << 8) | record.operands[0];
+    char bytes[16];
+    char operand[16];
+    switch (addressMode)
+    {
+        case Absolute:
+            sprintf(operand, "$%04X", address);
+            break;
+        case AbsoluteX:
+            sprintf(operand, "$%04X,X", address);
+            break;
+        case AbsoluteY:
+            sprintf(operand, "$%04X,Y", address);
+            break;
+        case Accumulator:
+            sprintf(operand, "A");
+            break;
+        case Immediate:
+            sprintf(operand, "#$%02X", record.operands[0]);
+            break;
+        case IndirectX:
+            sprintf(operand, "($%02X,X)", record.operands[0]);
+            break;
+        case Indirect:
+            sprintf(operand, "($%04X)", address);
+            break;
+        case IndirectY:
+            sprintf(operand, "($%02X),Y", record.operands[0]);
+            break;
+        case Relative:
+            // The branch target
+            sprintf(operand, "$%04X", uint16_t(record.PC + 2 + int8_t(record.operands[0])));
+            break;
+        case ZeroPage:
+            sprintf(operand, "$%02X", record.operands[0]);
+            break;
+        case ZeroPageX:
+            sprintf(operand, "$%02X,X", record.operands[0]);
+            break;
+        case ZeroPageY:
+            sprintf(operand, "$%02X,Y", record.operands[0]);
+            break;
+        default:
+            operand[0] = '\0';
+            break;
+    }
+    switch (GetInstructionSize(addressMode))
+    {
+        case 1:
+            sprintf(bytes, "%02X", record.opcode);
+            break;
+        case 3:
+            sprintf(bytes, "%02X %02X %02X", record.opcode, record.operands[0], record.operands[1]);
+            break;
+        default:
+            sprintf(bytes, "%02X %02X", record.opcode, record.operands[0]);
+            break;
+    }
+    char instruction[32];
+    snprintf(instruction, sizeof(instruction), "%.4s %s", header->opcodeNames[record.opcode], operand);
+    // The pre-render scanline is -1 in nestest.log and 261 in our PPU
+    sprintf(line, "%04X  %-8s  %-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%3d SL:%d", record.PC, bytes, instruction,
+            record.A, record.X, record.Y, record.P, record.SP, record.dot, (record.scanline == 261) ? -1 : int(record.scanline));
+}
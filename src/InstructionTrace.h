@@ -0,0 +1,97 @@
+#ifndef _INSTRUCTION_TRACE_H_
+#define _INSTRUCTION_TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include "Memory.h"
+#include "Platforms.h"
+
+/*
+ * Instruction trace of CPU::Step. Enabled by defining _TRACE_INSTRUCTIONS_ in Platforms.h
+ * - Before every instruction a fixed-size record (PC, opcode, operands, A/X/Y/P/SP, PPU scanline/dot, CPU cycle) is stored
+ *   into TRACE_FILE. The opcode and operands are the bytes fetched by the CPU: the trace never reads the bus itself. The file is mapped into memory with MAP_SHARED, so tracing is a few stores: no formatting and no syscall
+ * - The records are a ring of TRACE_RING_RECORDS entries, so the file keeps the last instructions of the session
+ * - The header contains the name and the address mode of every opcode, so the trace can be decoded without the emulator
+ * - The scanline/dot are read from the PPU on the CPU thread, so the trace can't be used with _PARALLEL_PPU_ (see PPUPipeline.h)
+ * tools/tracedecode renders a trace file as nestest.log-style text
+ * When the trace is compiled out the CPU uses NullInstructionTrace whose empty inline functions cost nothing
+ */
+#define TRACE_MAGIC 0x4352544E // "NTRC"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 4096 // The records start on a page boundary
+
+struct TraceHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t capacity; // Number of records in the ring. Power of 2
+    uint64_t count; // Number of records written since the trace was opened. The next record is at count % capacity. Read it with GetCount
+    char opcodeNames[256][4];
+    uint8_t addressModes[256]; // AddressMode of CPU.h
+};
+
+struct TraceRecord
+{
+    uint64_t cycle; // CPU cycles since power up
+    uint16_t PC;
+    uint16_t scanline;
+    uint16_t dot;
+    uint8_t opcode;
+    uint8_t operands[2];
+    uint8_t A;
+    uint8_t X;
+    uint8_t Y;
+    uint8_t P;
+    uint8_t SP;
+    uint8_t reserved;
+};
+
+class InstructionTrace
+{
+    public:
+        InstructionTrace();
+        ~InstructionTrace();
+        void SetMemory(Memory *memory);
+        // addressModes: AddressMode of every opcode. Return false if the trace file can't be created or mapped
+        bool Open(const char *fileName, const std::string *opcodeNames, const uint8_t *addressModes);
+        void Close();
+        // operand: little endian operand bytes of the instruction, as fetched by the CPU
+        void Trace(uint16_t PC, uint8_t opcode, uint16_t operand, uint8_t A, uint8_t X, uint8_t Y, uint8_t P, uint8_t SP,
+                   uint64_t cycle);
+        // Map a trace file read-only. Return NULL if it isn't a valid trace file
+        static const TraceHeader* Map(const char *fileName, size_t &size);
+        static void Unmap(const TraceHeader *header, size_t size);
+        // Number of records written. The records before it are complete, even while the emulator is writing the file
+        static uint64_t GetCount(const TraceHeader *header);
+        // Record index of the oldest instruction kept in the ring
+        static uint64_t GetFirstRecord(const TraceHeader *header);
+        static const TraceRecord& GetRecord(const TraceHeader *header, uint64_t index);
+        // Render a record like a line of nestest.log. line must hold at least 128 characters
+        static void Format(const TraceHeader *header, const TraceRecord &record, char *line);
+
+    private:
+        Memory *memory;
+        int fileDescriptor;
+        size_t size;
+        TraceHeader *header;
+        TraceRecord *records;
+        uint8_t opcodeSizes[256];
+};
+
+class NullInstructionTrace
+{
+    public:
+        void SetMemory(Memory *memory) {}
+        void Trace(uint16_t PC, uint8_t opcode, uint16_t operand, uint8_t A, uint8_t X, uint8_t Y, uint8_t P, uint8_t SP,
+                   uint64_t cycle) {}
+};
+
+#ifdef _TRACE_INSTRUCTIONS_
+typedef InstructionTrace CPUTrace;
+#else
+typedef NullInstructionTrace CPUTrace;
+#endif
+
+#endif //_INSTRUCTION_TRACE_H_
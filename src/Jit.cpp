@@ -0,0 +1,446 @@
+#include "Jit.h"
+#include <sys/mman.h>
+#include <string.h>
+#include <stdio.h>
+#include "MemoryCPU.h"
+#include "PPU.h"
+
+// Offsets of the registers in JitState
+#define STATE_A 0
+#define STATE_X 1
+#define STATE_Y 2
+#define STATE_P 3
+#define STATE_PC 4
+
+/*
+ * x86-64 code of a block: uint32_t Block(JitState *state, uint8_t *ram) with state in RDI and ram in RSI
+ * The 6502 registers stay in JitState, AL holds the value being computed and CL is a scratch register
+ * The block stores the next PC into the state and returns the number of CPU cycles in EAX
+ */
+// Opcodes of the x86 instructions with an 8-bit immediate ("op al, imm8") and with the RAM operand ("op al, [rsi + disp32]")
+#define X86_MOV_IMM 0xB0
+#define X86_MOV_MEM 0x8A
+#define X86_AND_IMM 0x24
+#define X86_AND_MEM 0x22
+#define X86_OR_IMM  0x0C
+#define X86_OR_MEM  0x0A
+#define X86_XOR_IMM 0x34
+#define X86_XOR_MEM 0x32
+#define X86_SUB_IMM 0x2C
+#define X86_SUB_MEM 0x2A
+
+Jit::Jit()
+{
+    memory = NULL;
+    memoryCPU = NULL;
+    ram = NULL;
+    code = NULL;
+    codeSize = 0;
+    instructionCount = 0;
+#ifdef __x86_64__
+    void *address = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED)
+    {
+        LOGI("Can't allocate the JIT code buffer, using the interpreter");
+    }
+    else
+    {
+        code = reinterpret_cast<uint8_t *>(address);
+    }
+#else
+    LOGI("The JIT needs an x86-64 host, using the interpreter");
+#endif
+}
+
+Jit::~Jit()
+{
+    if (code != NULL)
+    {
+        munmap(code, JIT_CODE_SIZE);
+    }
+}
+
+void Jit::SetMemory(Memory *memory)
+{
+    this->memory = memory;
+    // The translated code accesses the RAM directly, so the JIT only works with the real CPU memory
+    memoryCPU = dynamic_cast<MemoryCPU *>(memory);
+    ram = (memoryCPU != NULL) ? memoryCPU->GetRAM() : NULL;
+}
+
+uint8_t Jit::Execute(uint8_t &A, uint8_t &X, uint8_t &Y, uint8_t &P, uint16_t &PC, uint8_t &instructions, bool &isRAMWritten)
+{
+    if ((PC < 0x8000) || (code == NULL) || (ram == NULL))
+    {
+        return 0;
+    }
+    std::vector<uint32_t> &entries = bankBlocks[memory->GetMapper()->GetPRGBankNumber(PC)];
+    if (entries.empty())
+    {
+        entries.resize(0x8000, BlockNone);
+    }
+    uint32_t entry = entries[PC - 0x8000];
+    if (entry == BlockNone)
+    {
+        // Translate may drop all the blocks when the code buffer is full
+        entry = Translate(PC);
+        std::vector<uint32_t> &newEntries = bankBlocks[memory->GetMapper()->GetPRGBankNumber(PC)];
+        if (newEntries.empty())
+        {
+            newEntries.resize(0x8000, BlockNone);
+        }
+        newEntries[PC - 0x8000] = entry;
+    }
+    if (entry == BlockInterpreted)
+    {
+        return 0;
+    }
+    const Block &block = blocks[entry - 1];
+    if (uint32_t(block.maxCycles) * 3 > memoryCPU->GetCyclesUntilVBlank())
+    {
+        // The PPU could raise an NMI in the middle of the block
+        return 0;
+    }
+    JitState state;
+    state.A = A;
+    state.X = X;
+    state.Y = Y;
+    state.P = P;
+    state.PC = PC;
+    uint8_t cycles = uint8_t(block.function(&state, ram));
+    A = state.A;
+    X = state.X;
+    Y = state.Y;
+    P = state.P;
+    PC = state.PC;
+    instructions = block.instructions;
+    isRAMWritten = block.isRAMWritten;
+    instructionCount += block.instructions;
+    return cycles;
+}
+
+uint32_t Jit::Translate(uint16_t address)
+{
+    buffer.clear();
+    uint32_t pc = address;
+    uint8_t cycles = 0;
+    uint8_t maxCycles = 0;
+    uint8_t instructions = 0;
+    bool isRAMWritten = false;
+    bool isEnded = false;
+    while (!isEnded && (instructions < JIT_MAX_BLOCK_INSTRUCTIONS))
+    {
+        // A block stays in the 16KB window of its first instruction, so it belongs to a single PRG bank
+        if (((pc + 2) > 0xFFFF) || (((pc + 2) ^ address) & 0xC000) != 0)
+        {
+            break;
+        }
+        uint8_t opcode = memory->Read(pc);
+        uint8_t lo = memory->Read(pc + 1);
+        uint8_t hi = memory->Read(pc + 2);
+        uint16_t absolute = (hi << 8) | lo;
+        // Operand of the instruction: immediate value or offset in the RAM
+        bool isImmediate = false;
+        uint32_t operand = 0;
+        uint8_t size = 1;
+        switch (opcode & 0x1F)
+        {
+            case 0x00: // Immediate of LDY/CPY/CPX, branches, JSR/RTI/RTS
+            case 0x02: // LDX #
+            case 0x09: // Immediate
+                isImmediate = true;
+                operand = lo;
+                size = 2;
+                break;
+            case 0x04: // Zero page
+            case 0x05:
+            case 0x06:
+                operand = lo;
+                size = 2;
+                break;
+            case 0x0C: // Absolute
+            case 0x0D:
+            case 0x0E:
+                // Only the internal RAM is accessed without the interpreter
+                operand = (absolute < 0x2000) ? (absolute & 0x07FF) : 0xFFFFFFFF;
+                size = 3;
+                break;
+        }
+        bool isRAMOperand = (operand != 0xFFFFFFFF);
+        uint8_t instructionCycles = (size == 2) ? (isImmediate ? 2 : 3) : 4; // Loads, stores, logical operations, compares
+        switch (opcode)
+        {
+            // LDA, LDX, LDY
+            case 0xA9: case 0xA5: case 0xAD:
+            case 0xA2: case 0xA6: case 0xAE:
+            case 0xA0: case 0xA4: case 0xAC:
+            {
+                if (!isRAMOperand)
+                {
+                    isEnded = true;
+                    continue;
+                }
+                uint8_t reg = ((opcode & 0x03) == 0x01) ? STATE_A : ((opcode & 0x03) == 0x02) ? STATE_X : STATE_Y;
+                Emit(isImmediate ? X86_MOV_IMM : X86_MOV_MEM);
+                isImmediate ? Emit(operand) : (Emit(0x86), Emit32(operand));
+                EmitStoreState(reg);
+                EmitSetNZ();
+                break;
+            }
+            // STA, STX, STY
+            case 0x85: case 0x8D:
+            case 0x86: case 0x8E:
+            case 0x84: case 0x8C:
+            {
+                if (!isRAMOperand)
+                {
+                    isEnded = true;
+                    continue;
+                }
+                uint8_t reg = ((opcode & 0x03) == 0x01) ? STATE_A : ((opcode & 0x03) == 0x02) ? STATE_X : STATE_Y;
+                EmitLoadState(reg);
+                // mov [rsi + disp32], al
+                Emit(0x88);
+                Emit(0x86);
+                Emit32(operand);
+                isRAMWritten = true;
+                break;
+            }
+            // AND, ORA, EOR
+            case 0x29: case 0x25: case 0x2D:
+            case 0x09: case 0x05: case 0x0D:
+            case 0x49: case 0x45: case 0x4D:
+            {
+                if (!isRAMOperand)
+                {
+                    isEnded = true;
+                    continue;
+                }
+                uint8_t operation = opcode & 0xE0;
+                uint8_t x86Opcode = (operation == 0x20) ? (isImmediate ? X86_AND_IMM : X86_AND_MEM) :
+                                    (operation == 0x00) ? (isImmediate ? X86_OR_IMM : X86_OR_MEM) :
+                                    (isImmediate ? X86_XOR_IMM : X86_XOR_MEM);
+                EmitLoadState(STATE_A);
+                Emit(x86Opcode);
+                isImmediate ? Emit(operand) : (Emit(0x86), Emit32(operand));
+                EmitStoreState(STATE_A);
+                EmitSetNZ();
+                break;
+            }
+            // CMP, CPX, CPY
+            case 0xC9: case 0xC5: case 0xCD:
+            case 0xE0: case 0xE4: case 0xEC:
+            case 0xC0: case 0xC4: case 0xCC:
+            {
+                if (!isRAMOperand)
+                {
+                    isEnded = true;
+                    continue;
+                }
+                uint8_t reg = ((opcode & 0x03) == 0x01) ? STATE_A : ((opcode & 0xE0) == 0xE0) ? STATE_X : STATE_Y;
+                EmitLoadState(reg);
+                Emit(isImmediate ? X86_SUB_IMM : X86_SUB_MEM);
+                isImmediate ? Emit(operand) : (Emit(0x86), Emit32(operand));
+                // C = register >= memory: setae cl, and byte [rdi + P], ~C, or [rdi + P], cl
+                Emit(0x0F); Emit(0x93); Emit(0xC1);
+                Emit(0x80); Emit(0x67); Emit(STATE_P); Emit(uint8_t(~FLAG_CARRY));
+                Emit(0x08); Emit(0x4F); Emit(STATE_P);
+                EmitSetNZ();
+                break;
+            }
+            // INC, DEC
+            case 0xE6: case 0xEE:
+            case 0xC6: case 0xCE:
+            {
+                if (!isRAMOperand)
+                {
+                    isEnded = true;
+                    continue;
+                }
+                // mov al, [rsi + disp32], inc/dec al, mov [rsi + disp32], al
+                Emit(0x8A); Emit(0x86); Emit32(operand);
+                Emit(0xFE); Emit((opcode == 0xE6 || opcode == 0xEE) ? 0xC0 : 0xC8);
+                Emit(0x88); Emit(0x86); Emit32(operand);
+                EmitSetNZ();
+                isRAMWritten = true;
+                instructionCycles = (size == 2) ? 5 : 6;
+                break;
+            }
+            // TAX, TAY, TXA, TYA
+            case 0xAA: case 0xA8: case 0x8A: case 0x98:
+            {
+                uint8_t source = (opcode == 0x8A) ? STATE_X : (opcode == 0x98) ? STATE_Y : STATE_A;
+                uint8_t destination = (opcode == 0xAA) ? STATE_X : (opcode == 0xA8) ? STATE_Y : STATE_A;
+                EmitLoadState(source);
+                EmitStoreState(destination);
+                EmitSetNZ();
+                size = 1;
+                instructionCycles = 2;
+                break;
+            }
+            // INX, INY, DEX, DEY
+            case 0xE8: case 0xC8: case 0xCA: case 0x88:
+            {
+                uint8_t reg = ((opcode == 0xE8) || (opcode == 0xCA)) ? STATE_X : STATE_Y;
+                EmitLoadState(reg);
+                Emit(0xFE);
+                Emit(((opcode == 0xE8) || (opcode == 0xC8)) ? 0xC0 : 0xC8);
+                EmitStoreState(reg);
+                EmitSetNZ();
+                size = 1;
+                instructionCycles = 2;
+                break;
+            }
+            // CLC, SEC, CLV, CLD, SED. CLI and SEI end the block: the interpreter delays the IRQ poll after them
+            case 0x18: case 0x38: case 0xB8: case 0xD8: case 0xF8:
+            {
+                static const uint8_t flags[8] = { FLAG_CARRY, FLAG_CARRY, FLAG_INTERRUPT, FLAG_INTERRUPT, 0, FLAG_OVERFLOW, FLAG_DECIMAL, FLAG_DECIMAL };
+                uint8_t flag = flags[opcode >> 5];
+                if ((opcode == 0xB8) || ((opcode & 0x20) == 0))
+                {
+                    // and byte [rdi + P], ~flag
+                    Emit(0x80); Emit(0x67); Emit(STATE_P); Emit(uint8_t(~flag));
+                }
+                else
+                {
+                    // or byte [rdi + P], flag
+                    Emit(0x80); Emit(0x4F); Emit(STATE_P); Emit(flag);
+                }
+                size = 1;
+                instructionCycles = 2;
+                break;
+            }
+            // NOP
+            case 0xEA:
+                size = 1;
+                instructionCycles = 2;
+                break;
+            // BPL, BMI, BVC, BVS, BCC, BCS, BNE, BEQ
+            case 0x10: case 0x30: case 0x50: case 0x70: case 0x90: case 0xB0: case 0xD0: case 0xF0:
+            {
+                static const uint8_t flags[4] = { FLAG_NEGATIVE, FLAG_OVERFLOW, FLAG_CARRY, FLAG_ZERO };
+                uint16_t next = pc + 2;
+                uint16_t target = next + int8_t(lo);
+                uint8_t extraCycles = ((target & 0xFF00) != (next & 0xFF00)) ? 2 : 1;
+                cycles += 2;
+                // Not taken
+                Emit(0x66); Emit(0xC7); Emit(0x47); Emit(STATE_PC); Emit16(next);
+                Emit(0xB8); Emit32(cycles);
+                // test byte [rdi + P], flag. Skip the taken path when the condition is false
+                Emit(0xF6); Emit(0x47); Emit(STATE_P); Emit(flags[opcode >> 6]);
+                Emit(((opcode & 0x20) != 0) ? 0x74 : 0x75);
+                Emit(9);
+                // Taken
+                Emit(0x66); Emit(0xC7); Emit(0x47); Emit(STATE_PC); Emit16(target);
+                Emit(0x83); Emit(0xC0); Emit(extraCycles);
+                Emit(0xC3);
+                maxCycles = cycles + extraCycles;
+                ++instructions;
+                isEnded = true;
+                continue;
+            }
+            // JMP absolute
+            case 0x4C:
+                cycles += 3;
+                EmitEnd(absolute, cycles);
+                maxCycles = cycles;
+                ++instructions;
+                isEnded = true;
+                continue;
+            default:
+                isEnded = true;
+                continue;
+        }
+        pc += size;
+        cycles += instructionCycles;
+        ++instructions;
+    }
+    if (instructions == 0)
+    {
+        return BlockInterpreted;
+    }
+    if (maxCycles == 0)
+    {
+        // The block doesn't end with a jump: continue with the interpreter at the next instruction
+        EmitEnd(pc, cycles);
+        maxCycles = cycles;
+    }
+    if (codeSize + buffer.size() > JIT_CODE_SIZE)
+    {
+        Reset();
+    }
+    memcpy(code + codeSize, &buffer[0], buffer.size());
+    Block block;
+    block.function = reinterpret_cast<BlockFunction>(code + codeSize);
+    block.maxCycles = maxCycles;
+    block.instructions = instructions;
+    block.isRAMWritten = isRAMWritten;
+    codeSize += buffer.size();
+    blocks.push_back(block);
+    return blocks.size();
+}
+
+void Jit::Reset()
+{
+    blocks.clear();
+    for (uint16_t bank = 0; bank < 256; ++bank)
+    {
+        bankBlocks[bank].clear();
+    }
+    codeSize = 0;
+}
+
+void Jit::Emit(uint8_t byte)
+{
+    buffer.push_back(byte);
+}
+
+void Jit::Emit16(uint16_t value)
+{
+    Emit(value & 0xFF);
+    Emit(value >> 8);
+}
+
+void Jit::Emit32(uint32_t value)
+{
+    Emit16(value & 0xFFFF);
+    Emit16(value >> 16);
+}
+
+void Jit::EmitLoadState(uint8_t offset)
+{
+    // mov al, [rdi + offset]
+    Emit(0x8A);
+    Emit(0x47);
+    Emit(offset);
+}
+
+void Jit::EmitStoreState(uint8_t offset)
+{
+    // mov [rdi + offset], al
+    Emit(0x88);
+    Emit(0x47);
+    Emit(offset);
+}
+
+void Jit::EmitSetNZ()
+{
+    // and byte [rdi + P], ~(N | Z)
+    Emit(0x80); Emit(0x67); Emit(STATE_P); Emit(uint8_t(~(FLAG_NEGATIVE | FLAG_ZERO)));
+    // test al, al; jnz +4; or byte [rdi + P], Z
+    Emit(0x84); Emit(0xC0);
+    Emit(0x75); Emit(4);
+    Emit(0x80); Emit(0x4F); Emit(STATE_P); Emit(FLAG_ZERO);
+    // mov cl, al; and cl, N; or [rdi + P], cl
+    Emit(0x88); Emit(0xC1);
+    Emit(0x80); Emit(0xE1); Emit(FLAG_NEGATIVE);
+    Emit(0x08); Emit(0x4F); Emit(STATE_P);
+}
+
+void Jit::EmitEnd(uint16_t PC, uint8_t cycles)
+{
+    // mov word [rdi + PC], PC; mov eax, cycles; ret
+    Emit(0x66); Emit(0xC7); Emit(0x47); Emit(STATE_PC); Emit16(PC);
+    Emit(0xB8); Emit32(cycles);
+    Emit(0xC3);
+}
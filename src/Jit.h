@@ -0,0 +1,116 @@
+#ifndef _JIT_H_
+#define _JIT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Memory.h"
+#include "Platforms.h"
+
+/*
+ * x86-64 dynamic recompiler of the PRG-ROM code. Enabled by defining _JIT_ in Platforms.h
+ * - A basic block is translated to native code the first time the CPU reaches it. The blocks are keyed by (PRG bank, address),
+ *   so a bank switch selects other blocks and the translated code never has to be invalidated: the content of a bank never changes
+ * - Only instructions whose effects stay inside the CPU registers and the internal RAM are translated (loads/stores of zero page
+ *   and absolute RAM addresses, register transfers, increments, logical operations, compares, flag operations, branches, JMP)
+ *   A block ends before any other instruction, in particular before every access to $2000-$401F (I/O), the cartridge space or
+ *   the stack, which are run by the interpreter. Code running from RAM is never translated
+ * - CLI, SEI (and PLP) are left to the interpreter, which delays the IRQ poll by 1 instruction after them (see CPU::DelayIRQPoll)
+ * - The cycles of a block are counted at translation time. A block only runs when the PPU can't set the VBlank flag or raise an NMI
+ *   before it ends (see MemoryCPU::GetCyclesUntilVBlank), otherwise the interpreter runs the next instruction. So the CPU sees the same
+ *   interrupts at the same instructions as the interpreter
+ * - When the code buffer is full every block is dropped and translated again
+ * The blocks run by the JIT aren't seen by the instruction trace, the memory watch and the profilers
+ * When the JIT is compiled out the CPU uses NullJit, which never runs anything
+ */
+#define JIT_CODE_SIZE (4 * 1024 * 1024)
+#define JIT_MAX_BLOCK_INSTRUCTIONS 32
+
+// CPU registers shared with the translated code
+struct JitState
+{
+    uint8_t A;
+    uint8_t X;
+    uint8_t Y;
+    uint8_t P;
+    uint16_t PC;
+};
+
+class MemoryCPU;
+class Jit
+{
+    public:
+        Jit();
+        ~Jit();
+        void SetMemory(Memory *memory);
+        /*
+         * Run the translated block at PC if there is one and the PPU allows it
+         * Return the number of CPU cycles of the block (0 if nothing was run), the number of instructions in instructions, and
+         * in isRAMWritten whether the block may have stored to the internal RAM ($0000-$07FF) without the bus
+         */
+        uint8_t Execute(uint8_t &A, uint8_t &X, uint8_t &Y, uint8_t &P, uint16_t &PC, uint8_t &instructions, bool &isRAMWritten);
+        // Number of instructions run by translated code since power up
+        uint64_t GetInstructionCount();
+
+    private:
+        typedef uint32_t (*BlockFunction)(JitState *state, uint8_t *ram);
+        struct Block
+        {
+            BlockFunction function;
+            uint8_t maxCycles; // With a taken branch to another page
+            uint8_t instructions;
+            bool isRAMWritten; // The block has a STA/STX/STY/INC/DEC
+        };
+        enum
+        {
+            BlockNone = 0, // Not translated yet
+            BlockInterpreted = 0xFFFFFFFF // The first instruction can't be translated
+        };
+        Memory *memory;
+        MemoryCPU *memoryCPU;
+        uint8_t *ram;
+        uint8_t *code;
+        size_t codeSize;
+        std::vector<Block> blocks;
+        // Per 16KB PRG bank: 1 + index of the block of each address, or BlockNone/BlockInterpreted
+        std::vector<uint32_t> bankBlocks[256];
+        uint64_t instructionCount;
+        // Code being emitted
+        std::vector<uint8_t> buffer;
+
+        uint32_t Translate(uint16_t address);
+        void Reset();
+        // Emitters
+        void Emit(uint8_t byte);
+        void Emit16(uint16_t value);
+        void Emit32(uint32_t value);
+        // Load the register at offset of JitState into AL / store AL into it
+        void EmitLoadState(uint8_t offset);
+        void EmitStoreState(uint8_t offset);
+        // Set N and Z from AL
+        void EmitSetNZ();
+        void EmitEnd(uint16_t PC, uint8_t cycles);
+};
+
+inline uint64_t Jit::GetInstructionCount()
+{
+    return instructionCount;
+}
+
+class NullJit
+{
+    public:
+        void SetMemory(Memory *memory) {}
+        uint8_t Execute(uint8_t &A, uint8_t &X, uint8_t &Y, uint8_t &P, uint16_t &PC, uint8_t &instructions, bool &isRAMWritten)
+        {
+            return 0;
+        }
+};
+
+#ifdef _JIT_
+typedef Jit CPUJit;
+#else
+typedef NullJit CPUJit;
+#endif
+
+#endif //_JIT_H_
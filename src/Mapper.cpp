@@ -1,81 +1,83 @@
 #include "Mapper.h"
-#include <assert.h>
-#include "Mapper0.h"
-#include "Mapper2.h"
+#include "MapperRegistry.h"
+#include "MemoryPPU.h"
 
 Mapper* Mapper::GetMapper(Cartridge *cartridge)
 {
-    Mapper *mapper = NULL;
-    switch(cartridge->GetMapperNumber())
-    {
-        case 0:
-            mapper = new Mapper0(cartridge);
-            break;
-        case 2:
-            mapper = new Mapper2(cartridge);
-            break;
-    }
-    return mapper;
+    // Mappers register themselves with REGISTER_MAPPER (see MapperRegistry.h)
+    return MapperRegistry::CreateMapper(cartridge);
 }
 
 Mapper::Mapper(Cartridge *cartridge)
 {
     this->cartridge = cartridge;
+    mirroring = cartridge->GetMirroring();
+    memoryPPU = NULL;
+    prgWindows[0] = NULL;
+    prgWindows[1] = NULL;
+    prgWindowBanks[0] = 0;
+    prgWindowBanks[1] = 0;
+    prgBankVersion = 0;
+    chrWindow = NULL;
 }
 
-Mirroring Mapper::GetCartridgeMirroring()
+uint8_t Mapper::Read(uint16_t address)
 {
-    return cartridge->GetMirroring();
+    return ReadCartridge<Mapper>(address);
 }
 
-uint8_t Mapper::Read(uint16_t address)
+void Mapper::Write(uint16_t address, uint8_t value)
 {
-    uint8_t value = 0;
-    if (address < 0x4020)
-    {
-        // $0000-$401F
-        // Just for debugging
-        assert(0);
-    }
-    else if (address < 0x6000)
-    {
-        // $4020-$5FFF: Expansion ROM
-        // We haven't implement mapper using expansion ROM yet
-    }
-    else if (address < 0x8000)
-    {
-        // $6000-$7FFF: SRAM is used in RPG game. We can use it to save the current state of game
-        value = cartridge->ReadSRAM(address - 0x6000);
-    }
-    else
-    {
-        // $8000-$FFFF: PRG-ROM
-        value = ReadPRG(address);
-    }
-    return value;
+    WriteCartridge<Mapper>(address, value);
 }
 
-void Mapper::Write(uint16_t address, uint8_t value)
+uint8_t Mapper::GetPRGBankNumber(uint16_t address)
 {
-    if (address < 0x4020)
-    {
-        // $0000-$401F
-        // Just for debugging
-        assert(0);
-    }
-    else if (address < 0x6000)
-    {
-        // $4020-$5FFF: Expansion ROM
-        // We haven't implement mapper using expansion ROM yet
-    }
-    else if (address < 0x8000)
+    // Mappers switching banks by pointers
+    return prgWindowBanks[(address >> 14) & 0x01];
+}
+
+const uint8_t* Mapper::GetPage(uint16_t address)
+{
+    assert(address >= 0x6000);
+    if (address >= 0x8000)
     {
-        // $6000-$7FFF: SRAM is used in RPG game. We can use it to save the current state of game
-        cartridge->WriteSRAM(address - 0x6000, value);
+        return cartridge->GetPRGBank(GetPRGBankNumber(address)) + (address & 0x3F00);
     }
-    else
+    return cartridge->GetSRAM() + ((address - 0x6000) & 0xFF00);
+}
+
+void Mapper::SelectPRG16(uint8_t window, uint8_t bank)
+{
+    // Out of range bank numbers wrap around like the unconnected high bits of the bank register
+    prgWindowBanks[window] = bank % cartridge->GetNumPRG();
+    prgWindows[window] = cartridge->GetPRGBank(prgWindowBanks[window]);
+    ++prgBankVersion;
+}
+
+void Mapper::SelectPRG32(uint8_t bank)
+{
+    // A 32KB bank is 2 consecutive 16KB banks
+    SelectPRG16(0, bank * 2);
+    SelectPRG16(1, bank * 2 + 1);
+}
+
+void Mapper::SelectCHR8(uint8_t bank)
+{
+    chrWindow = cartridge->GetCHRBank(bank % cartridge->GetNumCHR());
+}
+
+void Mapper::SetMemoryPPU(MemoryPPU *memoryPPU)
+{
+    this->memoryPPU = memoryPPU;
+    memoryPPU->SetMirroring(mirroring);
+}
+
+void Mapper::SetMirroring(Mirroring mirroring)
+{
+    this->mirroring = mirroring;
+    if (memoryPPU != NULL)
     {
-        // $8000-$FFFF: PRG-ROM
-        WritePRG(address, value);
+        memoryPPU->SetMirroring(mirroring);
     }
 }
\ No newline at end of file
@@ -1,24 +1,116 @@
 #ifndef _MAPPER_H_
 #define _MAPPER_H_
 
+#include <assert.h>
 #include "Cartridge.h"
 
+class MemoryPPU;
+
 class Mapper
 {
     public:
         static Mapper* GetMapper(Cartridge *cartridge);
         Mapper(Cartridge *cartridge);
-        Mirroring GetCartridgeMirroring();
+        virtual ~Mapper() {}
+        // The mirroring is read from the NES file header but some mappers can change it at runtime
+        Mirroring GetMirroring();
+        // The PPU memory is notified when the mirroring changes
+        void SetMemoryPPU(MemoryPPU *memoryPPU);
         uint8_t Read(uint16_t address);
         void Write(uint16_t address, uint8_t value);
+        /*
+         * Read/Write the cartridge space ($4020-$FFFF) with the PRG accesses dispatched to MapperType
+         * When MapperType is a final mapper class the ReadPRG/WritePRG calls are resolved at compile time and inlined
+         * When MapperType is Mapper they go through the virtual interface
+         */
+        template<class MapperType> uint8_t ReadCartridge(uint16_t address);
+        template<class MapperType> void WriteCartridge(uint16_t address, uint8_t value);
 
         virtual uint8_t ReadPRG(uint16_t address) = 0;
         virtual uint8_t ReadCHR(uint16_t address) = 0;    
         virtual void WriteCHR(uint16_t address, uint8_t value) = 0;
         virtual void WritePRG(uint16_t address, uint8_t value) = 0;
+        // Number of the 16KB PRG-ROM bank mapped at address ($8000-$FFFF)
+        virtual uint8_t GetPRGBankNumber(uint16_t address);
+        // Incremented by every PRG bank switch, so the users of GetPRGBankNumber know when to ask again (see DecodeCache.h)
+        uint32_t GetPRGBankVersion();
+        // The 256 bytes of the SRAM/PRG-ROM page at address ($6000-$FFFF), for bulk reads (see PPU::WriteDMA)
+        const uint8_t* GetPage(uint16_t address);
         
     protected:
         Cartridge *cartridge;
+        Mirroring mirroring;
+        MemoryPPU *memoryPPU;
+        /*
+         * Swappable bank windows for mappers that switch banks by pointers, so a PRG/CHR access is
+         * a single indexed load instead of a call to the cartridge with the current bank number
+         * prgWindows[0]: $8000-$BFFF, prgWindows[1]: $C000-$FFFF
+         * chrWindow: $0000-$1FFF
+         */
+        uint8_t *prgWindows[2];
+        uint8_t prgWindowBanks[2]; // 16KB bank number of each PRG window
+        uint32_t prgBankVersion;
+        uint8_t *chrWindow;
+        void SelectPRG16(uint8_t window, uint8_t bank);
+        void SelectPRG32(uint8_t bank);
+        void SelectCHR8(uint8_t bank);
+        void SetMirroring(Mirroring mirroring);
 };
 
-#endif //_MAPPER_H_
\ No newline at end of file
+inline Mirroring Mapper::GetMirroring()
+{
+    return mirroring;
+}
+
+inline uint32_t Mapper::GetPRGBankVersion()
+{
+    return prgBankVersion;
+}
+
+template<class MapperType>
+inline uint8_t Mapper::ReadCartridge(uint16_t address)
+{
+    uint8_t value = 0;
+    if (address >= 0x8000)
+    {
+        // $8000-$FFFF: PRG-ROM
+        value = static_cast<MapperType *>(this)->ReadPRG(address);
+    }
+    else if (address >= 0x6000)
+    {
+        // $6000-$7FFF: SRAM is used in RPG game. We can use it to save the current state of game
+        value = cartridge->ReadSRAM(address - 0x6000);
+    }
+    else
+    {
+        // $4020-$5FFF: Expansion ROM
+        // We haven't implement mapper using expansion ROM yet
+        // $0000-$401F: Just for debugging
+        assert(address >= 0x4020);
+    }
+    return value;
+}
+
+template<class MapperType>
+inline void Mapper::WriteCartridge(uint16_t address, uint8_t value)
+{
+    if (address >= 0x8000)
+    {
+        // $8000-$FFFF: PRG-ROM
+        static_cast<MapperType *>(this)->WritePRG(address, value);
+    }
+    else if (address >= 0x6000)
+    {
+        // $6000-$7FFF: SRAM is used in RPG game. We can use it to save the current state of game
+        cartridge->WriteSRAM(address - 0x6000, value);
+    }
+    else
+    {
+        // $4020-$5FFF: Expansion ROM
+        // We haven't implement mapper using expansion ROM yet
+        // $0000-$401F: Just for debugging
+        assert(address >= 0x4020);
+    }
+}
+
+#endif //_MAPPER_H_
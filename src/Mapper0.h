@@ -18,7 +18,7 @@ enum NROM
     NROM256   
 };
 
-class Mapper0 : public Mapper
+class Mapper0 final : public Mapper
 {
     public:
         Mapper0(Cartridge *cartridge);
@@ -26,9 +26,49 @@ class Mapper0 : public Mapper
         uint8_t ReadCHR(uint16_t address);
         void WritePRG(uint16_t address, uint8_t value);
         void WriteCHR(uint16_t address, uint8_t value);  
+        uint8_t GetPRGBankNumber(uint16_t address);
 
     private:
         NROM NROMType;
 };
 
+inline uint8_t Mapper0::ReadPRG(uint16_t address)
+{
+    /*
+     * The PRG-ROM is the area of ROM used to store the program code
+     * The address of PRG-ROM in CPU memory is from 0x8000-0xFFFF
+     */
+    uint8_t returnValue = 0xFF;
+    if (address < 0xC000)
+    {
+        // 0x8000-0xBFFF: First 16 KB of rom
+        returnValue = cartridge->ReadPRG(0, address - 0x8000);
+    }
+    else
+    {
+        // 0xC000-0xFFFF: Last 16 KB of ROM (NROM-256) or mirror of $8000-$BFFF (NROM-128)
+        if (NROMType == NROM128)
+        {
+            returnValue = cartridge->ReadPRG(0, address - 0xC000);
+        }
+        else
+        {
+            returnValue = cartridge->ReadPRG(1, address - 0xC000);
+        }
+    }
+    return returnValue;
+}
+
+inline uint8_t Mapper0::ReadCHR(uint16_t address)
+{
+    // In mapper0 CHR-ROM/RAM has only 1 bank 
+    return cartridge->ReadCHR(0, address);
+}
+
+inline void Mapper0::WriteCHR(uint16_t address, uint8_t value)
+{
+    // In mapper0 CHR-ROM/RAM has only 1 bank 
+    cartridge->WriteCHR(0, address, value);
+}
+
 #endif //_MAPPER_0_H_
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "Mapper11.h"
+#include "MapperRegistry.h"
+
+REGISTER_MAPPER(11, Mapper11);
+
+Mapper11::Mapper11(Cartridge *cartridge) : Mapper(cartridge)
+{
+    SelectPRG32(0);
+    SelectCHR8(0);
+}
+
+void Mapper11::WritePRG(uint16_t address, uint8_t value)
+{
+    /*
+     * 7  bit  0
+     * ---- ----
+     * CCCC LLPP
+     * |||| ||||
+     * |||| ||++- Select 32 KB PRG ROM bank for CPU $8000-$FFFF
+     * |||| ++--- Used for lockout defeat
+     * ++++------ Select 8 KB CHR ROM bank for PPU $0000-$1FFF
+     */
+    value &= ReadPRG(address); // bus conflict
+    SelectPRG32(value & 0x03);
+    SelectCHR8(value >> 4);
+}
@@ -1,5 +1,8 @@
 #include "Mapper2.h"
 #include <assert.h>
+#include "MapperRegistry.h"
+
+REGISTER_MAPPER(2, Mapper2);
 
 Mapper2::Mapper2(Cartridge *cartridge) : Mapper(cartridge)
 {
@@ -7,31 +10,6 @@ Mapper2::Mapper2(Cartridge *cartridge) : Mapper(cartridge)
     lastBank = cartridge->GetNumPRG() - 1;
 }
 
-uint8_t Mapper2::ReadPRG(uint16_t address)
-{
-    /*
-     * The first PRG-ROM bank is loaded into $8000 and the last PRG-ROM bank is
-     * loaded into $C000. Switching is only allowed for the bank at $8000, the one at $C000 is
-     * permanently assigned to that location.
-     */
-    uint8_t returnValue = 0xFF;
-    if (address < 0xC000)
-    {
-        returnValue = cartridge->ReadPRG(currentBank, address - 0x8000);
-    }
-    else
-    {
-        returnValue = cartridge->ReadPRG(lastBank, address - 0xC000);
-    }
-    return returnValue;
-}
-
-uint8_t Mapper2::ReadCHR(uint16_t address)
-{
-    // In mapper2 CHR-ROM/RAM has only 1 bank 
-    return cartridge->ReadCHR(0, address);
-}   
-
 void Mapper2::WritePRG(uint16_t address, uint8_t value)
 {
     /*
@@ -43,10 +21,10 @@ void Mapper2::WritePRG(uint16_t address, uint8_t value)
      *            (UNROM uses bits 2-0)
      */
     currentBank = value & 0x07;
+    ++prgBankVersion;
 }
 
-void Mapper2::WriteCHR(uint16_t address, uint8_t value)
+uint8_t Mapper2::GetPRGBankNumber(uint16_t address)
 {
-    // In mapper2 CHR-ROM/RAM has only 1 bank
-    cartridge->WriteCHR(0, address, value);
+    return (address < 0xC000) ? currentBank : lastBank;
 }
\ No newline at end of file
@@ -13,7 +13,7 @@
  * 16 KB PRG-ROM banks using UNROM is 8
  */
 
-class Mapper2 : public Mapper
+class Mapper2 final : public Mapper
 {
     public:
         Mapper2(Cartridge *cartridge);
@@ -21,10 +21,42 @@ class Mapper2 : public Mapper
         uint8_t ReadCHR(uint16_t address);
         void WritePRG(uint16_t address, uint8_t value);
         void WriteCHR(uint16_t address, uint8_t value);
+        uint8_t GetPRGBankNumber(uint16_t address);
 
     private:
         uint8_t currentBank;
         uint8_t lastBank; // The last bank (C000-FFFF) is permanently assigned to that location
 };
 
+inline uint8_t Mapper2::ReadPRG(uint16_t address)
+{
+    /*
+     * The first PRG-ROM bank is loaded into $8000 and the last PRG-ROM bank is
+     * loaded into $C000. Switching is only allowed for the bank at $8000, the one at $C000 is
+     * permanently assigned to that location.
+     */
+    uint8_t returnValue = 0xFF;
+    if (address < 0xC000)
+    {
+        returnValue = cartridge->ReadPRG(currentBank, address - 0x8000);
+    }
+    else
+    {
+        returnValue = cartridge->ReadPRG(lastBank, address - 0xC000);
+    }
+    return returnValue;
+}
+
+inline uint8_t Mapper2::ReadCHR(uint16_t address)
+{
+    // In mapper2 CHR-ROM/RAM has only 1 bank 
+    return cartridge->ReadCHR(0, address);
+}
+
+inline void Mapper2::WriteCHR(uint16_t address, uint8_t value)
+{
+    // In mapper2 CHR-ROM/RAM has only 1 bank
+    cartridge->WriteCHR(0, address, value);
+}
+
 #endif //_MAPPER_2_H_
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "Mapper3.h"
+#include "MapperRegistry.h"
+
+REGISTER_MAPPER(3, Mapper3);
+
+Mapper3::Mapper3(Cartridge *cartridge) : Mapper(cartridge)
+{
+    // The last bank is at $C000-$FFFF, it is the first bank for NROM-128 like games
+    SelectPRG16(0, 0);
+    SelectPRG16(1, cartridge->GetNumPRG() - 1);
+    SelectCHR8(0);
+}
+
+void Mapper3::WritePRG(uint16_t address, uint8_t value)
+{
+    /*
+     * 7  bit  0
+     * ---- ----
+     * cccc ccCC
+     * |||| ||||
+     * ++++-++++- Select 8 KB CHR ROM bank for PPU $0000-$1FFF
+     *            (CNROM uses bits 1-0)
+     */
+    value &= ReadPRG(address); // bus conflict
+    SelectCHR8(value & 0x03);
+}
@@ -0,0 +1,40 @@
+#ifndef _MAPPER_3_H_
+#define _MAPPER_3_H_
+
+#include "Mapper.h"
+
+/*
+ * CNROM: PRG-ROM is fixed like NROM (16 KB mirrored at $C000 or 32 KB at $8000-$FFFF)
+ * The 8 KB CHR-ROM bank at PPU $0000 is switched by writing to $8000-$FFFF
+ * CNROM has bus conflicts: the written value is ANDed with the PRG-ROM byte at the same address
+ */
+
+class Mapper3 final : public Mapper
+{
+    public:
+        Mapper3(Cartridge *cartridge);
+        uint8_t ReadPRG(uint16_t address);
+        uint8_t ReadCHR(uint16_t address);
+        void WritePRG(uint16_t address, uint8_t value);
+        void WriteCHR(uint16_t address, uint8_t value);
+};
+
+inline uint8_t Mapper3::ReadPRG(uint16_t address)
+{
+    return prgWindows[(address >> 14) & 0x01][address & 0x3FFF];
+}
+
+inline uint8_t Mapper3::ReadCHR(uint16_t address)
+{
+    return chrWindow[address];
+}
+
+inline void Mapper3::WriteCHR(uint16_t address, uint8_t value)
+{
+    if (cartridge->HasCHRRam())
+    {
+        chrWindow[address] = value;
+    }
+}
+
+#endif //_MAPPER_3_H_
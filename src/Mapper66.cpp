@@ -0,0 +1,25 @@
+#include "Mapper66.h"
+#include "MapperRegistry.h"
+
+REGISTER_MAPPER(66, Mapper66);
+
+Mapper66::Mapper66(Cartridge *cartridge) : Mapper(cartridge)
+{
+    SelectPRG32(0);
+    SelectCHR8(0);
+}
+
+void Mapper66::WritePRG(uint16_t address, uint8_t value)
+{
+    /*
+     * 7  bit  0
+     * ---- ----
+     * xxPP xxCC
+     *   ||   ||
+     *   ||   ++- Select 8 KB CHR ROM bank for PPU $0000-$1FFF
+     *   ++------ Select 32 KB PRG ROM bank for CPU $8000-$FFFF
+     */
+    value &= ReadPRG(address); // bus conflict
+    SelectPRG32((value >> 4) & 0x03);
+    SelectCHR8(value & 0x03);
+}
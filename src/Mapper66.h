@@ -0,0 +1,40 @@
+#ifndef _MAPPER_66_H_
+#define _MAPPER_66_H_
+
+#include "Mapper.h"
+
+/*
+ * GxROM switches a 32 KB PRG-ROM bank at $8000-$FFFF and an 8 KB CHR-ROM bank at PPU $0000
+ * with a single register at $8000-$FFFF
+ * The board has bus conflicts: the written value is ANDed with the PRG-ROM byte at the same address
+ */
+
+class Mapper66 final : public Mapper
+{
+    public:
+        Mapper66(Cartridge *cartridge);
+        uint8_t ReadPRG(uint16_t address);
+        uint8_t ReadCHR(uint16_t address);
+        void WritePRG(uint16_t address, uint8_t value);
+        void WriteCHR(uint16_t address, uint8_t value);
+};
+
+inline uint8_t Mapper66::ReadPRG(uint16_t address)
+{
+    return prgWindows[(address >> 14) & 0x01][address & 0x3FFF];
+}
+
+inline uint8_t Mapper66::ReadCHR(uint16_t address)
+{
+    return chrWindow[address];
+}
+
+inline void Mapper66::WriteCHR(uint16_t address, uint8_t value)
+{
+    if (cartridge->HasCHRRam())
+    {
+        chrWindow[address] = value;
+    }
+}
+
+#endif //_MAPPER_66_H_
@@ -0,0 +1,25 @@
+#include "Mapper7.h"
+#include "MapperRegistry.h"
+
+REGISTER_MAPPER(7, Mapper7);
+
+Mapper7::Mapper7(Cartridge *cartridge) : Mapper(cartridge)
+{
+    SelectPRG32(0);
+    SelectCHR8(0);
+    SetMirroring(SingleScreenLower);
+}
+
+void Mapper7::WritePRG(uint16_t address, uint8_t value)
+{
+    /*
+     * 7  bit  0
+     * ---- ----
+     * xxxM xPPP
+     *    |  |||
+     *    |  +++- Select 32 KB PRG ROM bank for CPU $8000-$FFFF
+     *    +------ Select 1 KB VRAM page for all 4 nametables
+     */
+    SelectPRG32(value & 0x07);
+    SetMirroring(((value & 0x10) == 0x10) ? SingleScreenUpper : SingleScreenLower);
+}
@@ -0,0 +1,40 @@
+#ifndef _MAPPER_7_H_
+#define _MAPPER_7_H_
+
+#include "Mapper.h"
+
+/*
+ * AxROM switches a 32 KB PRG-ROM bank at $8000-$FFFF and uses 8 KB of CHR-RAM
+ * Instead of the horizontal/vertical mirroring of the NES file header, AxROM uses single-screen
+ * mirroring and the program selects which of the 2 nametables of the console is displayed
+ */
+
+class Mapper7 final : public Mapper
+{
+    public:
+        Mapper7(Cartridge *cartridge);
+        uint8_t ReadPRG(uint16_t address);
+        uint8_t ReadCHR(uint16_t address);
+        void WritePRG(uint16_t address, uint8_t value);
+        void WriteCHR(uint16_t address, uint8_t value);
+};
+
+inline uint8_t Mapper7::ReadPRG(uint16_t address)
+{
+    return prgWindows[(address >> 14) & 0x01][address & 0x3FFF];
+}
+
+inline uint8_t Mapper7::ReadCHR(uint16_t address)
+{
+    return chrWindow[address];
+}
+
+inline void Mapper7::WriteCHR(uint16_t address, uint8_t value)
+{
+    if (cartridge->HasCHRRam())
+    {
+        chrWindow[address] = value;
+    }
+}
+
+#endif //_MAPPER_7_H_
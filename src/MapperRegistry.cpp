@@ -0,0 +1,44 @@
+#include "MapperRegistry.h"
+
+MapperEntry* MapperRegistry::GetEntries()
+{
+    // Mappers register themselves while static objects are initialized, so the table can't be a static member
+    static MapperEntry entries[256];
+    return entries;
+}
+
+bool MapperRegistry::Register(uint8_t number, MapperEntry entry)
+{
+    GetEntries()[number] = entry;
+    return true;
+}
+
+Mapper* MapperRegistry::CreateMapper(Cartridge *cartridge)
+{
+    MapperEntry &entry = GetEntries()[cartridge->GetMapperNumber()];
+    if (entry.createMapper == NULL)
+    {
+        return NULL;
+    }
+    return entry.createMapper(cartridge);
+}
+
+Memory* MapperRegistry::CreateMemoryCPU(uint8_t number)
+{
+    MapperEntry &entry = GetEntries()[number];
+    if (entry.createMemoryCPU == NULL)
+    {
+        return new MemoryCPU();
+    }
+    return entry.createMemoryCPU();
+}
+
+Memory* MapperRegistry::CreateMemoryPPU(uint8_t number)
+{
+    MapperEntry &entry = GetEntries()[number];
+    if (entry.createMemoryPPU == NULL)
+    {
+        return new MemoryPPU();
+    }
+    return entry.createMemoryPPU();
+}
@@ -0,0 +1,68 @@
+#ifndef _MAPPER_REGISTRY_H_
+#define _MAPPER_REGISTRY_H_
+
+#include "Mapper.h"
+#include "MemoryCPU.h"
+#include "MemoryPPU.h"
+
+typedef Mapper* (*CreateMapperFunction)(Cartridge *cartridge);
+typedef Memory* (*CreateMemoryFunction)();
+
+struct MapperEntry
+{
+    CreateMapperFunction createMapper;
+    // CPU/PPU memory whose cartridge accesses are specialized for this mapper
+    CreateMemoryFunction createMemoryCPU;
+    CreateMemoryFunction createMemoryPPU;
+};
+
+/*
+ * Every mapper registers itself here with REGISTER_MAPPER in its own .cpp file, so adding a mapper
+ * doesn't need to touch Mapper::GetMapper
+ * - REGISTER_MAPPER: The CPU/PPU memory is instantiated for the concrete mapper class, so the bus accesses
+ *   to PRG/CHR are inlined instead of going through the virtual interface of Mapper. Use it for common mappers
+ *   (The mapper class must be final)
+ * - REGISTER_GENERIC_MAPPER: The CPU/PPU memory uses the virtual interface of Mapper. Use it for rare mappers
+ *   to keep the binary small
+ */
+class MapperRegistry
+{
+    public:
+        static bool Register(uint8_t number, MapperEntry entry);
+        static Mapper* CreateMapper(Cartridge *cartridge);
+        static Memory* CreateMemoryCPU(uint8_t number);
+        static Memory* CreateMemoryPPU(uint8_t number);
+
+    private:
+        static MapperEntry* GetEntries();
+};
+
+template<class Type, class BaseType>
+BaseType* CreateInstance()
+{
+    return new Type();
+}
+
+template<class MapperType>
+Mapper* CreateMapperInstance(Cartridge *cartridge)
+{
+    return new MapperType(cartridge);
+}
+
+#define REGISTER_MAPPER(number, MapperType) \
+    static bool mapper##number##Registered = MapperRegistry::Register(number, \
+    { \
+        &CreateMapperInstance<MapperType>, \
+        &CreateInstance<MemoryCPUMapper<MapperType>, Memory>, \
+        &CreateInstance<MemoryPPUMapper<MapperType>, Memory> \
+    })
+
+#define REGISTER_GENERIC_MAPPER(number, MapperType) \
+    static bool mapper##number##Registered = MapperRegistry::Register(number, \
+    { \
+        &CreateMapperInstance<MapperType>, \
+        &CreateInstance<MemoryCPU, Memory>, \
+        &CreateInstance<MemoryPPU, Memory> \
+    })
+
+#endif //_MAPPER_REGISTRY_H_
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "Mapper.h"
 #include "Controller.h"
+#include "MemoryWatch.h"
 
 class PPU;
 class Memory
@@ -14,25 +15,46 @@ class Memory
             ppu = NULL;
             mapper = NULL;
         }
+        virtual ~Memory() {}
         void SetPPU(PPU *ppu)
         {
             this->ppu = ppu;
         }
-        void SetMapper(Mapper *mapper)
+        virtual void SetMapper(Mapper *mapper)
         {
             this->mapper = mapper;
         }
+        Mapper* GetMapper()
+        {
+            return mapper;
+        }
+        PPU* GetPPU()
+        {
+            return ppu;
+        }
+        // Watchpoints and heatmap of this memory (see MemoryWatch.h)
+        MemoryWatchPolicy& GetWatch()
+        {
+            return watch;
+        }
         void SetController(Controller *controller)
         {
             this->controller = controller;
         }
         virtual uint8_t Read(uint16_t address) = 0;
         virtual void Write(uint16_t address, uint8_t value) = 0;
+        // The 256 bytes of the page $XX00-$XXFF when they can be read at once without side effects, otherwise NULL and the page
+        // must be read byte by byte (see PPU::WriteDMA)
+        virtual const uint8_t* GetPage(uint8_t page)
+        {
+            return NULL;
+        }
 
     protected:
         PPU *ppu; // only used in MemoryCPU to Write/Read PPU Registry
         Mapper *mapper;
         Controller *controller;
+        MemoryWatchPolicy watch;
 };
 
 #endif //_MEMORY_H_
\ No newline at end of file
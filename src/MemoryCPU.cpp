@@ -4,6 +4,8 @@
 
 MemoryCPU::MemoryCPU()
 {
+    watch.SetAddressSpace("CPU", 0x10000);
+    decodeCache = NULL;
     // Initialize ram memory
     for (uint16_t i = 0; i < 0x800; i += 0x10)
     {
@@ -16,42 +18,81 @@ MemoryCPU::MemoryCPU()
 
 uint8_t MemoryCPU::Read(uint16_t address)
 {
-    uint8_t value = 0;
-    if (address < 0x0800)
+    return ReadBus<Mapper>(address);
+}
+
+void MemoryCPU::Write(uint16_t address, uint8_t value)
+{
+    WriteBus<Mapper>(address, value);
+}
+
+uint8_t* MemoryCPU::GetRAM()
+{
+    return ram;
+}
+
+void MemoryCPU::SetDecodeCache(DecodeCache *decodeCache)
+{
+    this->decodeCache = decodeCache;
+}
+
+uint32_t MemoryCPU::GetCyclesUntilVBlank()
+{
+    return pipeline.IsRunning() ? pipeline.GetCyclesUntilVBlank() : ppu->GetCyclesUntilVBlank();
+}
+
+uint8_t MemoryCPU::GetPPUStatus()
+{
+    pipeline.BeginAccess();
+    uint8_t status = ppu->GetStatus();
+    pipeline.EndAccess();
+    return status;
+}
+
+const uint8_t* MemoryCPU::GetPage(uint8_t page)
+{
+    uint16_t address = uint16_t(page) << 8;
+    const uint8_t *data;
+    if (address < 0x2000)
     {
-        value = ram[address];  
+        // 0x0800-0x1FFF mirrors 0x0000-0x07FF
+        data = &ram[address & 0x07FF];
     }
-    else if (address < 0x2000)
+    else if (address >= 0x6000)
     {
-        // 0x0800-0x1FFF mirrors 0x0000-0x07FF
-        value = ram[address & 0x07FF];
+        data = mapper->GetPage(address);
     }
-    else if (address < 0x2008)
+    else
     {
-        // 0x2000-0x2007: I/O Register (PPU)
-        switch(address)
-        {
-            case 0x2002:
-            case 0x2004:
-            case 0x2007:
-                value = ppu->ReadRegister(address);
-                break;
-        }
-        
+        // The reads of the registers have side effects
+        return NULL;
+    }
+    for (uint16_t i = 0; i < 0x100; ++i)
+    {
+        watch.Read(address + i, data[i]);
     }
-    else if (address < 0x4000)
+    return data;
+}
+
+uint8_t MemoryCPU::ReadRegister(uint16_t address)
+{
+    uint8_t value = 0;
+    if (address < 0x4000)
     {
+        // 0x2000-0x2007: I/O Register (PPU)
         // 0x2008-0x3FFF mirrors 0x2000-0x2007
         switch(address & 0x2007)
         {
             case 0x2002:
             case 0x2004:
             case 0x2007:
+                pipeline.BeginAccess();
                 value = ppu->ReadRegister(address & 0x2007);
+                pipeline.EndAccess();
                 break;
         }
     }
-    else if (address < 0x4020)
+    else
     {
         // 0x4000-0x401F: I/O Register (APU, Joypad)
         if (address == 0x4016) // Controller1
@@ -59,44 +100,28 @@ uint8_t MemoryCPU::Read(uint16_t address)
             value = controller->Read();
         }
     }
-    else
-    {
-        // Mapper
-        value = mapper->Read(address);
-    }
     return value;
 }
 
-void MemoryCPU::Write(uint16_t address, uint8_t value)
+void MemoryCPU::WriteRegister(uint16_t address, uint8_t value)
 {
-    if (address < 0x0800)
-    {   
-        ram[address] = value;  
-    }
-    else if (address < 0x2000)
-    {
-        // 0x0800-0x1FFF mirrors 0x0000-0x07FF
-        ram[address & 0x07FF] = value;
-    }
-    else if (address < 0x2008)
+    if (address < 0x4000)
     {
         // 0x2000-0x2007: I/O Register (PPU)
-        if (address == 0x2002)
-        {
-            return;
-        }
-        ppu->WriteRegister(address, value);
-    }
-    else if (address < 0x4000)
-    {
         // 0x2008-0x3FFF mirrors 0x2000-0x2007
         if ((address & 0x2007) == 0x2002)
         {
             return;
         }
-        ppu->WriteRegister(address & 0x2007, value);
+        // PPUCTRL may raise an NMI, the other registers are written by the PPU thread (see PPUPipeline.h)
+        if (((address & 0x2007) == 0x2000) || !pipeline.Queue(address & 0x2007, value))
+        {
+            pipeline.BeginAccess();
+            ppu->WriteRegister(address & 0x2007, value);
+            pipeline.EndAccess();
+        }
     }
-    else if (address < 0x4020)
+    else
     {
         // 0x4000-0x401F: I/O Register (APU, Joypad)
         if (address == 0x4016) // Controller1
@@ -105,12 +130,9 @@ void MemoryCPU::Write(uint16_t address, uint8_t value)
         }
         else if (address == 0x4014) //PPU DMA
         {    
+            pipeline.BeginAccess();
             ppu->WriteRegister(address, value);  
+            pipeline.EndAccess();
         }
     }
-    else
-    {
-        // Mapper
-        mapper->Write(address, value);
-    }
-}
\ No newline at end of file
+}
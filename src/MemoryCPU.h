@@ -2,17 +2,39 @@
 #define _MEMORY_CPU_H_
 
 #include "Memory.h"
+#include "DecodeCache.h"
+#include "PPUPipeline.h"
 
 class MemoryCPU : public Memory
 {
     public:
         MemoryCPU();
         void SetPPU(PPU *ppu);
-        void SetMapper(Mapper *mapper);
         uint8_t Read(uint16_t address);
         void Write(uint16_t address, uint8_t value);
+        // 2KB internal RAM, used by the JIT to access RAM without the bus (see Jit.h)
+        uint8_t* GetRAM();
+        // The RAM writes are reported to decodeCache, so it drops the instructions that are overwritten (see DecodeCache.h)
+        void SetDecodeCache(DecodeCache *decodeCache);
+        // The PPU thread, when the PPU runs behind the CPU (see PPUPipeline.h)
+        PPUPipelinePolicy& GetPipeline();
+        // PPU state at the CPU time, also when the PPU thread is behind the CPU
+        uint32_t GetCyclesUntilVBlank();
+        uint8_t GetPPUStatus();
+        // The 256 bytes of the RAM/SRAM/PRG-ROM page $XX00-$XXFF, or NULL for the I/O pages $2000-$5FFF (see PPU::WriteDMA)
+        const uint8_t* GetPage(uint8_t page);
+
+    protected:
+        /*
+         * Bus access with the cartridge space dispatched to MapperType (see Mapper::ReadCartridge)
+         * RAM and cartridge accesses are inlined, the I/O registers are handled by ReadRegister/WriteRegister
+         */
+        template<class MapperType> uint8_t ReadBus(uint16_t address);
+        template<class MapperType> void WriteBus(uint16_t address, uint8_t value);
+        // $2000-$401F: I/O Register (PPU, APU, Joypad)
+        uint8_t ReadRegister(uint16_t address);
+        void WriteRegister(uint16_t address, uint8_t value);
 
-    private:
         /* 
          * The 6502 has a 16-bit address bus and as such could support 64KB of memery with address from 0x0000-0xFFFF
          *
@@ -27,6 +49,83 @@ class MemoryCPU : public Memory
          * $4020-$FFFF      $BFE0   Cartridge space: PRG ROM, PRG RAM, and mapper registers
          */
         uint8_t ram[0x800];
+        DecodeCache *decodeCache;
+        PPUPipelinePolicy pipeline;
+};
+
+// CPU memory specialized for a concrete mapper class. It is created by MapperRegistry
+template<class MapperType>
+class MemoryCPUMapper : public MemoryCPU
+{
+    public:
+        uint8_t Read(uint16_t address)
+        {
+            return ReadBus<MapperType>(address);
+        }
+        void Write(uint16_t address, uint8_t value)
+        {
+            WriteBus<MapperType>(address, value);
+        }
 };
 
-#endif //_MEMORY_CPU_H_
\ No newline at end of file
+template<class MapperType>
+inline uint8_t MemoryCPU::ReadBus(uint16_t address)
+{
+    uint8_t value;
+    if (address < 0x2000)
+    {
+        // 0x0000-0x07FF: RAM. 0x0800-0x1FFF mirrors 0x0000-0x07FF
+        value = ram[address & 0x07FF];
+    }
+    else if (address < 0x4020)
+    {
+        // 0x2000-0x401F: I/O Register
+        value = ReadRegister(address);
+    }
+    else
+    {
+        // Mapper
+        value = mapper->ReadCartridge<MapperType>(address);
+    }
+    watch.Read(address, value);
+    return value;
+}
+
+template<class MapperType>
+inline void MemoryCPU::WriteBus(uint16_t address, uint8_t value)
+{
+    watch.Write(address, value);
+    if (address < 0x2000)
+    {
+        // 0x0000-0x07FF: RAM. 0x0800-0x1FFF mirrors 0x0000-0x07FF
+        ram[address & 0x07FF] = value;
+        if (decodeCache != NULL)
+        {
+            decodeCache->WriteRAM(address & 0x07FF);
+        }
+    }
+    else if (address < 0x4020)
+    {
+        // 0x2000-0x401F: I/O Register
+        WriteRegister(address, value);
+    }
+    else if (address < 0x8000)
+    {
+        // SRAM. The PPU never reads it
+        mapper->WriteCartridge<MapperType>(address, value);
+    }
+    else
+    {
+        // Mapper registers. The PPU reads the CHR banks and the mirroring, so it must be at the time of the write
+        pipeline.BeginAccess();
+        mapper->WriteCartridge<MapperType>(address, value);
+        pipeline.EndAccess();
+    }
+}
+
+inline PPUPipelinePolicy& MemoryCPU::GetPipeline()
+{
+    return pipeline;
+}
+
+#endif //_MEMORY_CPU_H_
@@ -5,17 +5,102 @@
 class MemoryPPU : public Memory
 {
     public:
+        MemoryPPU();
         void SetMapper(Mapper *mapper);
         uint8_t Read(uint16_t address);
         void Write(uint16_t address, uint8_t value);
+        // Called by the mapper when the mirroring changes
+        void SetMirroring(Mirroring mirroring);
+
+    protected:
+        // Bus access with the pattern tables dispatched to MapperType (see Mapper::ReadCartridge)
+        template<class MapperType> uint8_t ReadBus(uint16_t address);
+        template<class MapperType> void WriteBus(uint16_t address, uint8_t value);
 
-    private:
         // $2000-$2FFF: Nametables
         uint8_t nametables[0x1000];
+        /*
+         * The 4 nametables ($2000, $2400, $2800, $2C00) point to 1KB pages of the VRAM above
+         * They are only recomputed when the mirroring changes so a nametable access doesn't need to check the mirroring
+         */
+        uint8_t *nametablePages[4];
         // $3F00-$3F1F: Patlette
         uint8_t palette[0x20/*32*/]; 
+};
 
-        uint16_t GetMirrorAddress(uint16_t address);
+// PPU memory specialized for a concrete mapper class. It is created by MapperRegistry
+template<class MapperType>
+class MemoryPPUMapper : public MemoryPPU
+{
+    public:
+        uint8_t Read(uint16_t address)
+        {
+            return ReadBus<MapperType>(address);
+        }
+        void Write(uint16_t address, uint8_t value)
+        {
+            WriteBus<MapperType>(address, value);
+        }
 };
 
-#endif
\ No newline at end of file
+template<class MapperType>
+inline uint8_t MemoryPPU::ReadBus(uint16_t address)
+{
+    uint8_t value = 0;
+    //$4000-$FFFF: Mirrors $0000-$3FFF
+    address &= 0x3FFF;
+    if (address < 0x2000)
+    {
+        //$0000-$1FFF: Pattern Tables
+        value = static_cast<MapperType *>(mapper)->ReadCHR(address);
+    }
+    else if (address < 0x3F00)
+    {
+        //$2000-$2FFF:  Nametables
+        //$3000-$3EFF: Mirrors $2000-$2FFF 
+        value = nametablePages[(address >> 10) & 0x03][address & 0x3FF];
+    }
+    else
+    {
+        // Palette
+        uint8_t index = address % 32;
+        if ((index % 4) == 0)
+        {
+            index = 0;
+        }
+        value = palette[index];
+    }
+    watch.Read(address, value);
+    return value;
+}
+
+template<class MapperType>
+inline void MemoryPPU::WriteBus(uint16_t address, uint8_t value)
+{
+    //$4000-$FFFF: Mirrors $0000-$3FFF
+    address &= 0x3FFF;
+    watch.Write(address, value);
+    if (address < 0x2000)
+    {
+        //$0000-$1FFF: Pattern Tables
+        static_cast<MapperType *>(mapper)->WriteCHR(address, value);
+    }
+    else if (address < 0x3F00)
+    {
+        //$2000-$2FFF:  Nametables
+        //$3000-$3EFF: Mirrors $2000-$2FFF 
+        nametablePages[(address >> 10) & 0x03][address & 0x3FF] = value;
+    }
+    else
+    {
+        // Palette
+        address = address % 32;
+        if (address == 16)
+        {
+            address = 0;
+        }
+        palette[address] = value;
+    }
+}
+
+#endif
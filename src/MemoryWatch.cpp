@@ -0,0 +1,156 @@
+#include "MemoryWatch.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+MemoryWatch::MemoryWatch()
+{
+    breakRequested = false;
+    SetAddressSpace("Memory", 0x10000);
+}
+
+void MemoryWatch::SetAddressSpace(const char *name, uint32_t size)
+{
+    this->name = name;
+    this->size = size;
+    watchpoints.assign(size, 0);
+    reads.assign(size, 0);
+    writes.assign(size, 0);
+    executes.assign(size, 0);
+}
+
+void MemoryWatch::AddWatchpoint(uint16_t first, uint16_t last, uint8_t accesses, WatchAction action)
+{
+    uint8_t flags = (action == WatchBreak) ? (accesses << 4) : accesses;
+    for (uint32_t address = first; (address <= last) && (address < size); ++address)
+    {
+        watchpoints[address] |= flags;
+    }
+}
+
+void MemoryWatch::RemoveWatchpoints(uint16_t first, uint16_t last)
+{
+    for (uint32_t address = first; (address <= last) && (address < size); ++address)
+    {
+        watchpoints[address] = 0;
+    }
+}
+
+void MemoryWatch::Resume()
+{
+    breakRequested = false;
+}
+
+uint32_t MemoryWatch::GetCount(WatchAccess access, uint16_t address)
+{
+    if (address >= size)
+    {
+        return 0;
+    }
+    switch (access)
+    {
+        case WatchRead:
+            return reads[address];
+        case WatchWrite:
+            return writes[address];
+        default:
+            return executes[address];
+    }
+}
+
+void MemoryWatch::Hit(uint16_t address, WatchAccess access, uint8_t value)
+{
+    bool isBreak = (watchpoints[address] & (access << 4)) != 0;
+    switch (access)
+    {
+        case WatchRead:
+            LOGI("%s %s: read $%04X = $%02X", name, isBreak ? "break" : "watch", address, value);
+            break;
+        case WatchWrite:
+            LOGI("%s %s: write $%04X = $%02X", name, isBreak ? "break" : "watch", address, value);
+            break;
+        default:
+            LOGI("%s %s: execute $%04X", name, isBreak ? "break" : "watch", address);
+            break;
+    }
+    if (isBreak)
+    {
+        breakRequested = true;
+    }
+}
+
+bool MemoryWatch::WriteHeatmap(const char *fileName)
+{
+    FILE *file = fopen(fileName, "wb");
+    if (file == NULL)
+    {
+        LOGI("Can't open heatmap file %s", fileName);
+        return false;
+    }
+    // The counts are shown on a log scale relative to the most accessed address, otherwise only the hottest loop is visible
+    uint32_t maxCount = 1;
+    for (uint32_t address = 0; address < size; ++address)
+    {
+        maxCount = std::max(maxCount, std::max(reads[address], std::max(writes[address], executes[address])));
+    }
+    double scale = 255.0 / log(1.0 + maxCount);
+    fprintf(file, "P6\n256 %d\n255\n", int((size + 255) / 256));
+    for (uint32_t address = 0; address < size; ++address)
+    {
+        uint8_t pixel[3];
+        pixel[0] = uint8_t(log(1.0 + writes[address]) * scale);
+        pixel[1] = uint8_t(log(1.0 + reads[address]) * scale);
+        pixel[2] = uint8_t(log(1.0 + executes[address]) * scale);
+        fwrite(pixel, 1, sizeof(pixel), file);
+    }
+    fclose(file);
+    return true;
+}
+
+bool MemoryWatch::LoadWatchpoints(const char *fileName, MemoryWatch &cpuWatch, MemoryWatch &ppuWatch)
+{
+    std::ifstream file(fileName);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (getline(file, line))
+    {
+        ++lineNumber;
+        std::string memory, accesses, range, action;
+        std::istringstream is(line);
+        if (!(is >> memory) || (memory[0] == '#'))
+        {
+            // Empty line or comment
+            continue;
+        }
+        unsigned int first = 0;
+        unsigned int last = 0;
+        is >> accesses >> range >> action;
+        int numAddresses = sscanf(range.c_str(), "%x-%x", &first, &last);
+        if (numAddresses == 1)
+        {
+            last = first;
+        }
+        uint8_t accessFlags = 0;
+        for (size_t i = 0; i < accesses.size(); ++i)
+        {
+            accessFlags |= (accesses[i] == 'r') ? WatchRead : (accesses[i] == 'w') ? WatchWrite : (accesses[i] == 'x') ? WatchExecute : 0x80;
+        }
+        MemoryWatch *watch = (memory == "cpu") ? &cpuWatch : (memory == "ppu") ? &ppuWatch : NULL;
+        if ((watch == NULL) || (numAddresses < 1) || (accessFlags == 0) || ((accessFlags & 0x80) != 0) ||
+            (first > last) || ((action != "log") && (action != "break")))
+        {
+            LOGI("Bad watchpoint at line %d of %s", lineNumber, fileName);
+            return false;
+        }
+        watch->AddWatchpoint(first, last, accessFlags, (action == "break") ? WatchBreak : WatchLog);
+    }
+    return true;
+}
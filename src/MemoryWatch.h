@@ -0,0 +1,113 @@
+#ifndef _MEMORY_WATCH_H_
+#define _MEMORY_WATCH_H_
+
+#include <stdint.h>
+#include <vector>
+#include "Platforms.h"
+
+/*
+ * Watchpoints and access heatmap of a memory (CPU: 64K addresses, PPU: 16K addresses). Enabled by defining _WATCH_MEMORY_ in Platforms.h
+ * - Every memory has a watch called from its bus access (MemoryCPU::ReadBus/WriteBus, MemoryPPU::ReadBus/WriteBus) and the CPU
+ *   reports the opcode fetches as executes. The reads, writes and executes are counted per address
+ * - A watchpoint logs or breaks on some accesses of an address range. A break stops Console::StepSeconds/StepFrame after the
+ *   current instruction until Console::Resume is called
+ * - The watchpoints are loaded from WATCH_FILE, one per line: <cpu|ppu> <r|w|x...> <first>[-<last>] <log|break> (hex addresses)
+ *   e.g. "cpu w 0300-03FF break" or "ppu rw 3F00 log"
+ * - The heatmaps are written as PPM images (one pixel per address, 256 addresses per row, red: writes, green: reads, blue: executes)
+ * When the watch is compiled out the memories use NullMemoryWatch whose empty inline functions cost nothing
+ */
+enum WatchAccess
+{
+    WatchRead = 0x01,
+    WatchWrite = 0x02,
+    WatchExecute = 0x04
+};
+
+enum WatchAction
+{
+    WatchLog,
+    WatchBreak
+};
+
+class MemoryWatch
+{
+    public:
+        MemoryWatch();
+        // name: used in the log. size: number of addresses
+        void SetAddressSpace(const char *name, uint32_t size);
+        // accesses: WatchAccess flags
+        void AddWatchpoint(uint16_t first, uint16_t last, uint8_t accesses, WatchAction action);
+        void RemoveWatchpoints(uint16_t first, uint16_t last);
+        void Read(uint16_t address, uint8_t value);
+        void Write(uint16_t address, uint8_t value);
+        void Execute(uint16_t address);
+        bool IsBreakRequested();
+        void Resume();
+        uint32_t GetCount(WatchAccess access, uint16_t address);
+        bool WriteHeatmap(const char *fileName);
+        // Parse a watchpoint file (see above). Return false if it can't be opened or has a bad line
+        static bool LoadWatchpoints(const char *fileName, MemoryWatch &cpuWatch, MemoryWatch &ppuWatch);
+
+    private:
+        const char *name;
+        uint32_t size;
+        // Per address: the accesses to log in the low bits, the accesses to break on in the high bits
+        std::vector<uint8_t> watchpoints;
+        std::vector<uint32_t> reads;
+        std::vector<uint32_t> writes;
+        std::vector<uint32_t> executes;
+        bool breakRequested;
+
+        void Hit(uint16_t address, WatchAccess access, uint8_t value);
+};
+
+inline void MemoryWatch::Read(uint16_t address, uint8_t value)
+{
+    ++reads[address];
+    if ((watchpoints[address] & (WatchRead | (WatchRead << 4))) != 0)
+    {
+        Hit(address, WatchRead, value);
+    }
+}
+
+inline void MemoryWatch::Write(uint16_t address, uint8_t value)
+{
+    ++writes[address];
+    if ((watchpoints[address] & (WatchWrite | (WatchWrite << 4))) != 0)
+    {
+        Hit(address, WatchWrite, value);
+    }
+}
+
+inline void MemoryWatch::Execute(uint16_t address)
+{
+    ++executes[address];
+    if ((watchpoints[address] & (WatchExecute | (WatchExecute << 4))) != 0)
+    {
+        Hit(address, WatchExecute, 0);
+    }
+}
+
+inline bool MemoryWatch::IsBreakRequested()
+{
+    return breakRequested;
+}
+
+class NullMemoryWatch
+{
+    public:
+        void SetAddressSpace(const char *name, uint32_t size) {}
+        void Read(uint16_t address, uint8_t value) {}
+        void Write(uint16_t address, uint8_t value) {}
+        void Execute(uint16_t address) {}
+        bool IsBreakRequested() { return false; }
+        void Resume() {}
+};
+
+#ifdef _WATCH_MEMORY_
+typedef MemoryWatch MemoryWatchPolicy;
+#else
+typedef NullMemoryWatch MemoryWatchPolicy;
+#endif
+
+#endif //_MEMORY_WATCH_H_
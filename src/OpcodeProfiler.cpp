@@ -0,0 +1,97 @@
+#include "OpcodeProfiler.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+OpcodeProfiler::OpcodeProfiler()
+{
+    memset(executions, 0, sizeof(executions));
+    memset(cycles, 0, sizeof(cycles));
+    memset(sampledTicks, 0, sizeof(sampledTicks));
+    memset(samples, 0, sizeof(samples));
+    countdown = OPCODE_PROFILE_SAMPLE_RATE;
+    startTicks = 0;
+}
+
+struct ProfileLine
+{
+    std::string name;
+    uint64_t executions;
+    uint64_t cycles;
+    double ns; // estimated host time
+};
+
+static bool CompareTime(const ProfileLine &a, const ProfileLine &b)
+{
+    return a.ns > b.ns;
+}
+
+static void WriteLines(FILE *file, std::vector<ProfileLine> &lines, uint64_t totalCycles, double totalNs)
+{
+    std::sort(lines.begin(), lines.end(), CompareTime);
+    fprintf(file, "%-16s %14s %14s %7s %14s %7s %10s\n", "Name", "Executions", "Cycles", "Cycles%", "Host ns", "Host%", "ns/exec");
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        const ProfileLine &line = lines[i];
+        fprintf(file, "%-16s %14llu %14llu %6.2f%% %14.0f %6.2f%% %10.2f\n", line.name.c_str(),
+                (unsigned long long)line.executions, (unsigned long long)line.cycles,
+                (totalCycles > 0) ? (100.0 * line.cycles / totalCycles) : 0.0, line.ns,
+                (totalNs > 0) ? (100.0 * line.ns / totalNs) : 0.0, line.ns / line.executions);
+    }
+}
+
+void OpcodeProfiler::Report(const char *fileName, const std::string *opcodeNames, const char * const *addressModeNames)
+{
+    FILE *file = fopen(fileName, "w");
+    if (file == NULL)
+    {
+        LOGI("Can't write the opcode profile to %s", fileName);
+        return;
+    }
+    double nsPerTick = clock.GetNanosecondsPerTick();
+    std::vector<ProfileLine> opcodeLines;
+    std::map<std::string, ProfileLine> addressModeLines;
+    uint64_t totalExecutions = 0;
+    uint64_t totalCycles = 0;
+    double totalNs = 0;
+    for (uint16_t opcode = 0; opcode < 256; ++opcode)
+    {
+        if (executions[opcode] == 0)
+        {
+            continue;
+        }
+        ProfileLine line;
+        char name[32];
+        sprintf(name, "%02X %s", opcode, opcodeNames[opcode].c_str());
+        line.name = name;
+        line.executions = executions[opcode];
+        line.cycles = cycles[opcode];
+        // Scale the average sampled time by the number of executions
+        line.ns = (samples[opcode] > 0) ? (double(sampledTicks[opcode]) / samples[opcode] * nsPerTick * executions[opcode]) : 0.0;
+        opcodeLines.push_back(line);
+
+        ProfileLine &modeLine = addressModeLines[addressModeNames[opcode]];
+        modeLine.name = addressModeNames[opcode];
+        modeLine.executions += line.executions;
+        modeLine.cycles += line.cycles;
+        modeLine.ns += line.ns;
+
+        totalExecutions += line.executions;
+        totalCycles += line.cycles;
+        totalNs += line.ns;
+    }
+    fprintf(file, "Opcode profile: %llu instructions, %llu cycles, %.0f ns (1 instruction out of %d sampled)\n\n",
+            (unsigned long long)totalExecutions, (unsigned long long)totalCycles, totalNs, OPCODE_PROFILE_SAMPLE_RATE);
+    WriteLines(file, opcodeLines, totalCycles, totalNs);
+    fprintf(file, "\n");
+    std::vector<ProfileLine> modeLines;
+    for (std::map<std::string, ProfileLine>::iterator it = addressModeLines.begin(); it != addressModeLines.end(); ++it)
+    {
+        modeLines.push_back(it->second);
+    }
+    WriteLines(file, modeLines, totalCycles, totalNs);
+    fclose(file);
+    LOGI("Opcode profile is written to %s", fileName);
+}
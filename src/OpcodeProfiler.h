@@ -0,0 +1,69 @@
+#ifndef _OPCODE_PROFILER_H_
+#define _OPCODE_PROFILER_H_
+
+#include <stdint.h>
+#include <string>
+#include "Ticks.h"
+#include "Platforms.h"
+
+/*
+ * Per opcode profiler of CPU::Step. Enabled by defining _PROFILE_OPCODES_ in Platforms.h
+ * - The executions and the emulated cycles are counted for every instruction
+ * - The host time is sampled: one instruction out of OPCODE_PROFILE_SAMPLE_RATE is timed with the time stamp counter
+ *   and its time is scaled by the sample rate, so we don't pay for a clock read per instruction
+ * The CPU writes the report (sorted by host time, per opcode and per address mode) to OPCODE_PROFILE_FILE when it is destroyed
+ * When the profiler is compiled out the CPU uses NullOpcodeProfiler whose empty inline functions cost nothing
+ */
+class OpcodeProfiler
+{
+    public:
+        OpcodeProfiler();
+        void Begin();
+        void End(uint8_t opcode, uint8_t cycles);
+        // opcodeNames/addressModeNames: name of the instruction and of its address mode for each opcode
+        void Report(const char *fileName, const std::string *opcodeNames, const char * const *addressModeNames);
+
+    private:
+        uint64_t executions[256];
+        uint64_t cycles[256];
+        uint64_t sampledTicks[256];
+        uint64_t samples[256];
+        uint32_t countdown;
+        uint64_t startTicks;
+        TickClock clock;
+};
+
+inline void OpcodeProfiler::Begin()
+{
+    if (--countdown == 0)
+    {
+        startTicks = ReadTicks();
+    }
+}
+
+inline void OpcodeProfiler::End(uint8_t opcode, uint8_t cycles)
+{
+    ++executions[opcode];
+    this->cycles[opcode] += cycles;
+    if (countdown == 0)
+    {
+        sampledTicks[opcode] += ReadTicks() - startTicks;
+        ++samples[opcode];
+        countdown = OPCODE_PROFILE_SAMPLE_RATE;
+    }
+}
+
+class NullOpcodeProfiler
+{
+    public:
+        void Begin() {}
+        void End(uint8_t opcode, uint8_t cycles) {}
+};
+
+#ifdef _PROFILE_OPCODES_
+typedef OpcodeProfiler CPUProfiler;
+#else
+typedef NullOpcodeProfiler CPUProfiler;
+#endif
+
+#endif //_OPCODE_PROFILER_H_
@@ -1,6 +1,8 @@
 #include "PPU.h"
 #include <assert.h>
+#include <string.h>
 #include "Platforms.h"
+#include "Timeline.h"
 
 PPU::PPU(Memory *vram)
 {
@@ -18,9 +20,15 @@ PPU::PPU(Memory *vram)
     currentVRAMAddress = 0; // ($2005-$2006)
     internalBuffer = 0;
     oddFrame = false;
+    frameCount = 0;
+    renderInterval = 1;
+    isFrameRendered = true;
+    renderedFrameCount = 0;
+    timelineScanlineStart = 0;
     spriteCount = 0;
     nmiPrevious = false;
-    nmiDelay = 0;
+    nmiScanline = NMI_NONE;
+    nmiCycle = NMI_NONE;
     frontBuffer = buffer1;
     backBuffer = buffer2;
     for(uint16_t y = 0; y < SCREEN_HEIGHT; ++y)  
@@ -28,6 +36,7 @@ PPU::PPU(Memory *vram)
         for(uint16_t x = 0; x < SCREEN_WIDTH; ++x)
         {
             frontBuffer[y][x] = 0;
+            backBuffer[y][x] = 0;
         }
     }
 }
@@ -35,6 +44,7 @@ PPU::PPU(Memory *vram)
 void PPU::SetCPU(CPU *cpu)
 {
     this->cpu = cpu;
+    cpu->busClock.SetPPU(this);
 }
 
 void PPU::WriteRegister(uint16_t address, uint8_t value)
@@ -188,16 +198,25 @@ void PPU::WriteDMA(uint8_t value)
 {
     uint16_t address = uint16_t(value) << 8;
     // Writing $XX will upload 256 bytes of data from CPU page $XX00-$XXFF to the internal PPU OAM
-    for (uint16_t i = 0; i < 256; ++i)
+    const uint8_t *page = cpu->cpuMemory->GetPage(value);
+    if (page != NULL)
     {
-        primaryOAM[oamAddress++] = cpu->cpuMemory->Read(address + i);
+        // RAM, SRAM or PRG-ROM: copy the page at once, from oamAddress and wrapping around the end of the OAM
+        uint16_t size = 256 - oamAddress;
+        memcpy(&primaryOAM[oamAddress], page, size);
+        memcpy(primaryOAM, page + size, oamAddress);
     }
-    // On sprite DMA's, cpu is suspended by 513 or 514 cycles (1 dummy read cycle while waiting for writes to complete, +1 if on an odd CPU cycle)
-    cpu->stall += 513;
-    if (cpu->cycles % 2 == 0)
+    else
     {
-        ++cpu->stall;
+        // I/O page: every byte is read through the bus
+        for (uint16_t i = 0; i < 256; ++i)
+        {
+            primaryOAM[oamAddress++] = cpu->cpuMemory->Read(address + i);
+        }
     }
+    // On sprite DMA's, cpu is suspended by 513 or 514 cycles (1 dummy read cycle while waiting for writes to complete, +1 if on an odd CPU cycle)
+    cpu->Stall((cpu->cycles % 2 == 0) ? 514 : 513);
+    TIMELINE_INSTANT("DMA stall", "CPU", cpu->stall);
 }
 
 // 0x2002
@@ -266,7 +285,14 @@ void PPU::NMIChanged()
     bool nmi = (statusRegister.bits.vblank == 1) && (controlRegister.bits.generateNMI == 1);
     if (nmi && !nmiPrevious) // if it is in the Interrup. Don't call it again
     {
-        nmiDelay = 10;
+        TIMELINE_INSTANT("NMI raised", "PPU", scanline);
+        nmiCycle = cycles + NMI_DELAY;
+        nmiScanline = scanline;
+        if (nmiCycle > 340)
+        {
+            nmiCycle -= 341;
+            nmiScanline = (nmiScanline + 1) % 262;
+        }
     }
     nmiPrevious = nmi;
 }
@@ -559,6 +585,11 @@ void PPU::RenderPixel()
      * If the sprite has foreground priority or the BG pixel is zero, the sprite pixel is output
      * If the sprite has background priority and the BG pixel is nonzero, the BG pixel is output
      */
+    if (!isFrameRendered && ((spriteCount == 0) || !secondaryOAM[0].isSpriteZero || (statusRegister.bits.sprite0Hit == 1)))
+    {
+        // The frame isn't output and the sprite 0 can't hit on this pixel. Sprite 0 is always the first sprite of the scanline
+        return;
+    }
     uint8_t x = cycles - 1;
     uint8_t y = scanline;
     uint8_t color;
@@ -623,17 +654,21 @@ void PPU::RenderPixel()
             statusRegister.bits.sprite0Hit = 1;
         }
     }
-    backBuffer[scanline][cycles - 1] = vram->Read(color | 0x3F00);
+    if (isFrameRendered)
+    {
+        backBuffer[scanline][cycles - 1] = vram->Read(color | 0x3F00);
+    }
 }
 
 void PPU::Step()
 {
-    if (nmiDelay > 0)
+    if ((cycles == nmiCycle) && (scanline == nmiScanline))
     {
-        --nmiDelay;
-         // Call NMI interrup
+        nmiScanline = NMI_NONE;
+        nmiCycle = NMI_NONE;
+         // Call NMI interrup if the line is still asserted
         #ifndef _DEBUG_
-            if ((nmiDelay == 0) && (statusRegister.bits.vblank == 1) && (controlRegister.bits.generateNMI == 1))
+            if ((statusRegister.bits.vblank == 1) && (controlRegister.bits.generateNMI == 1))
             {
                 cpu->TriggerNMI();
             }
@@ -646,6 +681,8 @@ void PPU::Step()
          * on the first visible scanline (by jumping directly from (261,339) on the pre-render scanline to (0,0) on the first visible scanline 
          * and doing the last cycle of the last dummy nametable fetch there instead
          */
+        TIMELINE_COMPLETE("Scanline", "PPU", timelineScanlineStart, scanline);
+        timelineScanlineStart = TIMELINE_NOW();
         scanline = 0;
         cycles = 0;
         oddFrame = !oddFrame;
@@ -655,6 +692,8 @@ void PPU::Step()
         ++cycles;
         if (cycles > 340)
         {
+            TIMELINE_COMPLETE("Scanline", "PPU", timelineScanlineStart, scanline);
+            timelineScanlineStart = TIMELINE_NOW();
             cycles = 0;
             ++scanline;
             if (scanline > 261)
@@ -742,7 +781,14 @@ void PPU::Step()
     {
         // Set VB flag
         statusRegister.bits.vblank = 1;
-        SwapBuffer(); 
+        TIMELINE_INSTANT("VBlank", "PPU", frameCount);
+        if (isFrameRendered)
+        {
+            SwapBuffer(); 
+            ++renderedFrameCount;
+        }
+        ++frameCount;
+        isFrameRendered = (frameCount % renderInterval) == 0;
         NMIChanged();    
     }
     if (preRenderScanline && cycles == 1)
@@ -755,10 +801,60 @@ void PPU::Step()
     }
 }
 
+uint32_t PPU::GetFrameCount()
+{
+    return frameCount;
+}
+
+uint16_t PPU::GetScanline()
+{
+    return scanline;
+}
+
+uint16_t PPU::GetCycle()
+{
+    return cycles;
+}
+
+uint8_t PPU::GetStatus()
+{
+    return statusRegister.byte;
+}
+
+uint32_t PPU::GetCyclesUntilVBlank()
+{
+    if (nmiScanline != NMI_NONE)
+    {
+        // An NMI is raised by the Step starting at its position
+        return (nmiScanline * 341 + nmiCycle + 262 * 341 - (scanline * 341 + cycles)) % (262 * 341);
+    }
+    // The VBlank flag is set at (241, 1)
+    const uint32_t frameCycles = 262 * 341;
+    uint32_t position = scanline * 341 + cycles;
+    uint32_t distance = (241 * 341 + 1 + frameCycles - position) % frameCycles;
+    if (distance == 0)
+    {
+        distance = frameCycles;
+    }
+    // The cycle setting the flag isn't safe, and odd frames may skip 1 cycle when the rendering is enabled
+    return (distance > 2) ? distance - 2 : 0;
+}
+
 void PPU::SwapBuffer()
 {
+    TIMELINE_INSTANT("SwapBuffer", "PPU", frameCount);
     uint8_t (*temp)[SCREEN_WIDTH];
     temp = frontBuffer;
     frontBuffer = backBuffer;
-    backBuffer = frontBuffer;
+    backBuffer = temp;
+}
+
+void PPU::SetRenderInterval(uint32_t interval)
+{
+    renderInterval = (interval > 0) ? interval : 1;
+}
+
+uint32_t PPU::GetRenderedFrameCount()
+{
+    return renderedFrameCount;
 }
\ No newline at end of file
@@ -5,6 +5,10 @@
 #include "MemoryPPU.h"
 #include "Platforms.h"
 
+// PPU cycles from the assertion of the NMI line to the CPU seeing it (see PPU::NMIChanged)
+#define NMI_DELAY 9
+#define NMI_NONE 0xFFFF
+
 struct Sprite
 {
     uint8_t positionY;
@@ -58,6 +62,22 @@ class PPU
         void WriteRegister(uint16_t address, uint8_t value);
         uint8_t ReadRegister(uint16_t address);
         void Step();
+        // Number of frames rendered since power up. It is increased at the start of the vertical blank
+        uint32_t GetFrameCount();
+        // Current position of the PPU: scanline 0-261 and cycle 0-340
+        uint16_t GetScanline();
+        uint16_t GetCycle();
+        // Number of PPU cycles that can run without setting the VBlank flag or raising an NMI
+        uint32_t GetCyclesUntilVBlank();
+        // Value of PPUSTATUS ($2002) without the side effects of a read
+        uint8_t GetStatus();
+        /*
+         * Output the pixels of 1 frame out of interval (1: every frame). The other frames only compute the sprite 0 hit and
+         * overflow flags, and frontBuffer keeps the last output frame
+         */
+        void SetRenderInterval(uint32_t interval);
+        // Number of frames output to frontBuffer since power up
+        uint32_t GetRenderedFrameCount();
         uint8_t (*frontBuffer)[SCREEN_WIDTH];
 
     private:
@@ -355,6 +375,13 @@ class PPU
          * visible scanline and doing the last cycle of the last dummy nametable fetch there instead
          */
         bool oddFrame;
+        uint32_t frameCount;
+        // Render skipping (see SetRenderInterval)
+        uint32_t renderInterval;
+        bool isFrameRendered;
+        uint32_t renderedFrameCount;
+        // Start time of the current scanline in the timeline (see Timeline.h)
+        uint64_t timelineScanlineStart;
 
         // 0x2000
         void WriteControl(uint8_t value);
@@ -396,7 +423,12 @@ class PPU
          * NMI_output: bit 7 of PPUCTRL 
          */
         bool nmiPrevious;
-        uint8_t nmiDelay;
+        /*
+         * Position (scanline, cycle) where the NMI reaches the CPU, NMI_NONE when it isn't asserted
+         * It is computed when the line is asserted, NMI_DELAY cycles later, so Step only compares it with the current position
+         */
+        uint16_t nmiScanline;
+        uint16_t nmiCycle;
         void NMIChanged();
 
         // The coarse X component of v needs to be incremented when the next tile is reached
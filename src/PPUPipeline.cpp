@@ -0,0 +1,133 @@
+#include "PPUPipeline.h"
+#include "PPU.h"
+
+PPUPipeline::PPUPipeline()
+{
+    ppu = NULL;
+    isStopRequested = false;
+    cpuTime = 0;
+    horizon = UINT64_MAX;
+    frameCount = 0;
+    publishedTime = 0;
+    ppuTime = 0;
+    head = 0;
+    tail = 0;
+}
+
+PPUPipeline::~PPUPipeline()
+{
+    Stop();
+}
+
+void PPUPipeline::Start(PPU *ppu)
+{
+    Stop();
+    this->ppu = ppu;
+    isStopRequested = false;
+    cpuTime = 0;
+    horizon = ppu->GetCyclesUntilVBlank();
+    frameCount = ppu->GetFrameCount();
+    publishedTime = 0;
+    ppuTime = 0;
+    head = 0;
+    tail = 0;
+    thread = std::thread(&PPUPipeline::ThreadMain, this);
+}
+
+void PPUPipeline::Stop()
+{
+    if (ppu == NULL)
+    {
+        return;
+    }
+    BeginAccess();
+    isStopRequested.store(true, std::memory_order_release);
+    thread.join();
+    ppu = NULL;
+    horizon = UINT64_MAX;
+}
+
+bool PPUPipeline::Queue(uint16_t address, uint8_t value)
+{
+    if (ppu == NULL)
+    {
+        return false;
+    }
+    uint32_t index = head.load(std::memory_order_relaxed);
+    if (index - tail.load(std::memory_order_acquire) == PPU_PIPELINE_QUEUE_SIZE)
+    {
+        // Full: let the PPU thread empty it
+        BeginAccess();
+        EndAccess();
+    }
+    Write &write = queue[index & (PPU_PIPELINE_QUEUE_SIZE - 1)];
+    write.time = cpuTime;
+    write.address = address;
+    write.value = value;
+    head.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+void PPUPipeline::BeginAccess()
+{
+    if (ppu == NULL)
+    {
+        return;
+    }
+    publishedTime.store(cpuTime, std::memory_order_release);
+    while ((ppuTime.load(std::memory_order_acquire) != cpuTime) ||
+           (tail.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed)))
+    {
+        std::this_thread::yield();
+    }
+}
+
+void PPUPipeline::EndAccess(uint32_t cycles)
+{
+    if (ppu == NULL)
+    {
+        return;
+    }
+    cpuTime += cycles;
+    // The PPU thread is waiting, so its state can be read
+    horizon = cpuTime + ppu->GetCyclesUntilVBlank();
+    frameCount = ppu->GetFrameCount();
+    ppuTime.store(cpuTime, std::memory_order_release);
+    publishedTime.store(cpuTime, std::memory_order_release);
+}
+
+void PPUPipeline::ThreadMain()
+{
+    while (!isStopRequested.load(std::memory_order_acquire))
+    {
+        uint64_t target = publishedTime.load(std::memory_order_acquire);
+        uint64_t time = ppuTime.load(std::memory_order_acquire);
+        uint32_t index = tail.load(std::memory_order_relaxed);
+        uint32_t end = head.load(std::memory_order_acquire);
+        // Replay the writes done by the CPU at this time
+        while ((index != end) && (queue[index & (PPU_PIPELINE_QUEUE_SIZE - 1)].time <= time))
+        {
+            const Write &write = queue[index & (PPU_PIPELINE_QUEUE_SIZE - 1)];
+            ppu->WriteRegister(write.address, write.value);
+            ++index;
+            tail.store(index, std::memory_order_release);
+        }
+        // Run up to the next write
+        if ((index != end) && (queue[index & (PPU_PIPELINE_QUEUE_SIZE - 1)].time < target))
+        {
+            target = queue[index & (PPU_PIPELINE_QUEUE_SIZE - 1)].time;
+        }
+        if (time < target)
+        {
+            for (; time < target; ++time)
+            {
+                ppu->Step();
+            }
+            ppuTime.store(time, std::memory_order_release);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef _PPU_PIPELINE_H_
+#define _PPU_PIPELINE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <thread>
+#include "Platforms.h"
+
+/*
+ * Run the PPU on its own thread, behind the CPU. Enabled by defining _PARALLEL_PPU_ in Platforms.h
+ * - The CPU thread runs the instructions and counts the time in PPU cycles. The writes to $2001 and $2003-$2007 (including the
+ *   CHR-RAM writes) are queued with their time into a lock-free single producer/single consumer ring
+ * - The PPU thread runs the PPU up to the time published by the CPU thread, and replays each write when it reaches its time
+ * - The accesses which need the current PPU state are sync points: the CPU thread waits until the PPU thread has caught up,
+ *   does the access itself, and lets the PPU thread continue. They are the reads of $2002/$2004/$2007 (VBlank and sprite 0
+ *   polling), the writes to $2000 (NMI enable) and $4014 (DMA), the mapper register writes ($8000-$FFFF: CHR banks, mirroring)
+ *   and the idle loop skip
+ * - The CPU thread never runs past the first cycle where the PPU may raise an NMI (see PPU::GetCyclesUntilVBlank) without
+ *   waiting, so the NMI is seen before the same instruction as with a single thread
+ * - The CPU thread never reads the PPU state without a sync point: the cycles until VBlank (JIT) are counted from the CPU time
+ *   to the horizon, the frame count is the one of the last sync, and PPUSTATUS (idle loops) and the output frame of the
+ *   frontend (Console::CopyFrame) are read between BeginAccess/EndAccess
+ * The CPU waits instead of rolling back, so the emulation is exact: the frames and the game state are the same as without the
+ * mode. The speedup depends on the game: the time between the sync points is run by both cores
+ * When the mode is compiled out MemoryCPU uses NullPPUPipeline, which does nothing
+ */
+
+#if defined(_PARALLEL_PPU_) && defined(_CYCLE_ACCURATE_)
+#error "_PARALLEL_PPU_ and _CYCLE_ACCURATE_ can't be used together: the cycle accurate CPU runs the PPU itself"
+#endif
+#if defined(_PARALLEL_PPU_) && defined(_WATCH_MEMORY_)
+#error "_PARALLEL_PPU_ and _WATCH_MEMORY_ can't be used together: the PPU memory would be watched from the PPU thread"
+#endif
+#if defined(_PARALLEL_PPU_) && defined(_TRACE_INSTRUCTIONS_)
+#error "_PARALLEL_PPU_ and _TRACE_INSTRUCTIONS_ can't be used together: the scanline and dot of each record would be read while the PPU thread runs"
+#endif
+
+#define PPU_PIPELINE_QUEUE_SIZE 4096 // Power of 2
+
+class PPU;
+class PPUPipeline
+{
+    public:
+        PPUPipeline();
+        ~PPUPipeline();
+        // Start the PPU thread. Until Stop, only the PPU thread runs the PPU, except between BeginAccess and EndAccess
+        void Start(PPU *ppu);
+        void Stop();
+        // The CPU has run for the given number of PPU cycles
+        void Run(uint32_t cycles);
+        // Queue a write to a PPU register at the current time. Return false if the caller must write it now
+        bool Queue(uint16_t address, uint8_t value);
+        // Wait for the PPU thread to catch up. The caller can access the PPU until EndAccess
+        void BeginAccess();
+        // The caller has run the PPU for the given number of cycles during the access
+        void EndAccess(uint32_t cycles = 0);
+        // The PPU thread runs the PPU: it must only be accessed through the functions below or between BeginAccess and EndAccess
+        bool IsRunning();
+        // PPU::GetCyclesUntilVBlank at the CPU time
+        uint32_t GetCyclesUntilVBlank();
+        // PPU::GetFrameCount at the last sync. Every VBlank is a sync point, so it is the frame count at the CPU time
+        uint32_t GetFrameCount();
+
+    private:
+        struct Write
+        {
+            uint64_t time;
+            uint16_t address;
+            uint8_t value;
+        };
+
+        PPU *ppu;
+        std::thread thread;
+        std::atomic<bool> isStopRequested;
+        // CPU thread
+        uint64_t cpuTime;
+        uint64_t horizon; // Last time that the PPU thread can run without raising an NMI
+        uint32_t frameCount;
+        // Shared. The queue is written at head by the CPU thread and read at tail by the PPU thread
+        std::atomic<uint64_t> publishedTime; // The PPU thread can run up to this time
+        std::atomic<uint64_t> ppuTime;
+        std::atomic<uint32_t> head;
+        std::atomic<uint32_t> tail;
+        Write queue[PPU_PIPELINE_QUEUE_SIZE];
+
+        void ThreadMain();
+};
+
+class NullPPUPipeline
+{
+    public:
+        void Start(PPU *ppu) {}
+        void Stop() {}
+        void Run(uint32_t cycles) {}
+        bool Queue(uint16_t address, uint8_t value) { return false; }
+        void BeginAccess() {}
+        void EndAccess(uint32_t cycles = 0) {}
+        bool IsRunning() { return false; }
+        uint32_t GetCyclesUntilVBlank() { return 0; }
+        uint32_t GetFrameCount() { return 0; }
+};
+
+#ifdef _PARALLEL_PPU_
+typedef PPUPipeline PPUPipelinePolicy;
+#else
+typedef NullPPUPipeline PPUPipelinePolicy;
+#endif
+
+inline void PPUPipeline::Run(uint32_t cycles)
+{
+    cpuTime += cycles;
+    if (cpuTime > horizon)
+    {
+        // The PPU may raise an NMI before the next instruction
+        BeginAccess();
+        EndAccess();
+    }
+    else
+    {
+        publishedTime.store(cpuTime, std::memory_order_release);
+    }
+}
+
+inline bool PPUPipeline::IsRunning()
+{
+    return ppu != NULL;
+}
+
+inline uint32_t PPUPipeline::GetCyclesUntilVBlank()
+{
+    return (horizon > cpuTime) ? uint32_t(horizon - cpuTime) : 0;
+}
+
+inline uint32_t PPUPipeline::GetFrameCount()
+{
+    return frameCount;
+}
+
+#endif //_PPU_PIPELINE_H_
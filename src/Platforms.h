@@ -2,9 +2,46 @@
 #define _PLATFORMS_H_
 
 //#define _DEBUG_
+// Count executions/cycles/host time per opcode in CPU::Step (see OpcodeProfiler.h)
+//#define _PROFILE_OPCODES_
+#define OPCODE_PROFILE_FILE "opcode_profile.txt"
+#define OPCODE_PROFILE_SAMPLE_RATE 64
+// Sample the PC of the game with its call stack (see GuestProfiler.h)
+//#define _PROFILE_GUEST_
+#define GUEST_PROFILE_FILE "guest_profile.folded"
+#define GUEST_HOTSPOT_FILE "guest_hotspots.txt"
+#define GUEST_PROFILE_SAMPLE_CYCLES 1000
+#define GUEST_HOTSPOT_COUNT 64
+// Record a Chrome trace of the emulator internals (see Timeline.h)
+//#define _TRACE_TIMELINE_
+#define TIMELINE_FILE "timeline.json"
+// Record every instruction into a binary ring file, decoded by tools/tracedecode (see InstructionTrace.h)
+//#define _TRACE_INSTRUCTIONS_
+#define TRACE_FILE "trace.bin"
+#define TRACE_RING_RECORDS (1 << 24) // 384 MB, about 28 seconds of gameplay
+// Live performance counters: 'O' toggles the overlay, the JSON is served on this socket (see Stats.h)
+#define STATS_SOCKET_PATH "/tmp/NesEmulator.sock"
+// Watchpoints and access heatmaps of the CPU/PPU memory (see MemoryWatch.h)
+//#define _WATCH_MEMORY_
+#define WATCH_FILE "watch.txt"
+#define WATCH_CPU_HEATMAP_FILE "cpu_heatmap.ppm"
+#define WATCH_PPU_HEATMAP_FILE "ppu_heatmap.ppm"
+// Translate the PRG-ROM code to x86-64 code (see Jit.h)
+//#define _JIT_
+// Skip the iterations of the idle loops waiting for the PPU (see IdleLoop.h). Comment it out to run every instruction
+#define _SKIP_IDLE_LOOPS_
+// Run the PPU on each bus cycle of the CPU instead of after each instruction (see BusClock.h)
+//#define _CYCLE_ACCURATE_
+// Run the PPU on a second thread behind the CPU (see PPUPipeline.h)
+//#define _PARALLEL_PPU_
 // NES
 #define NES_FILE "../rom/Contra.nes"
+// Turbo mode: T toggles it. The frames run unthrottled and only 1 out of TURBO_RENDER_INTERVAL is rendered (see Console::SetTurbo)
+#define TURBO_RENDER_INTERVAL 8
+#define TURBO_HOST_SECONDS 0.016 // Host time spent emulating per displayed frame
 #define CPU_FREQUENCY 1789773.7272727272727272
+// Constant ORed with A by the unstable XAA opcode (see CPU::XAA)
+#define XAA_MAGIC 0xEE
 // Display
 #define SCREEN_WIDTH 256
 #define SCREEN_HEIGHT 240
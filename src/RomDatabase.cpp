@@ -0,0 +1,69 @@
+#include "RomDatabase.h"
+
+// Keep the entries sorted by CRC32
+static constexpr RomInfo entries[] =
+{
+    // CRC32     Mapper  Mirroring   Battery
+    {0x158B0388, 0,      Horizontal, false}, // nestest
+    {0xD445F698, 0,      Vertical,   false}, // Super Mario Bros.
+    {0xF6035030, 2,      Vertical,   false}, // Contra
+};
+
+static constexpr size_t NUM_ENTRIES = sizeof(entries) / sizeof(entries[0]);
+
+static constexpr bool IsSorted(size_t index)
+{
+    return (index + 1 >= NUM_ENTRIES) || ((entries[index].crc < entries[index + 1].crc) && IsSorted(index + 1));
+}
+
+static_assert(IsSorted(0), "The ROM database must be sorted by CRC32 without duplicates");
+
+const RomInfo* RomDatabase::Find(uint32_t crc)
+{
+    size_t low = 0;
+    size_t high = NUM_ENTRIES;
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (entries[middle].crc < crc)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return ((low < NUM_ENTRIES) && (entries[low].crc == crc)) ? &entries[low] : NULL;
+}
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320) lookup table
+struct CRC32Table
+{
+    uint32_t values[256];
+
+    CRC32Table()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t value = i;
+            for (uint8_t bit = 0; bit < 8; ++bit)
+            {
+                value = (value & 1) ? ((value >> 1) ^ 0xEDB88320) : (value >> 1);
+            }
+            values[i] = value;
+        }
+    }
+};
+
+uint32_t RomDatabase::CRC32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    // The table is built on the first call. The initialization of a local static is thread safe so consoles can be loaded in parallel
+    static const CRC32Table table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
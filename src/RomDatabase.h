@@ -0,0 +1,32 @@
+#ifndef _ROM_DATABASE_H_
+#define _ROM_DATABASE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Cartridge.h"
+
+struct RomInfo
+{
+    uint32_t crc; // CRC32 of PRG-ROM + CHR-ROM (without the header and the trainer)
+    uint8_t mapper;
+    Mirroring mirroring;
+    bool hasBattery;
+};
+
+/*
+ * Many NES files in the wild have a bad header (wrong mapper, wrong mirroring, garbage in the reserved bytes)
+ * which makes the game run with the wrong hardware without any error. The database knows the right values for
+ * a game from the hash of its PRG-ROM + CHR-ROM, so the cartridge can correct the header when the file is loaded
+ * The table is sorted by CRC32 and compiled into the binary, so a lookup is a binary search without any allocation
+ * Note: rom/RomInformation.txt doesn't have any hash so its entries can't be added here
+ */
+class RomDatabase
+{
+    public:
+        // Return NULL if the game isn't in the database
+        static const RomInfo* Find(uint32_t crc);
+        // Update crc with data. Start with crc = 0
+        static uint32_t CRC32(uint32_t crc, const uint8_t *data, size_t size);
+};
+
+#endif //_ROM_DATABASE_H_
@@ -0,0 +1,217 @@
+#include "Stats.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include "Platforms.h"
+
+Stats::Stats()
+{
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.audioBufferFill = -1.0;
+    memset(&windowStartCounters, 0, sizeof(windowStartCounters));
+    frameTimeCount = 0;
+    frameTimeIndex = 0;
+    isFirstUpdate = true;
+    serverSocket = -1;
+    socketInode = 0;
+    isServerRunning = false;
+}
+
+Stats::~Stats()
+{
+    StopServer();
+}
+
+void Stats::Update(const StatsCounters &counters)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (isFirstUpdate)
+    {
+        isFirstUpdate = false;
+        lastFrameTime = now;
+        windowStartTime = now;
+        windowStartCounters = counters;
+        return;
+    }
+    frameTimes[frameTimeIndex] = std::chrono::duration<double, std::milli>(now - lastFrameTime).count();
+    frameTimeIndex = (frameTimeIndex + 1) % STATS_FRAME_WINDOW;
+    frameTimeCount = std::min(frameTimeCount + 1, uint32_t(STATS_FRAME_WINDOW));
+    lastFrameTime = now;
+
+    double seconds = std::chrono::duration<double>(now - windowStartTime).count();
+    if (seconds < STATS_UPDATE_INTERVAL)
+    {
+        return;
+    }
+    StatsSnapshot newSnapshot;
+    newSnapshot.emulatedFPS = (counters.frames - windowStartCounters.frames) / seconds;
+    newSnapshot.instructionsPerSecond = (counters.instructions - windowStartCounters.instructions) / seconds;
+    newSnapshot.ppuDotsPerSecond = (counters.ppuDots - windowStartCounters.ppuDots) / seconds;
+    newSnapshot.dmaStallCyclesPerSecond = (counters.dmaStallCycles - windowStartCounters.dmaStallCycles) / seconds;
+    newSnapshot.dmaStallCycles = counters.dmaStallCycles;
+    newSnapshot.audioBufferFill = -1.0;
+    double sortedFrameTimes[STATS_FRAME_WINDOW];
+    std::copy(frameTimes, frameTimes + frameTimeCount, sortedFrameTimes);
+    std::sort(sortedFrameTimes, sortedFrameTimes + frameTimeCount);
+    newSnapshot.frameTimeP50 = sortedFrameTimes[uint32_t(frameTimeCount * 0.50)];
+    newSnapshot.frameTimeP95 = sortedFrameTimes[uint32_t(frameTimeCount * 0.95)];
+    newSnapshot.frameTimeP99 = sortedFrameTimes[uint32_t(frameTimeCount * 0.99)];
+    newSnapshot.frameTimeMax = sortedFrameTimes[frameTimeCount - 1];
+    windowStartTime = now;
+    windowStartCounters = counters;
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    snapshot = newSnapshot;
+}
+
+StatsSnapshot Stats::GetSnapshot()
+{
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    return snapshot;
+}
+
+std::string Stats::ToJSON()
+{
+    StatsSnapshot current = GetSnapshot();
+    char audioBufferFill[32];
+    if (current.audioBufferFill < 0)
+    {
+        strcpy(audioBufferFill, "null");
+    }
+    else
+    {
+        snprintf(audioBufferFill, sizeof(audioBufferFill), "%.3f", current.audioBufferFill);
+    }
+    char json[512];
+    snprintf(json, sizeof(json),
+        "{\"emulated_fps\":%.2f,"
+        "\"host_frame_ms\":{\"p50\":%.3f,\"p95\":%.3f,\"p99\":%.3f,\"max\":%.3f},"
+        "\"cpu_instructions_per_second\":%.0f,"
+        "\"ppu_dots_per_second\":%.0f,"
+        "\"dma_stall_cycles\":%llu,"
+        "\"dma_stall_cycles_per_second\":%.0f,"
+        "\"audio_buffer_fill\":%s}\n",
+        current.emulatedFPS, current.frameTimeP50, current.frameTimeP95, current.frameTimeP99, current.frameTimeMax,
+        current.instructionsPerSecond, current.ppuDotsPerSecond, (unsigned long long)current.dmaStallCycles,
+        current.dmaStallCyclesPerSecond, audioBufferFill);
+    return json;
+}
+
+std::string Stats::ToText()
+{
+    StatsSnapshot current = GetSnapshot();
+    char text[512];
+    snprintf(text, sizeof(text),
+        "FPS %.1f\n"
+        "Frame ms p50 %.2f p95 %.2f p99 %.2f\n"
+        "CPU %.2f M instr/s\n"
+        "PPU %.2f M dots/s\n"
+        "DMA stall %.0f cycles/s\n"
+        "Audio %s",
+        current.emulatedFPS, current.frameTimeP50, current.frameTimeP95, current.frameTimeP99,
+        current.instructionsPerSecond / 1000000.0, current.ppuDotsPerSecond / 1000000.0,
+        current.dmaStallCyclesPerSecond, current.audioBufferFill < 0 ? "n/a" : "on");
+    return text;
+}
+
+bool Stats::StartServer(const char *socketPath)
+{
+    StopServer();
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        LOGI("Stats socket path is too long %s", socketPath);
+        return false;
+    }
+    strcpy(address.sun_path, socketPath);
+    serverSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serverSocket < 0)
+    {
+        LOGI("Can't create stats socket");
+        return false;
+    }
+    // A socket accepting connections belongs to a running emulator, only the socket left by a crashed run is removed
+    if (connect(serverSocket, (struct sockaddr *)&address, sizeof(address)) == 0)
+    {
+        LOGI("Stats socket %s is used by another emulator", socketPath);
+        close(serverSocket);
+        serverSocket = -1;
+        return false;
+    }
+    if (errno == ECONNREFUSED)
+    {
+        unlink(socketPath);
+    }
+    // The socket connected above can't be bound, use a new one
+    close(serverSocket);
+    serverSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serverSocket < 0)
+    {
+        LOGI("Can't create stats socket");
+        return false;
+    }
+    if ((bind(serverSocket, (struct sockaddr *)&address, sizeof(address)) < 0) || (listen(serverSocket, 4) < 0))
+    {
+        LOGI("Can't bind stats socket %s", socketPath);
+        close(serverSocket);
+        serverSocket = -1;
+        return false;
+    }
+    struct stat socketStat;
+    socketInode = (stat(socketPath, &socketStat) == 0) ? socketStat.st_ino : 0;
+    this->socketPath = socketPath;
+    isServerRunning = true;
+    serverThread = std::thread(&Stats::ServerLoop, this);
+    return true;
+}
+
+void Stats::StopServer()
+{
+    if (serverThread.joinable())
+    {
+        isServerRunning = false;
+        serverThread.join();
+    }
+    if (serverSocket >= 0)
+    {
+        close(serverSocket);
+        serverSocket = -1;
+        // Another emulator may have replaced the socket file since, leave it alone
+        struct stat socketStat;
+        if ((stat(socketPath.c_str(), &socketStat) == 0) && (socketStat.st_ino == socketInode))
+        {
+            unlink(socketPath.c_str());
+        }
+    }
+}
+
+void Stats::ServerLoop()
+{
+    struct pollfd pollSocket;
+    pollSocket.fd = serverSocket;
+    pollSocket.events = POLLIN;
+    while (isServerRunning)
+    {
+        // Wake up regularly to check if the server is stopped
+        if (poll(&pollSocket, 1, 100) <= 0)
+        {
+            continue;
+        }
+        int client = accept(serverSocket, NULL, NULL);
+        if (client < 0)
+        {
+            continue;
+        }
+        std::string json = ToJSON();
+        // MSG_NOSIGNAL: a client closing early must not kill the emulator with SIGPIPE
+        send(client, json.c_str(), json.size(), MSG_NOSIGNAL);
+        close(client);
+    }
+}
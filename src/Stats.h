@@ -0,0 +1,86 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+/*
+ * Live performance counters of the emulator, shown as an overlay in the window and served as JSON over a Unix domain socket
+ * (e.g. nc -U /tmp/NesEmulator.sock)
+ * - The emulation thread only increments plain integers it owns (instructions in CPU::Step, PPU dots in Console::Step...)
+ * - Once per host frame the frontend passes a copy of these counters to Update(). The rates and the frame time
+ *   percentiles are computed there every STATS_UPDATE_INTERVAL seconds and published under a lock
+ * - The socket thread only reads the published snapshot, so a client never slows down the emulation
+ * There is no APU yet, so the audio buffer fill is reported as null
+ */
+#define STATS_FRAME_WINDOW 120 // Number of host frames used for the frame time percentiles
+#define STATS_UPDATE_INTERVAL 0.5 // seconds
+
+// Raw counters since power up, owned by the emulation thread
+struct StatsCounters
+{
+    uint64_t frames;
+    uint64_t instructions;
+    uint64_t ppuDots;
+    uint64_t dmaStallCycles;
+};
+
+struct StatsSnapshot
+{
+    double emulatedFPS;
+    // Host frame time in milliseconds over the last STATS_FRAME_WINDOW frames
+    double frameTimeP50;
+    double frameTimeP95;
+    double frameTimeP99;
+    double frameTimeMax;
+    double instructionsPerSecond;
+    double ppuDotsPerSecond;
+    double dmaStallCyclesPerSecond;
+    uint64_t dmaStallCycles;
+    // Fill level of the audio buffer in [0, 1], negative if there is no audio output
+    double audioBufferFill;
+};
+
+class Stats
+{
+    public:
+        Stats();
+        ~Stats();
+        // Called once per host frame from the frontend thread
+        void Update(const StatsCounters &counters);
+        StatsSnapshot GetSnapshot();
+        std::string ToJSON();
+        // One counter per line, for the overlay
+        std::string ToText();
+        // Serve the snapshot as JSON to every client connecting to the socket. Return false if the socket can't be created
+        // or another emulator is already serving on it
+        bool StartServer(const char *socketPath);
+        void StopServer();
+
+    private:
+        std::mutex snapshotMutex;
+        StatsSnapshot snapshot;
+        // Frontend thread only
+        std::chrono::steady_clock::time_point lastFrameTime;
+        std::chrono::steady_clock::time_point windowStartTime;
+        StatsCounters windowStartCounters;
+        double frameTimes[STATS_FRAME_WINDOW];
+        uint32_t frameTimeCount;
+        uint32_t frameTimeIndex;
+        bool isFirstUpdate;
+        // Socket server
+        int serverSocket;
+        std::string socketPath;
+        // Identify the socket file bound by this instance, so StopServer doesn't remove the one of another emulator
+        uint64_t socketInode;
+        std::thread serverThread;
+        std::atomic<bool> isServerRunning;
+
+        void ServerLoop();
+};
+
+#endif //_STATS_H_
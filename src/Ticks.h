@@ -0,0 +1,49 @@
+#ifndef _TICKS_H_
+#define _TICKS_H_
+
+#include <stdint.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Cheap timestamp for the profilers: the time stamp counter on x86 (a few nanoseconds to read)
+ * or the steady clock in nanoseconds on the other platforms
+ * The counter frequency isn't known, so TickClock measures it against the steady clock
+ */
+inline uint64_t ReadTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+class TickClock
+{
+    public:
+        TickClock()
+        {
+            Reset();
+        }
+        void Reset()
+        {
+            startTicks = ReadTicks();
+            startTime = std::chrono::steady_clock::now();
+        }
+        // Number of nanoseconds per tick since Reset()
+        double GetNanosecondsPerTick()
+        {
+            uint64_t ticks = ReadTicks() - startTicks;
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+            return (ticks > 0) ? (ns / ticks) : 1.0;
+        }
+
+    private:
+        uint64_t startTicks;
+        std::chrono::steady_clock::time_point startTime;
+};
+
+#endif //_TICKS_H_
@@ -0,0 +1,124 @@
+#include "Timeline.h"
+#include <unistd.h>
+#include <sys/syscall.h>
+
+std::atomic<bool> Timeline::isRunning(false);
+std::chrono::steady_clock::time_point Timeline::startTime = std::chrono::steady_clock::now();
+std::mutex Timeline::ringsMutex;
+std::vector<TimelineRing *> Timeline::rings;
+FILE *Timeline::file = NULL;
+bool Timeline::isFirstEvent = true;
+std::thread Timeline::writerThread;
+std::mutex Timeline::writerMutex;
+std::condition_variable Timeline::writerCondition;
+
+bool Timeline::Start(const char *fileName)
+{
+    if (isRunning)
+    {
+        return true;
+    }
+    file = fopen(fileName, "w");
+    if (file == NULL)
+    {
+        LOGI("Can't open the timeline file %s", fileName);
+        return false;
+    }
+    fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    isFirstEvent = true;
+    startTime = std::chrono::steady_clock::now();
+    isRunning = true;
+    writerThread = std::thread(WriterLoop);
+    return true;
+}
+
+void Timeline::Stop()
+{
+    if (!isRunning)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        isRunning = false;
+    }
+    writerCondition.notify_one();
+    writerThread.join();
+    // The last events recorded before isRunning was cleared
+    Drain();
+    uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (size_t i = 0; i < rings.size(); ++i)
+        {
+            dropped += rings[i]->dropped;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    file = NULL;
+    if (dropped > 0)
+    {
+        LOGI("Timeline: %llu events were dropped because a ring buffer was full", (unsigned long long)dropped);
+    }
+}
+
+TimelineRing* Timeline::GetRing()
+{
+    // The ring is created when the thread records its first event. It is never deleted: the writer may still read it
+    static thread_local TimelineRing *ring = NULL;
+    if (ring == NULL)
+    {
+        ring = new TimelineRing();
+        ring->head = 0;
+        ring->tail = 0;
+        ring->threadId = syscall(SYS_gettid);
+        ring->dropped = 0;
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(ring);
+    }
+    return ring;
+}
+
+void Timeline::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(writerMutex);
+    while (isRunning)
+    {
+        writerCondition.wait_for(lock, std::chrono::milliseconds(TIMELINE_FLUSH_INTERVAL));
+        Drain();
+    }
+}
+
+void Timeline::Drain()
+{
+    std::vector<TimelineRing *> currentRings;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        currentRings = rings;
+    }
+    for (size_t i = 0; i < currentRings.size(); ++i)
+    {
+        TimelineRing *ring = currentRings[i];
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail)
+        {
+            const TimelineEvent &event = ring->events[tail & (TIMELINE_RING_SIZE - 1)];
+            fprintf(file, "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, ", isFirstEvent ? "" : ",\n",
+                    event.name, event.category, event.phase, event.timestamp / 1000.0);
+            if (event.phase == 'X')
+            {
+                fprintf(file, "\"dur\": %.3f, ", event.duration / 1000.0);
+            }
+            else
+            {
+                fprintf(file, "\"s\": \"t\", ");
+            }
+            fprintf(file, "\"pid\": 1, \"tid\": %u, \"args\": {\"value\": %lld}}", ring->threadId, (long long)event.value);
+            isFirstEvent = false;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    fflush(file);
+}
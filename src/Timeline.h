@@ -0,0 +1,147 @@
+#ifndef _TIMELINE_H_
+#define _TIMELINE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include "Platforms.h"
+
+/*
+ * Timeline of the emulator internals in the Chrome trace event format (open it in chrome://tracing or ui.perfetto.dev)
+ * Enabled by defining _TRACE_TIMELINE_ in Platforms.h, the TIMELINE_* macros are empty otherwise
+ * - Each thread records its events into its own ring buffer. The ring has a single producer (the thread) and a single
+ *   consumer (the writer thread), so recording an event is a few stores without any lock
+ * - The writer thread drains the rings every TIMELINE_FLUSH_INTERVAL milliseconds into TIMELINE_FILE
+ * - If a ring is full, the new events are dropped and counted
+ */
+#define TIMELINE_RING_SIZE 65536 // Must be a power of 2
+#define TIMELINE_FLUSH_INTERVAL 100
+
+struct TimelineEvent
+{
+    const char *name;
+    const char *category;
+    char phase; // 'X': complete event (with duration), 'i': instant event
+    uint64_t timestamp; // nanoseconds since Timeline::Start
+    uint64_t duration;
+    int64_t value;
+};
+
+struct TimelineRing
+{
+    TimelineEvent events[TIMELINE_RING_SIZE];
+    std::atomic<uint32_t> head; // Written by the producer
+    std::atomic<uint32_t> tail; // Written by the consumer
+    uint32_t threadId;
+    uint64_t dropped;
+};
+
+class Timeline
+{
+    public:
+        static bool Start(const char *fileName);
+        static void Stop();
+        // Nanoseconds since Start()
+        static uint64_t Now();
+        static void Complete(const char *name, const char *category, uint64_t start, int64_t value = 0);
+        static void Instant(const char *name, const char *category, int64_t value = 0);
+
+    private:
+        static std::atomic<bool> isRunning;
+        static std::chrono::steady_clock::time_point startTime;
+        static std::mutex ringsMutex;
+        static std::vector<TimelineRing *> rings;
+        static FILE *file;
+        static bool isFirstEvent;
+        static std::thread writerThread;
+        static std::mutex writerMutex;
+        static std::condition_variable writerCondition;
+
+        static TimelineRing* GetRing();
+        static void Record(const TimelineEvent &event);
+        static void WriterLoop();
+        static void Drain();
+};
+
+inline uint64_t Timeline::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+inline void Timeline::Record(const TimelineEvent &event)
+{
+    TimelineRing *ring = GetRing();
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= TIMELINE_RING_SIZE)
+    {
+        ++ring->dropped;
+        return;
+    }
+    ring->events[head & (TIMELINE_RING_SIZE - 1)] = event;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+inline void Timeline::Complete(const char *name, const char *category, uint64_t start, int64_t value)
+{
+    if (isRunning.load(std::memory_order_relaxed))
+    {
+        uint64_t now = Now();
+        TimelineEvent event = {name, category, 'X', start, now - start, value};
+        Record(event);
+    }
+}
+
+inline void Timeline::Instant(const char *name, const char *category, int64_t value)
+{
+    if (isRunning.load(std::memory_order_relaxed))
+    {
+        TimelineEvent event = {name, category, 'i', Now(), 0, value};
+        Record(event);
+    }
+}
+
+// Record the time between its construction and destruction as a complete event
+class TimelineScope
+{
+    public:
+        TimelineScope(const char *name, const char *category)
+        {
+            this->name = name;
+            this->category = category;
+            start = Timeline::Now();
+        }
+        ~TimelineScope()
+        {
+            Timeline::Complete(name, category, start);
+        }
+
+    private:
+        const char *name;
+        const char *category;
+        uint64_t start;
+};
+
+#ifdef _TRACE_TIMELINE_
+#define TIMELINE_CONCAT_(a, b) a##b
+#define TIMELINE_CONCAT(a, b) TIMELINE_CONCAT_(a, b)
+#define TIMELINE_SCOPE(name, category) TimelineScope TIMELINE_CONCAT(timelineScope, __LINE__)(name, category)
+#define TIMELINE_INSTANT(name, category, value) Timeline::Instant(name, category, value)
+#define TIMELINE_NOW() Timeline::Now()
+#define TIMELINE_COMPLETE(name, category, start, value) Timeline::Complete(name, category, start, value)
+#define TIMELINE_START(fileName) Timeline::Start(fileName)
+#define TIMELINE_STOP() Timeline::Stop()
+#else
+#define TIMELINE_SCOPE(name, category)
+#define TIMELINE_INSTANT(name, category, value)
+#define TIMELINE_NOW() 0
+#define TIMELINE_COMPLETE(name, category, start, value)
+#define TIMELINE_START(fileName)
+#define TIMELINE_STOP()
+#endif
+
+#endif //_TIMELINE_H_
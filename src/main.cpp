@@ -1,66 +1,47 @@
 #include <GL/glut.h>
-#include "PPU.h"
-#include "Cartridge.h"
+#include "Console.h"
 #include "Platforms.h"
-#include "Mapper.h"
-#include "MemoryCPU.h"
-#include "MemoryPPU.h"
-#include "CPU.h"
-#include "Controller.h"
+#include "Timeline.h"
+#include "Stats.h"
 #include "Palette.h"
 
 // NES components
-Cartridge *cartridge;
-Mapper *mapper;
-Memory *memoryPPU;
-PPU *ppu;
-Memory *memoryCPU;
-CPU *cpu;
+Console *console;
 Controller *controller;
+// Performance counters
+Stats stats;
+bool isStatsOverlayVisible = false;
 // Delta time
 uint32_t oldTime;
 // Window size
 int displayWidth = SCREEN_WIDTH * MODIFIER;
 int displayHeight = SCREEN_HEIGHT * MODIFIER;
 uint8_t screenData[SCREEN_HEIGHT][SCREEN_WIDTH][3]; 
+uint8_t frameData[SCREEN_HEIGHT][SCREEN_WIDTH];
+// Number of PPU frames in the texture, it is only uploaded when the PPU has output a new frame (see PPU::SetRenderInterval)
+uint32_t textureFrameCount = UINT32_MAX;
 
 double GetDeltaTime();
-void StepSeconds(double deltaTime);
-uint8_t Step();
 void SetupTexture();
 void Display();
 void ReshapeWindow(GLsizei w, GLsizei h);
 void OnKeyPress(unsigned char key, int x, int y);
 void OnKeyRelease(unsigned char key, int x, int y);
+void OnExit();
 
 int main(int argc, char **argv)
 {
     // Init NES components
-    cartridge = new Cartridge();
-    if (cartridge->LoadNESFile(NES_FILE) == false)
+    TIMELINE_START(TIMELINE_FILE);
+    console = new Console();
+    if (console->LoadNESFile(NES_FILE) == false)
     {
-        LOGI("Invalid NES file");
         return 0;
     }
-    mapper = Mapper::GetMapper(cartridge);
-    if (mapper == NULL)
-    {
-        LOGI("We haven't supported this mapper");
-        return 0;
-    }
-    memoryPPU = new MemoryPPU();
-    memoryPPU->SetMapper(mapper);
-    ppu = new PPU(memoryPPU);
-
-    memoryCPU = new MemoryCPU();
-    memoryCPU->SetMapper(mapper);
-    memoryCPU->SetPPU(ppu);
-
-    controller = new Controller();
-    memoryCPU->SetController(controller);
-
-    cpu = new CPU(memoryCPU);
-    ppu->SetCPU(cpu);
+    controller = console->GetController();
+    // GLUT leaves the main loop by calling exit() so the console is deleted in an exit handler (save file, profiler reports)
+    atexit(OnExit);
+    stats.StartServer(STATS_SOCKET_PATH);
     // Init time
     oldTime = 0;
     // Init GLUT and create window
@@ -80,16 +61,17 @@ int main(int argc, char **argv)
     // Enter GLUT event processing loop
     glutMainLoop();
     // Deallocate
-    SAFE_DEL(cartridge);
-    SAFE_DEL(mapper);
-    SAFE_DEL(memoryPPU);
-    SAFE_DEL(ppu);
-    SAFE_DEL(controller);
-    SAFE_DEL(memoryCPU);
-    SAFE_DEL(cpu);
+    SAFE_DEL(console);
     return 1;
 }
 
+void OnExit()
+{
+    stats.StopServer();
+    SAFE_DEL(console);
+    TIMELINE_STOP();
+}
+
 double GetDeltaTime()
 {
     uint32_t newTime = glutGet(GLUT_ELAPSED_TIME);
@@ -134,22 +116,52 @@ void ReshapeWindow(GLsizei w, GLsizei h)
     displayHeight = h;
 }
 
+void DrawStatsOverlay()
+{
+    std::string text = stats.ToText();
+    // The texture is modulated by the current color, so draw the text untextured and restore white afterwards
+    glDisable(GL_TEXTURE_2D);
+    glColor3f(1.0f, 1.0f, 0.0f);
+    int y = 16;
+    glRasterPos2i(8, y);
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (text[i] == '\n')
+        {
+            y += 15;
+            glRasterPos2i(8, y);
+        }
+        else
+        {
+            glutBitmapCharacter(GLUT_BITMAP_8_BY_13, text[i]);
+        }
+    }
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glEnable(GL_TEXTURE_2D);
+}
+
 void UpdateTexture()
 {   
-    // Update pixels
-    for(int y = 0; y < SCREEN_HEIGHT; ++y)  
+    uint32_t frameCount = console->CopyFrame(frameData, textureFrameCount);
+    if (frameCount != textureFrameCount)
     {
-        for(int x = 0; x < SCREEN_WIDTH; ++x)
+        textureFrameCount = frameCount;
+        // Update pixels
+        for(int y = 0; y < SCREEN_HEIGHT; ++y)  
         {
-            uint32_t color = palette[ppu->frontBuffer[y][x]];
-            //color = palette[memoryPPU->Read(0x3F00 | 16)];
-            screenData[y][x][0] = uint8_t(color >> 16);
-            screenData[y][x][1] = uint8_t(color >> 8);
-            screenData[y][x][2] = uint8_t(color);
+            for(int x = 0; x < SCREEN_WIDTH; ++x)
+            {
+                uint32_t color = palette[frameData[y][x]];
+                //color = palette[memoryPPU->Read(0x3F00 | 16)];
+                screenData[y][x][0] = uint8_t(color >> 16);
+                screenData[y][x][1] = uint8_t(color >> 8);
+                screenData[y][x][2] = uint8_t(color);
+            }
         }
+        // Update Texture
+        TIMELINE_SCOPE("Upload texture", "Frontend");
+        glTexSubImage2D(GL_TEXTURE_2D, 0 ,0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screenData);
     }
-    // Update Texture
-    glTexSubImage2D(GL_TEXTURE_2D, 0 ,0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screenData);
     glBegin(GL_QUADS);
         glTexCoord2d(0.0, 0.0);     glVertex2d(0.0,           0.0);
         glTexCoord2d(1.0, 0.0);     glVertex2d(displayWidth,  0.0);
@@ -161,31 +173,25 @@ void UpdateTexture()
 void Display()
 {
     double deltaTime = GetDeltaTime();
-    StepSeconds(deltaTime);
+    if (console->IsTurbo())
+    {
+        // Unthrottled
+        console->StepHostSeconds(TURBO_HOST_SECONDS);
+    }
+    else
+    {
+        console->StepSeconds(deltaTime);
+    }
     // Clear framebuffer
     glClear(GL_COLOR_BUFFER_BIT);
     UpdateTexture(); 
-    glutSwapBuffers();
-}
-
-void StepSeconds(double deltaTime)
-{
-    int32_t cycles =  uint32_t(CPU_FREQUENCY * deltaTime);
-    while(cycles > 0)
-    {   
-        cycles -= Step();
-    }
-}
-
-uint8_t Step()
-{
-    uint8_t cpuCycles = cpu->Step();
-    uint8_t ppuCycles = cpuCycles * 3;
-    for (uint8_t i = 0; i < ppuCycles; ++i)
+    stats.Update(console->GetCounters());
+    if (isStatsOverlayVisible)
     {
-        ppu->Step();  
+        DrawStatsOverlay();
     }
-    return cpuCycles;
+    TIMELINE_SCOPE("Swap buffers", "Frontend");
+    glutSwapBuffers();
 }
 
 void OnKeyPress(unsigned char key, int x, int y)
@@ -222,6 +228,19 @@ void OnKeyPress(unsigned char key, int x, int y)
         case 13: // Enter
             controller->SetButton(ButtonStart, true);
             break;
+        case 'o':
+        case 'O':
+            isStatsOverlayVisible = !isStatsOverlayVisible;
+            break;
+        case 'c':
+        case 'C':
+            // Continue after a watchpoint break
+            console->Resume();
+            break;
+        case 't':
+        case 'T':
+            console->SetTurbo(!console->IsTurbo());
+            break;
     }
 }
 
@@ -0,0 +1,64 @@
+#ifndef _TEST_UTIL_H_
+#define _TEST_UTIL_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <fstream>
+#include <vector>
+#include "Platforms.h"
+
+/*
+ * Helpers shared by the headless tests
+ * - CHECK counts a failure and logs the message when the condition is false. main returns 1 if failures isn't 0
+ * - CreateNESImage builds an iNES file in memory, so the tests can run programs and bank layouts that no game in the repository has
+ */
+
+// Bits 0-3 of byte 6 of the iNES header
+#define INES_VERTICAL_MIRRORING 0x01
+#define INES_BATTERY 0x02
+#define INES_FOUR_SCREEN 0x08
+
+#define INES_HEADER_SIZE 16
+#define INES_PRG_BANK_SIZE 0x4000
+#define INES_CHR_BANK_SIZE 0x2000
+
+static uint32_t failures = 0;
+
+#define CHECK(condition, ...) \
+    do { if (!(condition)) { printf("FAIL: "); LOGI(__VA_ARGS__); ++failures; } } while(0)
+
+// numPRG 16KB PRG-ROM banks filled with prgFill and numCHR 8KB CHR-ROM banks filled with 0 (0 banks for CHR-RAM)
+inline std::vector<uint8_t> CreateNESImage(uint8_t mapper, uint8_t numPRG, uint8_t numCHR, uint8_t flags6 = 0, uint8_t prgFill = 0xEA)
+{
+    std::vector<uint8_t> image(INES_HEADER_SIZE, 0);
+    image[0] = 'N';
+    image[1] = 'E';
+    image[2] = 'S';
+    image[3] = 0x1A;
+    image[4] = numPRG;
+    image[5] = numCHR;
+    image[6] = ((mapper & 0x0F) << 4) | (flags6 & 0x0F);
+    image[7] = mapper & 0xF0;
+    image.resize(INES_HEADER_SIZE + numPRG * INES_PRG_BANK_SIZE, prgFill);
+    image.resize(image.size() + numCHR * INES_CHR_BANK_SIZE, 0);
+    return image;
+}
+
+inline uint8_t* GetPRGBank(std::vector<uint8_t> &image, uint8_t bank)
+{
+    return &image[INES_HEADER_SIZE + bank * INES_PRG_BANK_SIZE];
+}
+
+inline uint8_t* GetCHRBank(std::vector<uint8_t> &image, uint8_t bank)
+{
+    return &image[INES_HEADER_SIZE + image[4] * INES_PRG_BANK_SIZE + bank * INES_CHR_BANK_SIZE];
+}
+
+inline bool WriteNESFile(const char *fileName, const std::vector<uint8_t> &image)
+{
+    std::ofstream os(fileName, std::ofstream::binary);
+    os.write(reinterpret_cast<const char *>(&image[0]), image.size());
+    return os.good();
+}
+
+#endif //_TEST_UTIL_H_
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#define private public
+#define protected public
+#include "Console.h"
+#include "PPU.h"
+#include "Platforms.h"
+#include "CPU.h"
+
+/*
+ * Cycle accurate mode test, built with _CYCLE_ACCURATE_ (see BusClock.h)
+ * - nestest: the PPU is only run by the bus cycles of the CPU. Before every instruction the CPU registers and the PPU position
+ *   must match the line of nestest.log, so every instruction runs the PPU for exactly its cycles
+ * - The sprite 0 hit ROMs read $2002 in timed loops, so their results depend on the dot of the read. The expected results
+ *   are the ones of this mode, they may differ from test/ppu/sprite0hit
+ * Return 0 if everything matches
+ */
+
+#define NESTEST_FILE "../nestest/nestest.nes"
+#define LOG_FILE "../nestest/nestest.log"
+#define SPRITE0_DIR "../../ppu/sprite0hit/"
+#define RESULT_ADDRESS 0x00F8
+#define RESULT_PASSED 1
+#define MAX_FRAMES 600
+
+struct ExpectedState
+{
+    unsigned int PC, A, X, Y, P, SP;
+    int CYC, SL;
+};
+
+struct TestROM
+{
+    const char *fileName;
+    uint8_t expectedResult;
+};
+
+static const TestROM testROMs[] =
+{
+    {"01.basics.nes", RESULT_PASSED},
+    {"02.alignment.nes", RESULT_PASSED},
+    {"03.corners.nes", RESULT_PASSED},
+    {"04.flip.nes", RESULT_PASSED},
+    {"05.left_clip.nes", 2}, // Should miss when entirely in left-edge clipping
+    {"06.right_edge.nes", 2}, // Should always miss when X = 255
+    {"07.screen_bottom.nes", RESULT_PASSED},
+    {"08.double_height.nes", RESULT_PASSED},
+    {"09.timing_basics.nes", 3}, // Upper-left corner too late
+    {"10.timing_order.nes", RESULT_PASSED},
+    {"11.edge_timing.nes", 2}, // Hit time shouldn't be based on pixels under left clip
+};
+
+#define NUM_TEST_ROMS (sizeof(testROMs) / sizeof(testROMs[0]))
+
+uint32_t failures = 0;
+
+void TestNestest()
+{
+    std::vector<ExpectedState> states;
+    std::ifstream file(LOG_FILE);
+    std::string line;
+    while (getline(file, line))
+    {
+        ExpectedState state;
+        if ((line.size() >= 48) && (sscanf(line.c_str(), "%x", &state.PC) == 1) &&
+            (sscanf(&line.c_str()[48], "A:%x X:%x Y:%x P:%x SP:%x CYC:%d SL:%d", &state.A, &state.X, &state.Y, &state.P,
+                    &state.SP, &state.CYC, &state.SL) == 7))
+        {
+            // The pre-render scanline is -1 in the log and 261 in our PPU
+            state.SL = (state.SL == -1) ? 261 : state.SL;
+            states.push_back(state);
+        }
+    }
+    if (states.empty())
+    {
+        LOGI("FAIL: Can't open log file");
+        ++failures;
+        return;
+    }
+    Console *console = new Console();
+    console->LoadNESFile(NESTEST_FILE);
+    CPU *cpu = console->cpu;
+    PPU *ppu = console->ppu;
+    cpu->PC = 0xC000;
+    cpu->SP = 0xFD;
+    ppu->scanline = 241;
+    ppu->cycles = 0;
+    size_t count = 0;
+    for (; count < states.size(); ++count)
+    {
+        const ExpectedState &state = states[count];
+        if (cpu->A != state.A || cpu->X != state.X || cpu->Y != state.Y || cpu->GetStatus() != state.P || cpu->SP != state.SP ||
+            cpu->PC != state.PC || ppu->cycles != state.CYC || ppu->scanline != state.SL)
+        {
+            LOGI("FAIL: nestest diverges at line %d", int(count + 1));
+            LOGI("  Expected %04X A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%3d SL:%d", state.PC, state.A, state.X, state.Y,
+                 state.P, state.SP, state.CYC, state.SL);
+            LOGI("  Got      %04X A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%3d SL:%d", cpu->PC, cpu->A, cpu->X, cpu->Y,
+                 cpu->GetStatus(), cpu->SP, ppu->cycles, ppu->scanline);
+            ++failures;
+            break;
+        }
+        // Only the CPU: it runs the PPU itself
+        cpu->Step();
+    }
+    LOGI("nestest: %d of %d instructions", int(count), int(states.size()));
+    SAFE_DEL(console);
+}
+
+// The test ROMs end with "forever: jmp forever"
+bool IsInEndlessLoop(Console &console)
+{
+    uint16_t pc = console.cpu->PC;
+    return (console.memoryCPU->Read(pc) == 0x4C) && (console.memoryCPU->Read(pc + 1) == (pc & 0xFF)) &&
+           (console.memoryCPU->Read(pc + 2) == (pc >> 8));
+}
+
+void TestSprite0Hit(const TestROM &testROM)
+{
+    Console console;
+    std::string fileName = std::string(SPRITE0_DIR) + testROM.fileName;
+    if (!console.LoadNESFile(fileName))
+    {
+        LOGI("FAIL: Can't load %s", fileName.c_str());
+        ++failures;
+        return;
+    }
+    bool isFinished = false;
+    for (uint32_t frames = 0; (frames < MAX_FRAMES) && !isFinished; ++frames)
+    {
+        console.StepFrame();
+        isFinished = IsInEndlessLoop(console);
+    }
+    uint8_t result = console.memoryCPU->Read(RESULT_ADDRESS);
+    if (!isFinished || (result != testROM.expectedResult))
+    {
+        LOGI("FAIL: %s result %d, expected %d%s", testROM.fileName, result, testROM.expectedResult, isFinished ? "" : " (timeout)");
+        ++failures;
+        return;
+    }
+    LOGI("%s: %s", testROM.fileName, (result == RESULT_PASSED) ? "passed" : "failed as expected");
+}
+
+int main()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    TestNestest();
+    for (uint32_t i = 0; i < NUM_TEST_ROMS; ++i)
+    {
+        TestSprite0Hit(testROMs[i]);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d failure(s) (%.0f ms)", failures, ms);
+        return 1;
+    }
+    LOGI("PASSED (%.0f ms)", ms);
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <fstream>
+#include <vector>
+
+#define private public
+#define protected public
+
+#include "PPU.h"
+#include "Cartridge.h"
+#include "Platforms.h"
+#include "Mapper.h"
+#include "MapperRegistry.h"
+#include "MemoryCPU.h"
+#include "MemoryPPU.h"
+#include "CPU.h"
+#include "../../TestUtil.h"
+
+/*
+ * Headless test of the decode cache (see DecodeCache.h) with a UNROM program that
+ * - Switches the banks at $8000 and calls the same address in each of them, so the same PC runs different code
+ * - Jumps to a RAM routine that modifies its own operand through a RAM mirror, so the cached instruction must be dropped
+ * Every pass of the program must see the code that is in the memory now, not the code that was cached
+ */
+
+#define PROGRAM_FILE "decodecache.nes"
+#define NUM_PRG 4
+#define PASSES 20
+
+const uint8_t fixedBankCode[] =
+{
+    0xA2, 0x00,             // $C000: LDX #$00
+    0x8E, 0x00, 0x80,       // $C002: STX $8000   ; Select bank X at $8000
+    0x20, 0x00, 0x80,       // $C005: JSR $8000   ; LDA #tag of the bank
+    0x9D, 0x00, 0x03,       // $C008: STA $0300,X
+    0xE8,                   // $C00B: INX
+    0xE0, NUM_PRG - 1,      // $C00C: CPX #$03
+    0xD0, 0xF2,             // $C00E: BNE $C002
+    0x4C, 0x00, 0x02        // $C010: JMP $0200
+};
+
+const uint8_t ramCode[] =
+{
+    0xA9, 0x05,             // $0200: LDA #$05
+    0xEE, 0x01, 0x0A,       // $0202: INC $0A01   ; Mirror of $0201: the operand of LDA
+    0x8D, 0x10, 0x03,       // $0205: STA $0310
+    0x4C, 0x00, 0xC0        // $0208: JMP $C000
+};
+
+bool WriteProgramFile(const char *fileName)
+{
+    std::vector<uint8_t> image = CreateNESImage(2, NUM_PRG, 1);
+    for (uint8_t bank = 0; bank < NUM_PRG; ++bank)
+    {
+        uint8_t *prg = GetPRGBank(image, bank);
+        if (bank < NUM_PRG - 1)
+        {
+            // LDA #tag, RTS
+            prg[0] = 0xA9;
+            prg[1] = 0x10 + bank;
+            prg[2] = 0x60;
+        }
+        else
+        {
+            std::copy(fixedBankCode, fixedBankCode + sizeof(fixedBankCode), prg);
+            // Reset vector: $C000
+            prg[0x3FFC] = 0x00;
+            prg[0x3FFD] = 0xC0;
+        }
+    }
+    return WriteNESFile(fileName, image);
+}
+
+int main(int argc, char *argv[])
+{
+    Cartridge *cartridge = new Cartridge();
+    if (!WriteProgramFile(PROGRAM_FILE) || !cartridge->LoadNESFile(PROGRAM_FILE))
+    {
+        LOGI("Can't create %s", PROGRAM_FILE);
+        return 1;
+    }
+    remove(PROGRAM_FILE);
+    Mapper *mapper = Mapper::GetMapper(cartridge);
+    Memory *memoryPPU = MapperRegistry::CreateMemoryPPU(2);
+    memoryPPU->SetMapper(mapper);
+    PPU *ppu = new PPU(memoryPPU);
+    Memory *memoryCPU = MapperRegistry::CreateMemoryCPU(2);
+    memoryCPU->SetMapper(mapper);
+    memoryCPU->SetPPU(ppu);
+    for (uint16_t i = 0; i < sizeof(ramCode); ++i)
+    {
+        memoryCPU->Write(0x0200 + i, ramCode[i]);
+    }
+    CPU *cpu = new CPU(memoryCPU);
+    ppu->SetCPU(cpu);
+    CHECK(cpu->PC == 0xC000, "Reset vector $%04X", cpu->PC);
+
+    uint32_t passes = 0;
+    for (uint32_t step = 0; (step < PASSES * 64) && (passes < PASSES); ++step)
+    {
+        cpu->Step();
+        if (cpu->PC == 0x0208)
+        {
+            for (uint8_t bank = 0; bank < NUM_PRG - 1; ++bank)
+            {
+                uint8_t tag = memoryCPU->Read(0x0300 + bank);
+                CHECK(tag == 0x10 + bank, "Pass %d: bank %d returned $%02X", passes, bank, tag);
+            }
+            uint8_t value = memoryCPU->Read(0x0310);
+            CHECK(value == uint8_t(5 + passes), "Pass %d: LDA loaded $%02X instead of $%02X", passes, value, uint8_t(5 + passes));
+            for (uint16_t i = 0x0300; i < 0x0303; ++i)
+            {
+                memoryCPU->Write(i, 0x00);
+            }
+            ++passes;
+        }
+    }
+    CHECK(passes == PASSES, "The program ran %d passes instead of %d", passes, PASSES);
+    CHECK(cpu->decodeCache.bankInstructions[1].size() == 0x4000, "Bank 1 wasn't cached");
+
+    SAFE_DEL(cpu);
+    SAFE_DEL(memoryCPU);
+    SAFE_DEL(ppu);
+    SAFE_DEL(memoryPPU);
+    SAFE_DEL(mapper);
+    SAFE_DEL(cartridge);
+    if (failures > 0)
+    {
+        printf("FAILED: %d checks\n", failures);
+        return 1;
+    }
+    printf("PASSED: %d passes with bank switches and self modifying code\n", passes);
+    return 0;
+}
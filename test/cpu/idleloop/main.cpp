@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <chrono>
+#include <string.h>
+#define private public
+#define protected public
+#include "Console.h"
+#include "PPU.h"
+#include "Platforms.h"
+#include "MemoryCPU.h"
+#include "CPU.h"
+
+/*
+ * Idle loop skipping test (see IdleLoop.h)
+ * Every bundled game runs for GAME_FRAMES frames with the Start button pressed once, with Console::Step (which skips the idle
+ * loops) and with a reference loop that runs every instruction up to the same cycle. The frame, the RAM, the CPU registers and
+ * the instruction count must be the same after every frame
+ * Return 0 if everything matches
+ */
+
+#define GAME_FRAMES 600
+#define START_FRAME 200
+
+const char *games[] =
+{
+    "../../../rom/Mario.nes",
+    "../../../rom/Contra.nes",
+};
+
+uint32_t failures = 0;
+
+uint32_t Hash(Console *console)
+{
+    // FNV-1a of the frame, the RAM, the registers and the cycle count
+    uint32_t hash = 2166136261u;
+    CPU *cpu = console->cpu;
+    uint8_t registers[] = {cpu->A, cpu->X, cpu->Y, cpu->GetStatus(), cpu->SP, uint8_t(cpu->PC), uint8_t(cpu->PC >> 8)};
+    const void *data[] = {console->ppu->frontBuffer, static_cast<MemoryCPU *>(console->memoryCPU)->GetRAM(), registers, &cpu->cycles};
+    size_t sizes[] = {SCREEN_WIDTH * SCREEN_HEIGHT, 0x800, sizeof(registers), sizeof(cpu->cycles)};
+    for (size_t i = 0; i < 4; ++i)
+    {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data[i]);
+        for (size_t j = 0; j < sizes[i]; ++j)
+        {
+            hash = (hash ^ bytes[j]) * 16777619;
+        }
+    }
+    return hash;
+}
+
+// Run 1 instruction without skipping
+void StepReference(Console *console)
+{
+    uint16_t ppuCycles = console->cpu->Step() * 3;
+    for (uint16_t i = 0; i < ppuCycles; ++i)
+    {
+        console->ppu->Step();
+    }
+}
+
+void TestGame(const char *fileName)
+{
+    Console *console = new Console();
+    Console *reference = new Console();
+    if (!console->LoadNESFile(fileName) || !reference->LoadNESFile(fileName))
+    {
+        LOGI("FAIL: Can't load %s", fileName);
+        ++failures;
+        SAFE_DEL(console);
+        SAFE_DEL(reference);
+        return;
+    }
+    // The frame buffers aren't written while the rendering is disabled
+    memset(console->ppu->buffer1, 0, sizeof(console->ppu->buffer1));
+    memset(console->ppu->buffer2, 0, sizeof(console->ppu->buffer2));
+    memset(reference->ppu->buffer1, 0, sizeof(reference->ppu->buffer1));
+    memset(reference->ppu->buffer2, 0, sizeof(reference->ppu->buffer2));
+    uint64_t skippedInstructions = 0;
+    double ms = 0;
+    double referenceMs = 0;
+    for (uint32_t frame = 0; (frame < GAME_FRAMES) && (failures == 0); ++frame)
+    {
+        bool start = (frame >= START_FRAME) && (frame < START_FRAME + 5);
+        console->GetController()->SetButton(ButtonStart, start);
+        reference->GetController()->SetButton(ButtonStart, start);
+        std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+        uint32_t frameCount = console->ppu->GetFrameCount();
+        while (frameCount == console->ppu->GetFrameCount())
+        {
+            uint64_t instructions = console->cpu->GetInstructionCount();
+            uint16_t PC = console->cpu->PC;
+            bool isIdle = console->cpu->IsIdle();
+            console->Step();
+            if (isIdle && (console->cpu->PC == PC))
+            {
+                skippedInstructions += console->cpu->GetInstructionCount() - instructions;
+            }
+        }
+        ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time).count();
+        time = std::chrono::steady_clock::now();
+        // The skipped iterations end on an instruction, so the reference reaches the same cycle
+        while (reference->cpu->cycles < console->cpu->cycles)
+        {
+            StepReference(reference);
+        }
+        referenceMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time).count();
+        if ((Hash(console) != Hash(reference)) || (console->cpu->GetInstructionCount() != reference->cpu->GetInstructionCount()))
+        {
+            LOGI("FAIL: %s diverges at frame %d", fileName, frame);
+            ++failures;
+        }
+    }
+    uint64_t instructions = console->cpu->GetInstructionCount();
+    LOGI("%s: %d%% of the instructions skipped, %.0f ms instead of %.0f ms", fileName,
+         int(skippedInstructions * 100 / (instructions > 0 ? instructions : 1)), ms, referenceMs);
+    SAFE_DEL(console);
+    SAFE_DEL(reference);
+}
+
+int main(int argc, char **argv)
+{
+#ifndef _SKIP_IDLE_LOOPS_
+    LOGI("_SKIP_IDLE_LOOPS_ isn't defined: nothing is skipped");
+#endif
+    for (size_t i = 0; i < sizeof(games) / sizeof(games[0]); ++i)
+    {
+        TestGame(games[i]);
+    }
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d check(s)", failures);
+        return 1;
+    }
+    LOGI("PASSED");
+    return 0;
+}
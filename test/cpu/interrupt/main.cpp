@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <string.h>
+
+#define private public
+#define protected public
+
+#include "Platforms.h"
+#include "Memory.h"
+#include "CPU.h"
+
+/*
+ * Test of the interrupt lines of the CPU (see Event in CPU.h)
+ * A small program of NOPs runs from RAM, the NMI and IRQ handlers are NOP, RTI. The test asserts the lines between the steps and
+ * checks the instruction boundary where the CPU enters the handler:
+ * - IRQ is level triggered and masked by I. CLI and SEI change I after the poll, RTI before it
+ * - NMI is edge triggered: it runs once per assertion, even when I is set
+ * - The OAM DMA stall runs before the next instruction, in steps of at most 255 cycles
+ * Return 0 if every check passes
+ */
+
+#define PROGRAM_ADDRESS 0x0600
+#define NMI_HANDLER 0x0700
+#define IRQ_HANDLER 0x0780
+
+#define OPCODE_NOP 0xEA
+#define OPCODE_CLI 0x58
+#define OPCODE_SEI 0x78
+#define OPCODE_RTI 0x40
+
+// Flat 64KB memory
+class FlatMemory : public Memory
+{
+    public:
+        uint8_t bytes[0x10000];
+
+        FlatMemory()
+        {
+            memset(bytes, OPCODE_NOP, sizeof(bytes));
+            bytes[RESET_VECTOR_LOW] = PROGRAM_ADDRESS & 0xFF;
+            bytes[RESET_VECTOR_HIGH] = PROGRAM_ADDRESS >> 8;
+            bytes[NMI_VECTOR_LOW] = NMI_HANDLER & 0xFF;
+            bytes[NMI_VECTOR_HIGH] = NMI_HANDLER >> 8;
+            bytes[IRQ_VECTOR_LOW] = IRQ_HANDLER & 0xFF;
+            bytes[IRQ_VECTOR_HIGH] = IRQ_HANDLER >> 8;
+            bytes[NMI_HANDLER + 1] = OPCODE_RTI;
+            bytes[IRQ_HANDLER + 1] = OPCODE_RTI;
+        }
+        uint8_t Read(uint16_t address)
+        {
+            return bytes[address];
+        }
+        void Write(uint16_t address, uint8_t value)
+        {
+            bytes[address] = value;
+        }
+};
+
+uint32_t failures = 0;
+
+void Check(bool condition, const char *test, const char *what, CPU &cpu)
+{
+    if (!condition)
+    {
+        LOGI("FAIL: %s: %s (PC:%04X P:%02X)", test, what, cpu.PC, cpu.GetStatus());
+        ++failures;
+    }
+}
+
+void TestIRQMask()
+{
+    const char *test = "IRQ mask";
+    FlatMemory memory;
+    memory.bytes[PROGRAM_ADDRESS + 1] = OPCODE_CLI;
+    CPU cpu(&memory);
+    cpu.SP = 0xFD;
+    cpu.SetIRQLine(IRQSourceMapper, true);
+    // I is set at power up
+    cpu.Step(); // NOP
+    Check(cpu.PC == PROGRAM_ADDRESS + 1, test, "IRQ taken while I is set", cpu);
+    cpu.Step(); // CLI
+    cpu.Step(); // NOP: the poll of CLI still saw I set
+    Check(cpu.PC == PROGRAM_ADDRESS + 3, test, "IRQ taken right after CLI", cpu);
+    // The step runs the interrupt sequence and the first instruction of the handler
+    uint8_t cycles = cpu.Step();
+    Check((cpu.PC == IRQ_HANDLER + 1) && (cycles == 7 + 2), test, "IRQ not taken after the instruction following CLI", cpu);
+    // RTI restores I before the poll, so the asserted line interrupts again at once
+    cpu.Step(); // RTI
+    cpu.Step();
+    Check(cpu.PC == IRQ_HANDLER + 1, test, "IRQ not taken right after RTI", cpu);
+    cpu.SetIRQLine(IRQSourceMapper, false);
+    cpu.Step(); // RTI
+    cpu.Step(); // NOP
+    Check(cpu.PC == PROGRAM_ADDRESS + 4, test, "IRQ taken after the line is released", cpu);
+}
+
+void TestSEI()
+{
+    const char *test = "SEI";
+    FlatMemory memory;
+    memory.bytes[PROGRAM_ADDRESS] = OPCODE_CLI;
+    memory.bytes[PROGRAM_ADDRESS + 1] = OPCODE_SEI;
+    CPU cpu(&memory);
+    cpu.SP = 0xFD;
+    cpu.SetIRQLine(IRQSourceAPU, true);
+    cpu.Step(); // CLI
+    cpu.Step(); // SEI: the poll of CLI still saw I set
+    Check(cpu.PC == PROGRAM_ADDRESS + 2, test, "IRQ taken right after CLI", cpu);
+    // The poll of SEI saw I clear, so the IRQ runs once between SEI and the next instruction
+    cpu.Step();
+    Check(cpu.PC == IRQ_HANDLER + 1, test, "IRQ not taken right after SEI", cpu);
+    // A second source keeps the line asserted
+    cpu.SetIRQLine(IRQSourceMapper, true);
+    cpu.SetIRQLine(IRQSourceAPU, false);
+    Check(cpu.irqLines == IRQSourceMapper, test, "line released while a source still asserts it", cpu);
+}
+
+void TestNMI()
+{
+    const char *test = "NMI";
+    FlatMemory memory;
+    CPU cpu(&memory);
+    cpu.SP = 0xFD;
+    cpu.Step(); // NOP
+    cpu.TriggerNMI();
+    cpu.Step();
+    Check(cpu.PC == NMI_HANDLER + 1, test, "NMI not taken while I is set", cpu);
+    cpu.Step(); // RTI
+    cpu.Step(); // NOP
+    Check(cpu.PC == PROGRAM_ADDRESS + 2, test, "NMI taken twice for a single edge", cpu);
+}
+
+void TestStall()
+{
+    const char *test = "Stall";
+    FlatMemory memory;
+    CPU cpu(&memory);
+    cpu.Stall(514);
+    cpu.TriggerNMI();
+    // The stall is run by steps of at most 255 cycles
+    Check(cpu.Step() == 255, test, "first stall step isn't 255 cycles", cpu);
+    Check(cpu.Step() == 255, test, "second stall step isn't 255 cycles", cpu);
+    Check(cpu.Step() == 4, test, "last stall step isn't 4 cycles", cpu);
+    Check((cpu.PC == PROGRAM_ADDRESS) && (cpu.GetStallCycleCount() == 514), test, "instruction run during the stall", cpu);
+    cpu.Step();
+    Check(cpu.PC == NMI_HANDLER + 1, test, "NMI lost during the stall", cpu);
+    Check(cpu.pendingEvents == 0, test, "events still pending", cpu);
+}
+
+int main()
+{
+    TestIRQMask();
+    TestSEI();
+    TestNMI();
+    TestStall();
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d check(s)", failures);
+        return 1;
+    }
+    LOGI("PASSED");
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#define private public
+#define protected public
+#include "Console.h"
+#include "PPU.h"
+#include "Cartridge.h"
+#include "Platforms.h"
+#include "Mapper.h"
+#include "MemoryCPU.h"
+#include "MemoryPPU.h"
+#include "CPU.h"
+#include "../../TestUtil.h"
+
+/*
+ * JIT conformance test, built with _JIT_
+ * - nestest: after every step (1 instruction or 1 translated block) the CPU registers and the PPU position must match the
+ *   line of nestest.log for the number of instructions run so far
+ * - The bundled games run for GAME_FRAMES frames with the Start button pressed once. The hash of the last frame, the RAM,
+ *   the CPU registers and the cycle count must be equal to the hash of the interpreter (the same test built without _JIT_)
+ * - An IRQ asserted right after a CLI must be taken 1 instruction later, like in the interpreter (see CPU::DelayIRQPoll)
+ * Return 0 if everything matches
+ */
+
+#define NESTEST_FILE "../nestest/nestest.nes"
+#define LOG_FILE "../nestest/nestest.log"
+#define GAME_FRAMES 600
+#define START_FRAME 200
+#define CLI_FILE "cli.nes"
+#define CLI_IRQ_HANDLER 0x9000
+
+struct ExpectedState
+{
+    unsigned int PC, A, X, Y, P, SP;
+    int CYC, SL;
+};
+
+struct Game
+{
+    const char *fileName;
+    uint32_t hash;
+};
+
+const Game games[] =
+{
+    {"../../../rom/Mario.nes", 0x3865DE09},
+    {"../../../rom/Contra.nes", 0x6EFD8B43},
+};
+
+void Hash(uint32_t &hash, const void *data, size_t size)
+{
+    // FNV-1a
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619;
+    }
+}
+
+void TestNestest()
+{
+    std::vector<ExpectedState> states;
+    std::ifstream file(LOG_FILE);
+    std::string line;
+    while (getline(file, line))
+    {
+        ExpectedState state;
+        if ((line.size() >= 48) && (sscanf(line.c_str(), "%x", &state.PC) == 1) &&
+            (sscanf(&line.c_str()[48], "A:%x X:%x Y:%x P:%x SP:%x CYC:%d SL:%d", &state.A, &state.X, &state.Y, &state.P,
+                    &state.SP, &state.CYC, &state.SL) == 7))
+        {
+            // The pre-render scanline is -1 in the log and 261 in our PPU
+            state.SL = (state.SL == -1) ? 261 : state.SL;
+            states.push_back(state);
+        }
+    }
+    if (states.empty())
+    {
+        LOGI("FAIL: Can't open log file");
+        ++failures;
+        return;
+    }
+    Console *console = new Console();
+    console->LoadNESFile(NESTEST_FILE);
+    CPU *cpu = console->cpu;
+    PPU *ppu = console->ppu;
+    cpu->PC = 0xC000;
+    cpu->SP = 0xFD;
+    ppu->scanline = 241;
+    ppu->cycles = 0;
+    uint64_t count = 0;
+    while ((count = cpu->GetInstructionCount()) < states.size())
+    {
+        const ExpectedState &state = states[count];
+        if (cpu->A != state.A || cpu->X != state.X || cpu->Y != state.Y || cpu->GetStatus() != state.P || cpu->SP != state.SP ||
+            cpu->PC != state.PC || ppu->cycles != state.CYC || ppu->scanline != state.SL)
+        {
+            LOGI("FAIL: nestest diverges at line %d", int(count + 1));
+            LOGI("  Expected %04X A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%3d SL:%d", state.PC, state.A, state.X, state.Y,
+                 state.P, state.SP, state.CYC, state.SL);
+            LOGI("  Got      %04X A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%3d SL:%d", cpu->PC, cpu->A, cpu->X, cpu->Y,
+                 cpu->GetStatus(), cpu->SP, ppu->cycles, ppu->scanline);
+            ++failures;
+            break;
+        }
+        console->Step();
+    }
+#ifdef _JIT_
+    LOGI("nestest: %d instructions, %d run by the JIT", int(count), int(cpu->jit.GetInstructionCount()));
+    if (cpu->jit.GetInstructionCount() == 0)
+    {
+        LOGI("FAIL: the JIT didn't run any block");
+        ++failures;
+    }
+#endif
+    SAFE_DEL(console);
+}
+
+// NROM program: LDA #$01, CLI, LDA #$02, LDA #$03, JMP *. The IRQ handler is NOP, RTI
+bool WriteCLIFile(const char *fileName)
+{
+    static const uint8_t program[] = {0xA9, 0x01, 0x58, 0xA9, 0x02, 0xA9, 0x03, 0x4C, 0x07, 0x80};
+    std::vector<uint8_t> image = CreateNESImage(0, 1, 1);
+    uint8_t *prg = GetPRGBank(image, 0);
+    memcpy(prg, program, sizeof(program));
+    prg[CLI_IRQ_HANDLER - 0x8000 + 1] = 0x40;
+    prg[0x3FFC] = 0x00; // Reset vector: $8000
+    prg[0x3FFD] = 0x80;
+    prg[0x3FFE] = CLI_IRQ_HANDLER & 0xFF;
+    prg[0x3FFF] = CLI_IRQ_HANDLER >> 8;
+    return WriteNESFile(fileName, image);
+}
+
+void TestCLI()
+{
+    Console *console = new Console();
+    bool isLoaded = WriteCLIFile(CLI_FILE) && console->LoadNESFile(CLI_FILE);
+    remove(CLI_FILE);
+    if (!isLoaded)
+    {
+        LOGI("FAIL: Can't load %s", CLI_FILE);
+        ++failures;
+        SAFE_DEL(console);
+        return;
+    }
+    CPU *cpu = console->cpu;
+    cpu->P.bits.I = SET;
+    // Run up to the end of CLI
+    for (uint32_t steps = 0; (steps < 4) && (cpu->PC <= 0x8002); ++steps)
+    {
+        console->Step();
+    }
+    if ((cpu->PC != 0x8003) || (cpu->P.bits.I != CLEAR))
+    {
+        LOGI("FAIL: CLI ran inside a translated block (PC %04X)", cpu->PC);
+        ++failures;
+    }
+    // The poll before LDA #$02 still sees the I of before CLI
+    cpu->SetIRQLine(IRQSourceMapper, true);
+    console->Step();
+    if ((cpu->PC != 0x8005) || (cpu->A != 0x02))
+    {
+        LOGI("FAIL: IRQ taken right after CLI (PC %04X)", cpu->PC);
+        ++failures;
+    }
+    // The interrupt sequence and the first instruction of the handler
+    console->Step();
+    if (cpu->PC != CLI_IRQ_HANDLER + 1)
+    {
+        LOGI("FAIL: IRQ not taken 1 instruction after CLI (PC %04X)", cpu->PC);
+        ++failures;
+    }
+#ifdef _JIT_
+    if (cpu->jit.GetInstructionCount() == 0)
+    {
+        LOGI("FAIL: the JIT didn't run LDA #$01");
+        ++failures;
+    }
+#endif
+    SAFE_DEL(console);
+}
+
+void TestGame(const Game &game)
+{
+    Console *console = new Console();
+    if (!console->LoadNESFile(game.fileName))
+    {
+        LOGI("FAIL: Can't load %s", game.fileName);
+        ++failures;
+        return;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < GAME_FRAMES; ++frame)
+    {
+        console->GetController()->SetButton(ButtonStart, (frame >= START_FRAME) && (frame < START_FRAME + 5));
+        console->StepFrame();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CPU *cpu = console->cpu;
+    uint32_t hash = 2166136261u;
+    Hash(hash, console->ppu->frontBuffer, SCREEN_WIDTH * SCREEN_HEIGHT);
+    Hash(hash, static_cast<MemoryCPU *>(console->memoryCPU)->GetRAM(), 0x800);
+    uint8_t registers[] = {cpu->A, cpu->X, cpu->Y, cpu->GetStatus(), cpu->SP, uint8_t(cpu->PC), uint8_t(cpu->PC >> 8)};
+    Hash(hash, registers, sizeof(registers));
+    Hash(hash, &cpu->cycles, sizeof(cpu->cycles));
+#ifdef _JIT_
+    uint64_t jitInstructions = cpu->jit.GetInstructionCount();
+#else
+    uint64_t jitInstructions = 0;
+#endif
+    LOGI("%s: hash %08X, %d%% of the instructions run by the JIT (%.0f ms)", game.fileName, hash,
+         int(jitInstructions * 100 / cpu->GetInstructionCount()), ms);
+    if (hash != game.hash)
+    {
+        LOGI("FAIL: %s hash %08X, expected %08X", game.fileName, hash, game.hash);
+        ++failures;
+    }
+    SAFE_DEL(console);
+}
+
+int main(int argc, char **argv)
+{
+    TestNestest();
+    TestCLI();
+    for (size_t i = 0; i < sizeof(games) / sizeof(games[0]); ++i)
+    {
+        TestGame(games[i]);
+    }
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d check(s)", failures);
+        return 1;
+    }
+    LOGI("PASSED");
+    return 0;
+}
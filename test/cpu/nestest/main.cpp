@@ -1,9 +1,14 @@
-#include <termios.h>
-#include <unistd.h>
 #include <stdio.h>
-#include <iostream>
-#include <fstream>
+#include <stdlib.h>
 #include <string.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define private public
 
@@ -15,24 +20,164 @@
 #include "MemoryPPU.h"
 #include "CPU.h"
 
-int getch(void)
+/*
+ * nestest conformance runner
+ * nestest.log is parsed once into nestest.bin: an array of the expected CPU registers and PPU position before every instruction
+ * The binary file is rebuilt when nestest.log is newer, and mapped into memory on the next runs, so the test doesn't parse any text
+ * Every step is compared with the expected state. The first MAX_DIVERGENCES divergences are printed with the instructions
+ * before them, then the run stops
+ * Usage: ./nestest [-n max divergences]
+ * Return 0 if the whole log matches
+ */
+
+#define NESTEST_FILE "nestest.nes"
+#define LOG_FILE "nestest.log"
+#define BINARY_FILE "nestest.bin"
+#define BINARY_MAGIC 0x5453544E // "NTST"
+#define BINARY_VERSION 1
+#define MAX_DIVERGENCES 5
+#define CONTEXT_LINES 3
+
+struct ExpectedState
+{
+    uint16_t PC;
+    uint8_t A;
+    uint8_t X;
+    uint8_t Y;
+    uint8_t P;
+    uint8_t SP;
+    char opcodeName[3];
+    uint16_t CYC;
+    uint16_t SL;
+    uint32_t reserved;
+};
+
+struct BinaryHeader
 {
-    struct termios oldattr, newattr;
-    int ch;
-    tcgetattr( STDIN_FILENO, &oldattr );
-    newattr = oldattr;
-    newattr.c_lflag &= ~( ICANON | ECHO );
-    tcsetattr( STDIN_FILENO, TCSANOW, &newattr );
-    ch = getchar();
-    tcsetattr( STDIN_FILENO, TCSANOW, &oldattr );
-    return ch;
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+uint64_t GetModifiedTime(const char *fileName)
+{
+    struct stat fileStat;
+    if (stat(fileName, &fileStat) != 0)
+    {
+        return 0;
+    }
+    return uint64_t(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
 }
 
-int main()
+bool BuildBinaryFile()
 {
+    std::ifstream file(LOG_FILE);
+    if (!file.is_open())
+    {
+        LOGI("Can't open log file");
+        return false;
+    }
+    std::vector<ExpectedState> states;
+    std::string line;
+    while (getline(file, line))
+    {
+        unsigned int A, X, Y, P, SP, PC;
+        int CYC, SL;
+        if ((line.size() < 48) || (sscanf(line.c_str(), "%x", &PC) != 1) ||
+            (sscanf(&line.c_str()[48], "A:%x X:%x Y:%x P:%x SP:%x CYC:%d SL:%d", &A, &X, &Y, &P, &SP, &CYC, &SL) != 7))
+        {
+            LOGI("Bad line %d in %s", int(states.size() + 1), LOG_FILE);
+            return false;
+        }
+        ExpectedState state;
+        memset(&state, 0, sizeof(state));
+        state.PC = PC;
+        state.A = A;
+        state.X = X;
+        state.Y = Y;
+        state.P = P;
+        state.SP = SP;
+        memcpy(state.opcodeName, &line.c_str()[16], 3);
+        state.CYC = CYC;
+        // The pre-render scanline is -1 in the log and 261 in our PPU
+        state.SL = (SL == -1) ? 261 : SL;
+        states.push_back(state);
+    }
+    BinaryHeader header;
+    header.magic = BINARY_MAGIC;
+    header.version = BINARY_VERSION;
+    header.count = states.size();
+    header.reserved = 0;
+    std::ofstream os(BINARY_FILE, std::ofstream::binary);
+    os.write(reinterpret_cast<char *>(&header), sizeof(header));
+    os.write(reinterpret_cast<char *>(&states[0]), states.size() * sizeof(ExpectedState));
+    return os.good();
+}
+
+// Map nestest.bin into memory. Return NULL if it is invalid
+const BinaryHeader* MapBinaryFile(size_t &size)
+{
+    int fileDescriptor = open(BINARY_FILE, O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        return NULL;
+    }
+    struct stat fileStat;
+    void *address = MAP_FAILED;
+    if ((fstat(fileDescriptor, &fileStat) == 0) && (size_t(fileStat.st_size) >= sizeof(BinaryHeader)))
+    {
+        size = fileStat.st_size;
+        address = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    }
+    close(fileDescriptor);
+    if (address == MAP_FAILED)
+    {
+        return NULL;
+    }
+    const BinaryHeader *header = reinterpret_cast<const BinaryHeader *>(address);
+    if ((header->magic != BINARY_MAGIC) || (header->version != BINARY_VERSION) ||
+        (size != sizeof(BinaryHeader) + header->count * sizeof(ExpectedState)))
+    {
+        munmap(address, size);
+        return NULL;
+    }
+    return header;
+}
+
+void PrintExpected(uint32_t line, const ExpectedState &state)
+{
+    LOGI("  %4d  %04X  %.3s  A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%3d SL:%d", line, state.PC, state.opcodeName,
+         state.A, state.X, state.Y, state.P, state.SP, state.CYC, state.SL);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t maxDivergences = MAX_DIVERGENCES;
+    if ((argc == 3) && (strcmp(argv[1], "-n") == 0))
+    {
+        maxDivergences = atoi(argv[2]);
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // Load the expected states
+    if (GetModifiedTime(BINARY_FILE) < GetModifiedTime(LOG_FILE))
+    {
+        if (!BuildBinaryFile())
+        {
+            return 1;
+        }
+    }
+    size_t size = 0;
+    const BinaryHeader *header = MapBinaryFile(size);
+    if ((header == NULL) && (!BuildBinaryFile() || ((header = MapBinaryFile(size)) == NULL)))
+    {
+        LOGI("Can't load %s", BINARY_FILE);
+        return 1;
+    }
+    const ExpectedState *states = reinterpret_cast<const ExpectedState *>(header + 1);
     // Initialize
     Cartridge *cartridge = new Cartridge();
-    if (cartridge->LoadNESFile("nestest.nes") == false)
+    if (cartridge->LoadNESFile(NESTEST_FILE) == false)
     {
         LOGI("Invalid NES file");
         return 1;
@@ -52,65 +197,53 @@ int main()
     memoryCPU->SetPPU(ppu);
     CPU *cpu = new CPU(memoryCPU);
     ppu->SetCPU(cpu);
+    // Start state of nestest.log (automated mode)
     cpu->PC = 0xC000;
+    cpu->SP = 0xFD;
+    ppu->scanline = 241;
+    ppu->cycles = 0;
+
+    uint32_t divergences = 0;
     uint32_t count = 0;
-    unsigned int A, X, Y, P, SP, CYC, SL, PC;
-    char opcodeName[4];
-    std::ifstream file("nestest.log");  
-    std::string line;
-    if (!file.is_open())
+    for (; (count < header->count) && (divergences < maxDivergences); ++count)
     {
-        LOGI("Can't open log file");
-        return 1;
-    }
-    opcodeName[3] = '\0';
-
-
-    while(getline (file, line))
-    {      
-        ++count; 
-        sscanf(line.c_str(), "%x", &PC);
-        sscanf(&line.c_str()[48], "A:%x X:%x Y:%x P:%x SP:%x CYC:%u SL:%u", &A, &X, &Y, &P, &SP, &CYC, &SL);
-        opcodeName[0] = line.c_str()[16];
-        opcodeName[1] = line.c_str()[17];
-        opcodeName[2] = line.c_str()[18];
-        
-        if (cpu->A != A || cpu->X != X || cpu->Y != Y || cpu->P.byte != P || cpu->SP != SP || cpu->PC != PC)
-        {
-            LOGI("=======================================================");
-            LOGI("PC: %x A: %x X: %x Y: %x P: %x SP: %x", PC, A, X, Y, P, SP);
-            LOGI("PC: %x A: %x X: %x Y: %x P: %x SP: %x", cpu->PC, cpu->A, cpu->X, cpu->Y, cpu->P.byte, cpu->SP);
-            LOGI("%d", count);
-            getch();
-        } 
-        if (SL == -1)
-        {
-            SL = 261;
-        }
-        if (ppu->cycles != CYC || ppu->scanline != SL)   
+        const ExpectedState &state = states[count];
+        if (cpu->A != state.A || cpu->X != state.X || cpu->Y != state.Y || cpu->GetStatus() != state.P || cpu->SP != state.SP || 
+            cpu->PC != state.PC || ppu->cycles != state.CYC || ppu->scanline != state.SL)
         {
+            ++divergences;
             LOGI("=======================================================");
-            LOGI("CYC: %d SL: %d", ppu->cycles, ppu->scanline);
-            LOGI("CYC: %d SL: %d", CYC, SL);
-            LOGI("%d", count);
-            getch();    
+            LOGI("Divergence at line %d", count + 1);
+            for (uint32_t line = (count > CONTEXT_LINES) ? count - CONTEXT_LINES : 0; line <= count; ++line)
+            {
+                PrintExpected(line + 1, states[line]);
+            }
+            LOGI("  Got   %04X       A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%3d SL:%d", cpu->PC,
+                 cpu->A, cpu->X, cpu->Y, cpu->GetStatus(), cpu->SP, ppu->cycles, ppu->scanline);
         }
         uint8_t cpuCycles = cpu->Step();
-        uint8_t ppuCycles = cpuCycles * 3;
-        for (uint8_t i = 0; i < ppuCycles; ++i)
+        uint16_t ppuCycles = cpuCycles * 3;
+        for (uint16_t i = 0; i < ppuCycles; ++i)
         {
             ppu->Step();  
         }
-
     }
-    LOGI("Done!");
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (divergences > 0)
+    {
+        LOGI("FAILED: %d divergence(s) in the first %d of %d instructions (%.2f ms)", divergences, count, header->count, ms);
+    }
+    else
+    {
+        LOGI("PASSED: %d instructions (%.2f ms)", count, ms);
+    }
     // Deallocate
-    file.close();   
+    munmap(const_cast<BinaryHeader *>(header), size);
     SAFE_DEL(cartridge);
     SAFE_DEL(mapper);
     SAFE_DEL(memoryPPU);
     SAFE_DEL(ppu);
     SAFE_DEL(memoryCPU);
     SAFE_DEL(cpu);
-    return 0;
-} 
+    return (divergences > 0) ? 1 : 0;
+}
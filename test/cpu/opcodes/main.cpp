@@ -0,0 +1,533 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+#define private public
+#define protected public
+
+#include "Platforms.h"
+#include "Memory.h"
+#include "CPU.h"
+
+/*
+ * Table-driven test of the 256 opcodes against a golden model of the NMOS 6502 (without decimal mode, like the 2A03)
+ * Every opcode runs 1 instruction from the same start state with:
+ * - The 16 combinations of the N, V, Z and C flags
+ * - A and the memory operand in VALUES
+ * - Small indexes (no page cross) and large indexes (page cross, zero page wrap)
+ * CPU::Step and the golden model must give the same registers, status, cycles and memory writes
+ * The KIL opcodes jam the real CPU and aren't emulated, so they aren't checked
+ * Return 0 if every case matches
+ */
+
+#define PROGRAM_ADDRESS 0x0600
+#define ZERO_PAGE_OPERAND 0x40
+#define ABSOLUTE_OPERAND 0x0380
+#define MAX_REPORTED_FAILURES 20
+
+const uint8_t VALUES[] = {0x00, 0x01, 0x40, 0x7F, 0x80, 0xC3, 0xFE, 0xFF};
+// X and Y without and with a page cross from ABSOLUTE_OPERAND
+const uint8_t INDEXES[][2] = {{0x05, 0x07}, {0xF0, 0xC1}};
+
+// Flat 64KB memory: the fill value everywhere, except the preset bytes (program, pointers) and the written bytes
+class FlatMemory : public Memory
+{
+    public:
+        uint8_t fill;
+        std::vector<std::pair<uint16_t, uint8_t> > bytes;
+        std::vector<std::pair<uint16_t, uint8_t> > writes;
+
+        void Reset(uint8_t fill)
+        {
+            this->fill = fill;
+            bytes.clear();
+            writes.clear();
+        }
+        void Preset(uint16_t address, uint8_t value)
+        {
+            bytes.push_back(std::make_pair(address, value));
+        }
+        uint8_t Read(uint16_t address)
+        {
+            for (size_t i = writes.size(); i > 0; --i)
+            {
+                if (writes[i - 1].first == address)
+                {
+                    return writes[i - 1].second;
+                }
+            }
+            for (size_t i = bytes.size(); i > 0; --i)
+            {
+                if (bytes[i - 1].first == address)
+                {
+                    return bytes[i - 1].second;
+                }
+            }
+            return fill;
+        }
+        void Write(uint16_t address, uint8_t value)
+        {
+            writes.push_back(std::make_pair(address, value));
+        }
+};
+
+/*
+ * Golden model
+ */
+enum GoldenMode
+{
+    IMP, ACC, IMM, ZP, ZPX, ZPY, ABS, ABX, ABY, IND, IZX, IZY, REL
+};
+
+const char *goldenNames[256] =
+{
+    /*x0     x1     x2     x3     x4     x5     x6     x7     x8     x9     xA     xB     xC     xD     xE     xF*/
+    "BRK", "ORA", "KIL", "SLO", "NOP", "ORA", "ASL", "SLO", "PHP", "ORA", "ASL", "ANC", "NOP", "ORA", "ASL", "SLO", /*0x*/
+    "BPL", "ORA", "KIL", "SLO", "NOP", "ORA", "ASL", "SLO", "CLC", "ORA", "NOP", "SLO", "NOP", "ORA", "ASL", "SLO", /*1x*/
+    "JSR", "AND", "KIL", "RLA", "BIT", "AND", "ROL", "RLA", "PLP", "AND", "ROL", "ANC", "BIT", "AND", "ROL", "RLA", /*2x*/
+    "BMI", "AND", "KIL", "RLA", "NOP", "AND", "ROL", "RLA", "SEC", "AND", "NOP", "RLA", "NOP", "AND", "ROL", "RLA", /*3x*/
+    "RTI", "EOR", "KIL", "SRE", "NOP", "EOR", "LSR", "SRE", "PHA", "EOR", "LSR", "ALR", "JMP", "EOR", "LSR", "SRE", /*4x*/
+    "BVC", "EOR", "KIL", "SRE", "NOP", "EOR", "LSR", "SRE", "CLI", "EOR", "NOP", "SRE", "NOP", "EOR", "LSR", "SRE", /*5x*/
+    "RTS", "ADC", "KIL", "RRA", "NOP", "ADC", "ROR", "RRA", "PLA", "ADC", "ROR", "ARR", "JMP", "ADC", "ROR", "RRA", /*6x*/
+    "BVS", "ADC", "KIL", "RRA", "NOP", "ADC", "ROR", "RRA", "SEI", "ADC", "NOP", "RRA", "NOP", "ADC", "ROR", "RRA", /*7x*/
+    "NOP", "STA", "NOP", "SAX", "STY", "STA", "STX", "SAX", "DEY", "NOP", "TXA", "XAA", "STY", "STA", "STX", "SAX", /*8x*/
+    "BCC", "STA", "KIL", "AXA", "STY", "STA", "STX", "SAX", "TYA", "STA", "TXS", "TAS", "SHY", "STA", "SHX", "AXA", /*9x*/
+    "LDY", "LDA", "LDX", "LAX", "LDY", "LDA", "LDX", "LAX", "TAY", "LDA", "TAX", "LAX", "LDY", "LDA", "LDX", "LAX", /*Ax*/
+    "BCS", "LDA", "KIL", "LAX", "LDY", "LDA", "LDX", "LAX", "CLV", "LDA", "TSX", "LAS", "LDY", "LDA", "LDX", "LAX", /*Bx*/
+    "CPY", "CMP", "NOP", "DCP", "CPY", "CMP", "DEC", "DCP", "INY", "CMP", "DEX", "AXS", "CPY", "CMP", "DEC", "DCP", /*Cx*/
+    "BNE", "CMP", "KIL", "DCP", "NOP", "CMP", "DEC", "DCP", "CLD", "CMP", "NOP", "DCP", "NOP", "CMP", "DEC", "DCP", /*Dx*/
+    "CPX", "SBC", "NOP", "ISC", "CPX", "SBC", "INC", "ISC", "INX", "SBC", "NOP", "SBC", "CPX", "SBC", "INC", "ISC", /*Ex*/
+    "BEQ", "SBC", "KIL", "ISC", "NOP", "SBC", "INC", "ISC", "SED", "SBC", "NOP", "ISC", "NOP", "SBC", "INC", "ISC", /*Fx*/
+};
+
+const GoldenMode goldenModes[256] =
+{
+    /*x0 x1   x2   x3   x4   x5   x6   x7   x8   x9   xA   xB   xC   xD   xE   xF*/
+    IMP, IZX, IMP, IZX, ZP,  ZP,  ZP,  ZP,  IMP, IMM, ACC, IMM, ABS, ABS, ABS, ABS, /*0x*/
+    REL, IZY, IMP, IZY, ZPX, ZPX, ZPX, ZPX, IMP, ABY, IMP, ABY, ABX, ABX, ABX, ABX, /*1x*/
+    ABS, IZX, IMP, IZX, ZP,  ZP,  ZP,  ZP,  IMP, IMM, ACC, IMM, ABS, ABS, ABS, ABS, /*2x*/
+    REL, IZY, IMP, IZY, ZPX, ZPX, ZPX, ZPX, IMP, ABY, IMP, ABY, ABX, ABX, ABX, ABX, /*3x*/
+    IMP, IZX, IMP, IZX, ZP,  ZP,  ZP,  ZP,  IMP, IMM, ACC, IMM, ABS, ABS, ABS, ABS, /*4x*/
+    REL, IZY, IMP, IZY, ZPX, ZPX, ZPX, ZPX, IMP, ABY, IMP, ABY, ABX, ABX, ABX, ABX, /*5x*/
+    IMP, IZX, IMP, IZX, ZP,  ZP,  ZP,  ZP,  IMP, IMM, ACC, IMM, IND, ABS, ABS, ABS, /*6x*/
+    REL, IZY, IMP, IZY, ZPX, ZPX, ZPX, ZPX, IMP, ABY, IMP, ABY, ABX, ABX, ABX, ABX, /*7x*/
+    IMM, IZX, IMM, IZX, ZP,  ZP,  ZP,  ZP,  IMP, IMM, IMP, IMM, ABS, ABS, ABS, ABS, /*8x*/
+    REL, IZY, IMP, IZY, ZPX, ZPX, ZPY, ZPY, IMP, ABY, IMP, ABY, ABX, ABX, ABY, ABY, /*9x*/
+    IMM, IZX, IMM, IZX, ZP,  ZP,  ZP,  ZP,  IMP, IMM, IMP, IMM, ABS, ABS, ABS, ABS, /*Ax*/
+    REL, IZY, IMP, IZY, ZPX, ZPX, ZPY, ZPY, IMP, ABY, IMP, ABY, ABX, ABX, ABY, ABY, /*Bx*/
+    IMM, IZX, IMM, IZX, ZP,  ZP,  ZP,  ZP,  IMP, IMM, IMP, IMM, ABS, ABS, ABS, ABS, /*Cx*/
+    REL, IZY, IMP, IZY, ZPX, ZPX, ZPX, ZPX, IMP, ABY, IMP, ABY, ABX, ABX, ABX, ABX, /*Dx*/
+    IMM, IZX, IMM, IZX, ZP,  ZP,  ZP,  ZP,  IMP, IMM, IMP, IMM, ABS, ABS, ABS, ABS, /*Ex*/
+    REL, IZY, IMP, IZY, ZPX, ZPX, ZPX, ZPX, IMP, ABY, IMP, ABY, ABX, ABX, ABX, ABX, /*Fx*/
+};
+
+// Cycles without the page cross and branch penalties
+const uint8_t goldenCycles[256] =
+{
+    /*x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF*/
+    7, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6, /*0x*/
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /*1x*/
+    6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6, /*2x*/
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /*3x*/
+    6, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6, /*4x*/
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /*5x*/
+    6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6, /*6x*/
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /*7x*/
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, /*8x*/
+    2, 6, 0, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5, /*9x*/
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, /*Ax*/
+    2, 5, 0, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4, /*Bx*/
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, /*Cx*/
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /*Dx*/
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, /*Ex*/
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /*Fx*/
+};
+
+struct State
+{
+    uint8_t A;
+    uint8_t X;
+    uint8_t Y;
+    uint8_t P;
+    uint8_t SP;
+    uint16_t PC;
+    uint32_t cycles;
+};
+
+bool operator==(const State &a, const State &b)
+{
+    return (a.A == b.A) && (a.X == b.X) && (a.Y == b.Y) && (a.P == b.P) && (a.SP == b.SP) && (a.PC == b.PC) && (a.cycles == b.cycles);
+}
+
+class Golden
+{
+    public:
+        Golden(State &state, Memory &memory) : s(state), m(memory) {}
+        void Step();
+
+    private:
+        State &s;
+        Memory &m;
+        uint16_t address;
+        std::string name;
+
+        bool Is(const char *n) { return name == n; }
+        void SetFlag(uint8_t flag, bool value) { s.P = value ? (s.P | flag) : (s.P & ~flag); }
+        void SetZN(uint8_t value) { SetFlag(FLAG_ZERO, value == 0); SetFlag(FLAG_NEGATIVE, (value & 0x80) != 0); }
+        void Push(uint8_t value) { m.Write(0x0100 | s.SP, value); --s.SP; }
+        uint8_t Pull() { ++s.SP; return m.Read(0x0100 | s.SP); }
+        void Add(uint8_t value)
+        {
+            uint16_t result = s.A + value + (s.P & FLAG_CARRY);
+            SetFlag(FLAG_OVERFLOW, (~(s.A ^ value) & (s.A ^ result) & 0x80) != 0);
+            SetFlag(FLAG_CARRY, result > 0xFF);
+            s.A = uint8_t(result);
+            SetZN(s.A);
+        }
+        void Compare(uint8_t reg, uint8_t value)
+        {
+            SetFlag(FLAG_CARRY, reg >= value);
+            SetZN(uint8_t(reg - value));
+        }
+        void Branch(bool condition)
+        {
+            if (condition)
+            {
+                uint16_t target = s.PC + int8_t(address);
+                s.cycles += ((target & 0xFF00) != (s.PC & 0xFF00)) ? 2 : 1;
+                s.PC = target;
+            }
+        }
+        // Value & (high byte of the base address + 1), the page cross replaces the high byte of the address
+        void StoreHigh(uint16_t base, uint8_t value)
+        {
+            value &= uint8_t((base >> 8) + 1);
+            if ((address & 0xFF00) != (base & 0xFF00))
+            {
+                address = (uint16_t(value) << 8) | (address & 0xFF);
+            }
+            m.Write(address, value);
+        }
+};
+
+void Golden::Step()
+{
+    uint8_t opcode = m.Read(s.PC);
+    uint8_t lo = m.Read(s.PC + 1);
+    uint8_t hi = m.Read(s.PC + 2);
+    uint16_t absolute = (uint16_t(hi) << 8) | lo;
+    name = goldenNames[opcode];
+    GoldenMode mode = goldenModes[opcode];
+    s.cycles += goldenCycles[opcode];
+    uint16_t base = 0;
+    switch (mode)
+    {
+        case IMP:
+        case ACC:
+            s.PC += 1;
+            break;
+        case IMM:
+        case REL:
+            address = lo;
+            s.PC += 2;
+            break;
+        case ZP:
+            address = lo;
+            s.PC += 2;
+            break;
+        case ZPX:
+            address = uint8_t(lo + s.X);
+            s.PC += 2;
+            break;
+        case ZPY:
+            address = uint8_t(lo + s.Y);
+            s.PC += 2;
+            break;
+        case ABS:
+            address = absolute;
+            s.PC += 3;
+            break;
+        case ABX:
+            base = absolute;
+            address = base + s.X;
+            s.PC += 3;
+            break;
+        case ABY:
+            base = absolute;
+            address = base + s.Y;
+            s.PC += 3;
+            break;
+        case IND:
+            // The high byte of the pointer doesn't cross a page
+            address = m.Read(absolute) | (uint16_t(m.Read((absolute & 0xFF00) | uint8_t(lo + 1))) << 8);
+            s.PC += 3;
+            break;
+        case IZX:
+            address = m.Read(uint8_t(lo + s.X)) | (uint16_t(m.Read(uint8_t(lo + s.X + 1))) << 8);
+            s.PC += 2;
+            break;
+        case IZY:
+            base = m.Read(lo) | (uint16_t(m.Read(uint8_t(lo + 1))) << 8);
+            address = base + s.Y;
+            s.PC += 2;
+            break;
+    }
+    // Page cross penalty of the read instructions
+    bool pageCross = ((mode == ABX) || (mode == ABY) || (mode == IZY)) && ((address & 0xFF00) != (base & 0xFF00));
+    if (pageCross && (Is("ADC") || Is("AND") || Is("CMP") || Is("EOR") || Is("LDA") || Is("LDX") || Is("LDY") || Is("ORA") ||
+                      Is("SBC") || Is("LAX") || Is("LAS") || Is("NOP")))
+    {
+        ++s.cycles;
+    }
+    uint8_t value = (mode == IMM) ? lo : (mode == ACC) ? s.A : ((mode == IMP) || (mode == REL)) ? 0 : m.Read(address);
+    bool carry = (s.P & FLAG_CARRY) != 0;
+    // Read-modify-write result, written back to A or the memory
+    int16_t result = -1;
+    if (Is("ADC")) Add(value);
+    else if (Is("SBC")) Add(~value);
+    else if (Is("AND")) { s.A &= value; SetZN(s.A); }
+    else if (Is("ORA")) { s.A |= value; SetZN(s.A); }
+    else if (Is("EOR")) { s.A ^= value; SetZN(s.A); }
+    else if (Is("CMP")) Compare(s.A, value);
+    else if (Is("CPX")) Compare(s.X, value);
+    else if (Is("CPY")) Compare(s.Y, value);
+    else if (Is("BIT"))
+    {
+        SetFlag(FLAG_NEGATIVE, (value & 0x80) != 0);
+        SetFlag(FLAG_OVERFLOW, (value & 0x40) != 0);
+        SetFlag(FLAG_ZERO, (s.A & value) == 0);
+    }
+    else if (Is("ASL")) { SetFlag(FLAG_CARRY, (value & 0x80) != 0); result = uint8_t(value << 1); SetZN(result); }
+    else if (Is("LSR")) { SetFlag(FLAG_CARRY, (value & 0x01) != 0); result = value >> 1; SetZN(result); }
+    else if (Is("ROL")) { SetFlag(FLAG_CARRY, (value & 0x80) != 0); result = uint8_t((value << 1) | (carry ? 1 : 0)); SetZN(result); }
+    else if (Is("ROR")) { SetFlag(FLAG_CARRY, (value & 0x01) != 0); result = (value >> 1) | (carry ? 0x80 : 0); SetZN(result); }
+    else if (Is("INC")) { result = uint8_t(value + 1); SetZN(result); }
+    else if (Is("DEC")) { result = uint8_t(value - 1); SetZN(result); }
+    else if (Is("INX")) { ++s.X; SetZN(s.X); }
+    else if (Is("INY")) { ++s.Y; SetZN(s.Y); }
+    else if (Is("DEX")) { --s.X; SetZN(s.X); }
+    else if (Is("DEY")) { --s.Y; SetZN(s.Y); }
+    else if (Is("LDA")) { s.A = value; SetZN(s.A); }
+    else if (Is("LDX")) { s.X = value; SetZN(s.X); }
+    else if (Is("LDY")) { s.Y = value; SetZN(s.Y); }
+    else if (Is("STA")) m.Write(address, s.A);
+    else if (Is("STX")) m.Write(address, s.X);
+    else if (Is("STY")) m.Write(address, s.Y);
+    else if (Is("TAX")) { s.X = s.A; SetZN(s.X); }
+    else if (Is("TAY")) { s.Y = s.A; SetZN(s.Y); }
+    else if (Is("TXA")) { s.A = s.X; SetZN(s.A); }
+    else if (Is("TYA")) { s.A = s.Y; SetZN(s.A); }
+    else if (Is("TSX")) { s.X = s.SP; SetZN(s.X); }
+    else if (Is("TXS")) s.SP = s.X;
+    else if (Is("PHA")) Push(s.A);
+    else if (Is("PHP")) Push(s.P | FLAG_BREAK | FLAG_CONSTANT);
+    else if (Is("PLA")) { s.A = Pull(); SetZN(s.A); }
+    else if (Is("PLP")) s.P = (Pull() & ~FLAG_BREAK) | FLAG_CONSTANT;
+    else if (Is("CLC")) SetFlag(FLAG_CARRY, false);
+    else if (Is("SEC")) SetFlag(FLAG_CARRY, true);
+    else if (Is("CLI")) SetFlag(FLAG_INTERRUPT, false);
+    else if (Is("SEI")) SetFlag(FLAG_INTERRUPT, true);
+    else if (Is("CLD")) SetFlag(FLAG_DECIMAL, false);
+    else if (Is("SED")) SetFlag(FLAG_DECIMAL, true);
+    else if (Is("CLV")) SetFlag(FLAG_OVERFLOW, false);
+    else if (Is("BPL")) Branch((s.P & FLAG_NEGATIVE) == 0);
+    else if (Is("BMI")) Branch((s.P & FLAG_NEGATIVE) != 0);
+    else if (Is("BVC")) Branch((s.P & FLAG_OVERFLOW) == 0);
+    else if (Is("BVS")) Branch((s.P & FLAG_OVERFLOW) != 0);
+    else if (Is("BCC")) Branch((s.P & FLAG_CARRY) == 0);
+    else if (Is("BCS")) Branch((s.P & FLAG_CARRY) != 0);
+    else if (Is("BNE")) Branch((s.P & FLAG_ZERO) == 0);
+    else if (Is("BEQ")) Branch((s.P & FLAG_ZERO) != 0);
+    else if (Is("JMP")) s.PC = address;
+    else if (Is("JSR"))
+    {
+        uint16_t returnAddress = s.PC - 1;
+        Push(returnAddress >> 8);
+        Push(returnAddress & 0xFF);
+        s.PC = address;
+    }
+    else if (Is("RTS"))
+    {
+        uint16_t low = Pull();
+        s.PC = ((uint16_t(Pull()) << 8) | low) + 1;
+    }
+    else if (Is("RTI"))
+    {
+        s.P = (Pull() & ~FLAG_BREAK) | FLAG_CONSTANT;
+        uint16_t low = Pull();
+        s.PC = (uint16_t(Pull()) << 8) | low;
+    }
+    else if (Is("BRK"))
+    {
+        uint16_t returnAddress = s.PC + 1;
+        Push(returnAddress >> 8);
+        Push(returnAddress & 0xFF);
+        Push(s.P | FLAG_BREAK | FLAG_CONSTANT);
+        SetFlag(FLAG_INTERRUPT, true);
+        s.PC = m.Read(IRQ_VECTOR_LOW) | (uint16_t(m.Read(IRQ_VECTOR_HIGH)) << 8);
+    }
+    else if (Is("NOP")) {}
+    // Unofficial opcodes
+    else if (Is("SLO")) { SetFlag(FLAG_CARRY, (value & 0x80) != 0); value <<= 1; m.Write(address, value); s.A |= value; SetZN(s.A); }
+    else if (Is("RLA")) { SetFlag(FLAG_CARRY, (value & 0x80) != 0); value = (value << 1) | (carry ? 1 : 0); m.Write(address, value); s.A &= value; SetZN(s.A); }
+    else if (Is("SRE")) { SetFlag(FLAG_CARRY, (value & 0x01) != 0); value >>= 1; m.Write(address, value); s.A ^= value; SetZN(s.A); }
+    else if (Is("RRA")) { SetFlag(FLAG_CARRY, (value & 0x01) != 0); value = (value >> 1) | (carry ? 0x80 : 0); m.Write(address, value); Add(value); }
+    else if (Is("SAX")) m.Write(address, s.A & s.X);
+    else if (Is("LAX")) { s.A = value; s.X = value; SetZN(s.A); }
+    else if (Is("DCP")) { --value; m.Write(address, value); Compare(s.A, value); }
+    else if (Is("ISC")) { ++value; m.Write(address, value); Add(~value); }
+    else if (Is("ANC")) { s.A &= value; SetZN(s.A); SetFlag(FLAG_CARRY, (s.A & 0x80) != 0); }
+    else if (Is("ALR")) { s.A &= value; SetFlag(FLAG_CARRY, (s.A & 0x01) != 0); s.A >>= 1; SetZN(s.A); }
+    else if (Is("ARR"))
+    {
+        s.A = ((s.A & value) >> 1) | (carry ? 0x80 : 0);
+        SetZN(s.A);
+        SetFlag(FLAG_CARRY, (s.A & 0x40) != 0);
+        SetFlag(FLAG_OVERFLOW, (((s.A >> 6) ^ (s.A >> 5)) & 0x01) != 0);
+    }
+    else if (Is("AXS")) { SetFlag(FLAG_CARRY, (s.A & s.X) >= value); s.X = (s.A & s.X) - value; SetZN(s.X); }
+    else if (Is("LAS")) { s.SP &= value; s.A = s.SP; s.X = s.SP; SetZN(s.A); }
+    else if (Is("XAA")) { s.A = (s.A | XAA_MAGIC) & s.X & value; SetZN(s.A); }
+    else if (Is("AXA")) StoreHigh(base, s.A & s.X);
+    else if (Is("SHX")) StoreHigh(base, s.X);
+    else if (Is("SHY")) StoreHigh(base, s.Y);
+    else if (Is("TAS")) { s.SP = s.A & s.X; StoreHigh(base, s.SP); }
+    if (result >= 0)
+    {
+        if (mode == ACC)
+        {
+            s.A = uint8_t(result);
+        }
+        else
+        {
+            m.Write(address, uint8_t(result));
+        }
+    }
+}
+
+/*
+ * Test
+ */
+uint32_t failures = 0;
+uint32_t cases = 0;
+
+// Write the instruction and the pointers of its address mode
+void SetupMemory(FlatMemory &memory, uint8_t opcode, uint8_t value, uint8_t X, bool pageCross)
+{
+    memory.Reset(value);
+    GoldenMode mode = goldenModes[opcode];
+    // The indirect JMP reads its pointer across a page boundary when the low byte is $FF
+    uint16_t operand = ((mode == IND) && pageCross) ? (ABSOLUTE_OPERAND | 0xFF) : ABSOLUTE_OPERAND;
+    memory.Preset(PROGRAM_ADDRESS, opcode);
+    if ((mode == IMM) || (mode == REL))
+    {
+        memory.Preset(PROGRAM_ADDRESS + 1, value);
+    }
+    else if ((mode == ZP) || (mode == ZPX) || (mode == ZPY) || (mode == IZX) || (mode == IZY))
+    {
+        memory.Preset(PROGRAM_ADDRESS + 1, ZERO_PAGE_OPERAND);
+    }
+    else
+    {
+        memory.Preset(PROGRAM_ADDRESS + 1, operand & 0xFF);
+        memory.Preset(PROGRAM_ADDRESS + 2, operand >> 8);
+    }
+    uint8_t pointer = (mode == IZX) ? uint8_t(ZERO_PAGE_OPERAND + X) : ZERO_PAGE_OPERAND;
+    if ((mode == IZX) || (mode == IZY))
+    {
+        memory.Preset(pointer, ABSOLUTE_OPERAND & 0xFF);
+        memory.Preset(uint8_t(pointer + 1), ABSOLUTE_OPERAND >> 8);
+    }
+}
+
+void ReportFailure(uint8_t opcode, const State &start, uint8_t value, const State &cpu, const State &golden,
+                   const FlatMemory &cpuMemory, const FlatMemory &goldenMemory)
+{
+    if (++failures > MAX_REPORTED_FAILURES)
+    {
+        return;
+    }
+    LOGI("FAIL: $%02X %s, A:%02X X:%02X Y:%02X P:%02X M:%02X", opcode, goldenNames[opcode], start.A, start.X, start.Y, start.P, value);
+    LOGI("    CPU:    A:%02X X:%02X Y:%02X P:%02X SP:%02X PC:%04X CYC:%d writes:%d", cpu.A, cpu.X, cpu.Y, cpu.P, cpu.SP, cpu.PC,
+         cpu.cycles, int(cpuMemory.writes.size()));
+    LOGI("    Golden: A:%02X X:%02X Y:%02X P:%02X SP:%02X PC:%04X CYC:%d writes:%d", golden.A, golden.X, golden.Y, golden.P, golden.SP,
+         golden.PC, golden.cycles, int(goldenMemory.writes.size()));
+    for (size_t i = 0; (i < cpuMemory.writes.size()) || (i < goldenMemory.writes.size()); ++i)
+    {
+        if (i < cpuMemory.writes.size())
+        {
+            LOGI("    CPU write $%04X = %02X", cpuMemory.writes[i].first, cpuMemory.writes[i].second);
+        }
+        if (i < goldenMemory.writes.size())
+        {
+            LOGI("    Golden write $%04X = %02X", goldenMemory.writes[i].first, goldenMemory.writes[i].second);
+        }
+    }
+}
+
+void TestOpcode(CPU *cpu, FlatMemory &cpuMemory, uint8_t opcode)
+{
+    FlatMemory goldenMemory;
+    for (uint8_t flags = 0; flags < 16; ++flags)
+    {
+        // N V Z C from the 4 bits of flags, I and the reserved bit set
+        uint8_t P = FLAG_CONSTANT | FLAG_INTERRUPT | ((flags & 0x0C) << 4) | ((flags & 0x02) ? FLAG_ZERO : 0) | (flags & 0x01);
+        for (size_t a = 0; a < sizeof(VALUES); ++a)
+        {
+            for (size_t v = 0; v < sizeof(VALUES); ++v)
+            {
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    State start = {VALUES[a], INDEXES[i][0], INDEXES[i][1], P, 0xFD, PROGRAM_ADDRESS, 0};
+                    uint8_t value = VALUES[v];
+                    SetupMemory(cpuMemory, opcode, value, start.X, i == 1);
+                    SetupMemory(goldenMemory, opcode, value, start.X, i == 1);
+                    cpu->A = start.A;
+                    cpu->X = start.X;
+                    cpu->Y = start.Y;
+                    cpu->SetStatus(start.P);
+                    cpu->SP = start.SP;
+                    cpu->PC = start.PC;
+                    cpu->cycles = 0;
+                    cpu->Step();
+                    State result = {cpu->A, cpu->X, cpu->Y, cpu->GetStatus(), cpu->SP, cpu->PC, uint32_t(cpu->cycles)};
+                    State golden = start;
+                    Golden(golden, goldenMemory).Step();
+                    ++cases;
+                    if (!(result == golden) || (cpuMemory.writes != goldenMemory.writes))
+                    {
+                        ReportFailure(opcode, start, value, result, golden, cpuMemory, goldenMemory);
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FlatMemory *memory = new FlatMemory();
+    memory->Reset(0);
+    CPU *cpu = new CPU(memory);
+    uint32_t opcodes = 0;
+    for (uint16_t opcode = 0; opcode < 256; ++opcode)
+    {
+        if (strcmp(goldenNames[opcode], "KIL") == 0)
+        {
+            continue;
+        }
+        TestOpcode(cpu, *memory, uint8_t(opcode));
+        ++opcodes;
+    }
+    SAFE_DEL(cpu);
+    SAFE_DEL(memory);
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d of %d cases", failures, cases);
+        return 1;
+    }
+    LOGI("PASSED: %d opcodes, %d cases", opcodes, cases);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#define private public
+#include "PPU.h"
+#include "Cartridge.h"
+#include "Platforms.h"
+#include "Mapper.h"
+#include "MemoryCPU.h"
+#include "MemoryPPU.h"
+#include "CPU.h"
+#include "InstructionTrace.h"
+
+/*
+ * Instruction trace round trip
+ * nestest runs with _TRACE_INSTRUCTIONS_, then the trace file is decoded and compared with nestest.log:
+ * - The address, the instruction bytes, the registers and the PPU position must be equal
+ * - The decoded operand must be a prefix of the logged one (nestest.log also prints the memory values, e.g. "STX $00 = 00")
+ *   The mnemonics aren't compared: some unofficial opcodes have other names in nestest.log (ISB for ISC...)
+ * Return 0 if every line matches
+ */
+
+#define NESTEST_FILE "../nestest/nestest.nes"
+#define LOG_FILE "../nestest/nestest.log"
+#define MAX_DIVERGENCES 5
+
+// Columns of nestest.log
+#define INSTRUCTION_COLUMN 16
+#define OPERAND_COLUMN 20
+#define REGISTERS_COLUMN 48
+
+std::string TrimRight(const std::string &text)
+{
+    size_t end = text.find_last_not_of(' ');
+    return (end == std::string::npos) ? std::string() : text.substr(0, end + 1);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> lines;
+    std::ifstream file(LOG_FILE);
+    std::string line;
+    while (getline(file, line))
+    {
+        // nestest.log has Windows line endings
+        if (!line.empty() && (line[line.size() - 1] == '\r'))
+        {
+            line.erase(line.size() - 1);
+        }
+        lines.push_back(line);
+    }
+    if (lines.empty())
+    {
+        LOGI("Can't open log file");
+        return 1;
+    }
+    // Run nestest with the trace enabled
+    Cartridge *cartridge = new Cartridge();
+    if (cartridge->LoadNESFile(NESTEST_FILE) == false)
+    {
+        LOGI("Invalid NES file");
+        return 1;
+    }
+    Mapper *mapper = Mapper::GetMapper(cartridge);
+    Memory *memoryPPU = new MemoryPPU();
+    memoryPPU->SetMapper(mapper);
+    PPU *ppu = new PPU(memoryPPU);
+    Memory *memoryCPU = new MemoryCPU();
+    memoryCPU->SetMapper(mapper);
+    memoryCPU->SetPPU(ppu);
+    CPU *cpu = new CPU(memoryCPU);
+    ppu->SetCPU(cpu);
+    cpu->PC = 0xC000;
+    cpu->SP = 0xFD;
+    ppu->scanline = 241;
+    ppu->cycles = 0;
+    for (size_t count = 0; count < lines.size(); ++count)
+    {
+        uint16_t ppuCycles = cpu->Step() * 3;
+        for (uint16_t i = 0; i < ppuCycles; ++i)
+        {
+            ppu->Step();
+        }
+    }
+    // Close the trace file
+    SAFE_DEL(cpu);
+    // Decode it
+    size_t size = 0;
+    const TraceHeader *header = InstructionTrace::Map(TRACE_FILE, size);
+    if (header == NULL)
+    {
+        LOGI("Can't load %s", TRACE_FILE);
+        return 1;
+    }
+    uint32_t divergences = 0;
+    uint64_t count = InstructionTrace::GetCount(header);
+    if (count != lines.size())
+    {
+        LOGI("Traced %llu instructions, expected %d", (unsigned long long)count, int(lines.size()));
+        ++divergences;
+    }
+    char decoded[128];
+    for (uint64_t index = 0; (index < count) && (index < lines.size()) && (divergences < MAX_DIVERGENCES); ++index)
+    {
+        InstructionTrace::Format(header, InstructionTrace::GetRecord(header, index), decoded);
+        const std::string &expected = lines[index];
+        std::string got = decoded;
+        std::string gotOperand = TrimRight(got.substr(OPERAND_COLUMN, REGISTERS_COLUMN - OPERAND_COLUMN));
+        // Unofficial opcodes are marked with a '*' just before the instruction in nestest.log
+        if ((got.compare(0, INSTRUCTION_COLUMN - 1, expected, 0, INSTRUCTION_COLUMN - 1) != 0) ||
+            (expected.compare(OPERAND_COLUMN, gotOperand.size(), gotOperand) != 0) ||
+            (got.compare(REGISTERS_COLUMN, std::string::npos, expected, REGISTERS_COLUMN, std::string::npos) != 0))
+        {
+            ++divergences;
+            LOGI("Divergence at line %d", int(index + 1));
+            LOGI("  Expected %s", expected.c_str());
+            LOGI("  Got      %s", decoded);
+        }
+    }
+    if (divergences > 0)
+    {
+        LOGI("FAILED: the decoded trace doesn't match %s", LOG_FILE);
+    }
+    else
+    {
+        LOGI("PASSED: %llu instructions traced and decoded", (unsigned long long)count);
+    }
+    InstructionTrace::Unmap(header, size);
+    SAFE_DEL(cartridge);
+    SAFE_DEL(mapper);
+    SAFE_DEL(memoryPPU);
+    SAFE_DEL(ppu);
+    SAFE_DEL(memoryCPU);
+    return (divergences > 0) ? 1 : 0;
+}
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <fstream>
+#include <vector>
+
+#define private public
+#define protected public
+
+#include "PPU.h"
+#include "Cartridge.h"
+#include "Platforms.h"
+#include "Mapper.h"
+#include "MapperRegistry.h"
+#include "MemoryCPU.h"
+#include "MemoryPPU.h"
+#include "CPU.h"
+#include "../../TestUtil.h"
+
+/*
+ * Headless test of the discrete logic mappers (CNROM, AxROM, Color Dreams, GxROM)
+ * There is no game for these mappers in the repository, so each test builds a NES file where every
+ * PRG/CHR bank is tagged with its number, switches the banks through the CPU bus and checks:
+ * - The bank numbers read back from CPU $8000/$C000 and PPU $0000
+ * - The hash of a frame rendered by the PPU with the selected CHR bank/nametable against a reference hash
+ */
+
+struct System
+{
+    Cartridge *cartridge;
+    Mapper *mapper;
+    Memory *memoryPPU;
+    PPU *ppu;
+    Memory *memoryCPU;
+    CPU *cpu;
+};
+
+// Tile 1 of CHR bank `bank` has a pattern that is different for each bank
+void FillTile(uint8_t *tile, uint8_t bank)
+{
+    for (uint8_t row = 0; row < 8; ++row)
+    {
+        tile[row] = ((bank + 1) * 0x11) ^ row; // low plane
+        tile[row + 8] = (bank * 0x37) ^ (row << 4); // high plane
+    }
+}
+
+bool WriteMapperFile(const char *fileName, uint8_t mapper, uint8_t numPRG, uint8_t numCHR)
+{
+    // Every PRG byte is $FF so the bus conflicts don't change the written bank number
+    std::vector<uint8_t> image = CreateNESImage(mapper, numPRG, numCHR, 0, 0xFF);
+    for (uint8_t bank = 0; bank < numPRG; ++bank)
+    {
+        GetPRGBank(image, bank)[0] = bank;
+    }
+    for (uint8_t bank = 0; bank < numCHR; ++bank)
+    {
+        uint8_t *chr = GetCHRBank(image, bank);
+        chr[0] = bank;
+        FillTile(&chr[16], bank);
+    }
+    return WriteNESFile(fileName, image);
+}
+
+bool CreateSystem(System &system, uint8_t mapper, uint8_t numPRG, uint8_t numCHR)
+{
+    char fileName[32];
+    sprintf(fileName, "mapper%d.nes", mapper);
+    if (!WriteMapperFile(fileName, mapper, numPRG, numCHR))
+    {
+        return false;
+    }
+    system.cartridge = new Cartridge();
+    bool isLoaded = system.cartridge->LoadNESFile(fileName);
+    remove(fileName);
+    if (!isLoaded)
+    {
+        return false;
+    }
+    system.mapper = Mapper::GetMapper(system.cartridge);
+    if (system.mapper == NULL)
+    {
+        return false;
+    }
+    system.memoryPPU = MapperRegistry::CreateMemoryPPU(mapper);
+    system.memoryPPU->SetMapper(system.mapper);
+    system.ppu = new PPU(system.memoryPPU);
+    system.memoryCPU = MapperRegistry::CreateMemoryCPU(mapper);
+    system.memoryCPU->SetMapper(system.mapper);
+    system.memoryCPU->SetPPU(system.ppu);
+    system.cpu = new CPU(system.memoryCPU);
+    system.ppu->SetCPU(system.cpu);
+    return true;
+}
+
+void DestroySystem(System &system)
+{
+    SAFE_DEL(system.cpu);
+    SAFE_DEL(system.memoryCPU);
+    SAFE_DEL(system.ppu);
+    SAFE_DEL(system.memoryPPU);
+    SAFE_DEL(system.mapper);
+    SAFE_DEL(system.cartridge);
+}
+
+void WriteVRAM(System &system, uint16_t address, uint8_t value)
+{
+    system.memoryCPU->Write(0x2006, address >> 8);
+    system.memoryCPU->Write(0x2006, address & 0xFF);
+    system.memoryCPU->Write(0x2007, value);
+}
+
+// Fill nametable $2000 with `tile`, set up the palette and enable the background
+void SetupScreen(System &system, uint8_t tile)
+{
+    system.memoryCPU->Write(0x2001, 0x00);
+    system.memoryCPU->Write(0x2006, 0x20);
+    system.memoryCPU->Write(0x2006, 0x00);
+    for (uint16_t i = 0; i < 0x3C0; ++i)
+    {
+        system.memoryCPU->Write(0x2007, tile);
+    }
+    for (uint16_t i = 0; i < 0x40; ++i)
+    {
+        system.memoryCPU->Write(0x2007, 0x00);
+    }
+    const uint8_t colors[4] = {0x0F, 0x16, 0x27, 0x18};
+    for (uint8_t i = 0; i < 4; ++i)
+    {
+        WriteVRAM(system, 0x3F00 + i, colors[i]);
+    }
+    system.memoryCPU->Write(0x2000, 0x00);
+    system.memoryCPU->Write(0x2005, 0x00);
+    system.memoryCPU->Write(0x2005, 0x00);
+    system.memoryCPU->Write(0x2001, 0x0A); // Show background, no clipping
+}
+
+// FNV-1a hash of the frame displayed after rendering 2 frames
+uint32_t RenderFrameHash(System &system)
+{
+    for (uint32_t i = 0; i < 341 * 262 * 2; ++i)
+    {
+        system.ppu->Step();
+    }
+    uint32_t hash = 2166136261u;
+    for (uint16_t y = 0; y < SCREEN_HEIGHT; ++y)
+    {
+        for (uint16_t x = 0; x < SCREEN_WIDTH; ++x)
+        {
+            hash = (hash ^ system.ppu->frontBuffer[y][x]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+// Reference hashes of the frame rendered with tile 1 of each CHR bank (FillTile)
+const uint32_t referenceHashes[4] = {0xFDCECBC5, 0xF11264C5, 0xBEC247C5, 0xBAD47DC5};
+
+void CheckFrame(System &system, const char *name, uint8_t chrBank)
+{
+    uint32_t hash = RenderFrameHash(system);
+    CHECK(hash == referenceHashes[chrBank], "%s: frame hash %08X with CHR bank %d, expected %08X",
+          name, hash, chrBank, referenceHashes[chrBank]);
+}
+
+void TestCNROM()
+{
+    System system;
+    if (!CreateSystem(system, 3, 2, 4))
+    {
+        CHECK(false, "CNROM: can't create system");
+        return;
+    }
+    CHECK(system.memoryCPU->Read(0x8000) == 0 && system.memoryCPU->Read(0xC000) == 1, "CNROM: PRG-ROM isn't fixed");
+    SetupScreen(system, 1);
+    for (uint8_t bank = 0; bank < 4; ++bank)
+    {
+        system.memoryCPU->Write(0x8001, bank);
+        CHECK(system.memoryPPU->Read(0x0000) == bank, "CNROM: CHR bank %d isn't selected", bank);
+        CheckFrame(system, "CNROM", bank);
+    }
+    // Bus conflict: the written value is ANDed with the PRG-ROM byte (bank number 0 at $8000)
+    system.memoryCPU->Write(0x8000, 3);
+    CHECK(system.memoryPPU->Read(0x0000) == 0, "CNROM: bus conflict isn't emulated");
+    DestroySystem(system);
+}
+
+void TestAxROM()
+{
+    System system;
+    if (!CreateSystem(system, 7, 8, 0))
+    {
+        CHECK(false, "AxROM: can't create system");
+        return;
+    }
+    for (uint8_t bank = 0; bank < 4; ++bank)
+    {
+        system.memoryCPU->Write(0x8001, bank);
+        CHECK(system.memoryCPU->Read(0x8000) == bank * 2 && system.memoryCPU->Read(0xC000) == bank * 2 + 1,
+              "AxROM: PRG bank %d isn't selected", bank);
+    }
+    // CHR-RAM: write the pattern of CHR bank 0 to tile 1
+    uint8_t tile[16];
+    FillTile(tile, 0);
+    for (uint8_t i = 0; i < 16; ++i)
+    {
+        WriteVRAM(system, 16 + i, tile[i]);
+    }
+    // Nametable page 1 is blank, page 0 is filled with tile 1
+    system.memoryCPU->Write(0x8001, 0x10);
+    SetupScreen(system, 0);
+    system.memoryCPU->Write(0x8001, 0x00);
+    WriteVRAM(system, 0x2000, 1);
+    system.memoryCPU->Write(0x2006, 0x2C);
+    system.memoryCPU->Write(0x2006, 0x00);
+    system.memoryCPU->Read(0x2007); // dummy read
+    CHECK(system.memoryCPU->Read(0x2007) == 1, "AxROM: $2C00 doesn't mirror $2000 in single-screen mode");
+    SetupScreen(system, 1);
+    CheckFrame(system, "AxROM page 0", 0);
+    system.memoryCPU->Write(0x8001, 0x10);
+    uint32_t hash = RenderFrameHash(system);
+    CHECK(hash != referenceHashes[0], "AxROM: nametable page 1 isn't selected");
+    DestroySystem(system);
+}
+
+void TestSwitch32(const char *name, uint8_t mapper, uint8_t prgShift, uint8_t chrShift)
+{
+    System system;
+    if (!CreateSystem(system, mapper, 8, 4))
+    {
+        CHECK(false, "%s: can't create system", name);
+        return;
+    }
+    SetupScreen(system, 1);
+    for (uint8_t bank = 0; bank < 4; ++bank)
+    {
+        uint8_t chrBank = 3 - bank;
+        system.memoryCPU->Write(0x8001, (bank << prgShift) | (chrBank << chrShift));
+        CHECK(system.memoryCPU->Read(0x8000) == bank * 2 && system.memoryCPU->Read(0xC000) == bank * 2 + 1,
+              "%s: PRG bank %d isn't selected", name, bank);
+        CHECK(system.memoryPPU->Read(0x0000) == chrBank, "%s: CHR bank %d isn't selected", name, chrBank);
+        CheckFrame(system, name, chrBank);
+    }
+    DestroySystem(system);
+}
+
+int main()
+{
+    TestCNROM();
+    TestAxROM();
+    TestSwitch32("Color Dreams", 11, 0, 4);
+    TestSwitch32("GxROM", 66, 4, 0);
+    if (failures > 0)
+    {
+        LOGI("%d check(s) failed", failures);
+        return 1;
+    }
+    LOGI("Done!");
+    return 0;
+}
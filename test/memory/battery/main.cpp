@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <vector>
+#include "Cartridge.h"
+#include "Platforms.h"
+#include "../../TestUtil.h"
+
+/*
+ * Battery-backed SRAM test (see BatteryRAM.h)
+ * - A new save file is created filled with zero. The bytes written to the SRAM are in the save file when the cartridge is
+ *   closed, and are read back when the same NES file is loaded again
+ * - When the save file can't be opened (here it is a directory), the cartridge falls back to a plain SRAM which still works
+ * Return 0 if every check passes
+ */
+
+#define TEST_NES_FILE "battery.nes"
+#define SAVE_FILE "battery.sav"
+#define SRAM_SIZE 0x2000
+
+// The value written at each SRAM address, different on every page
+uint8_t Pattern(uint16_t address)
+{
+    return uint8_t((address * 7) ^ (address >> 8));
+}
+
+void TestRoundTrip()
+{
+    remove(SAVE_FILE);
+    Cartridge *cartridge = new Cartridge();
+    CHECK(cartridge->LoadNESFile(TEST_NES_FILE), "Can't load %s", TEST_NES_FILE);
+    CHECK(cartridge->HasBattery(), "The battery flag of the header is lost");
+    CHECK(cartridge->IsSRAMFileBacked(), "The SRAM isn't backed by %s", SAVE_FILE);
+    bool isZero = true;
+    for (uint16_t address = 0; address < SRAM_SIZE; ++address)
+    {
+        isZero = isZero && (cartridge->ReadSRAM(address) == 0);
+        cartridge->WriteSRAM(address, Pattern(address));
+    }
+    CHECK(isZero, "The new save file isn't filled with zero");
+    SAFE_DEL(cartridge);
+    // Closing the cartridge writes the save file
+    std::ifstream is(SAVE_FILE, std::ifstream::binary);
+    std::vector<char> save(SRAM_SIZE, 0);
+    is.read(&save[0], SRAM_SIZE);
+    CHECK(is.gcount() == SRAM_SIZE, "%s has %d bytes, expected %d", SAVE_FILE, int(is.gcount()), SRAM_SIZE);
+    uint32_t mismatches = 0;
+    for (uint16_t address = 0; address < SRAM_SIZE; ++address)
+    {
+        mismatches += (uint8_t(save[address]) != Pattern(address)) ? 1 : 0;
+    }
+    CHECK(mismatches == 0, "%d bytes of %s don't match the SRAM", mismatches, SAVE_FILE);
+    // Loading the NES file again reads the save file
+    cartridge = new Cartridge();
+    CHECK(cartridge->LoadNESFile(TEST_NES_FILE), "Can't reload %s", TEST_NES_FILE);
+    mismatches = 0;
+    for (uint16_t address = 0; address < SRAM_SIZE; ++address)
+    {
+        mismatches += (cartridge->ReadSRAM(address) != Pattern(address)) ? 1 : 0;
+    }
+    CHECK(mismatches == 0, "%d bytes of the reloaded SRAM don't match", mismatches);
+    SAFE_DEL(cartridge);
+    remove(SAVE_FILE);
+}
+
+void TestFallback()
+{
+    // open(O_RDWR) fails on a directory, even for root
+    remove(SAVE_FILE);
+    mkdir(SAVE_FILE, 0755);
+    Cartridge *cartridge = new Cartridge();
+    CHECK(cartridge->LoadNESFile(TEST_NES_FILE), "Can't load %s without save file", TEST_NES_FILE);
+    CHECK(cartridge->HasBattery(), "The battery flag of the header is lost");
+    CHECK(!cartridge->IsSRAMFileBacked(), "The SRAM is backed by a directory");
+    bool isZero = true;
+    for (uint16_t address = 0; address < SRAM_SIZE; ++address)
+    {
+        isZero = isZero && (cartridge->ReadSRAM(address) == 0);
+        cartridge->WriteSRAM(address, Pattern(address));
+    }
+    CHECK(isZero, "The fallback SRAM isn't filled with zero");
+    uint32_t mismatches = 0;
+    for (uint16_t address = 0; address < SRAM_SIZE; ++address)
+    {
+        mismatches += (cartridge->ReadSRAM(address) != Pattern(address)) ? 1 : 0;
+    }
+    CHECK(mismatches == 0, "%d bytes of the fallback SRAM don't match", mismatches);
+    SAFE_DEL(cartridge);
+    rmdir(SAVE_FILE);
+}
+
+int main()
+{
+    // NROM with 1 PRG bank, 1 CHR bank and the battery flag
+    if (!WriteNESFile(TEST_NES_FILE, CreateNESImage(0, 1, 1, INES_BATTERY)))
+    {
+        LOGI("FAIL: Can't write %s", TEST_NES_FILE);
+        return 1;
+    }
+    TestRoundTrip();
+    TestFallback();
+    remove(TEST_NES_FILE);
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d check(s)", failures);
+        return 1;
+    }
+    LOGI("PASSED");
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#define private public
+#include "Console.h"
+#include "Platforms.h"
+
+/*
+ * Memory watch test on nestest, built with _WATCH_MEMORY_
+ * - WATCH_FILE is written with a break on the first write to $0300 (line BREAK_LINE of nestest.log) and a log watchpoint
+ * - The emulation must break right after that instruction, then resume until the end of the log
+ * - The execute heatmap must count every PC exactly as many times as nestest.log
+ * Return 0 if everything matches
+ */
+
+#define NESTEST_FILE "../../cpu/nestest/nestest.nes"
+#define LOG_FILE "../../cpu/nestest/nestest.log"
+#define BREAK_ADDRESS 0x0300
+#define BREAK_LINE 1081
+#define BREAK_VALUE 0x5B
+
+int main(int argc, char **argv)
+{
+    std::vector<uint16_t> pcs;
+    std::ifstream file(LOG_FILE);
+    std::string line;
+    while (getline(file, line))
+    {
+        unsigned int PC;
+        if (sscanf(line.c_str(), "%x", &PC) == 1)
+        {
+            pcs.push_back(PC);
+        }
+    }
+    if (pcs.empty())
+    {
+        LOGI("Can't open log file");
+        return 1;
+    }
+    std::ofstream watchFile(WATCH_FILE);
+    watchFile << "# Watchpoints of the memory watch test" << std::endl;
+    watchFile << "cpu w 0300 break" << std::endl;
+    watchFile << "cpu x C000 log" << std::endl;
+    watchFile.close();
+
+    Console *console = new Console();
+    if (console->LoadNESFile(NESTEST_FILE) == false)
+    {
+        return 1;
+    }
+    // Start state of nestest.log (automated mode)
+    console->cpu->PC = 0xC000;
+    console->cpu->SP = 0xFD;
+    console->ppu->scanline = 241;
+    console->ppu->cycles = 0;
+
+    uint32_t failures = 0;
+    uint32_t breakLine = 0;
+    for (uint32_t count = 1; count <= pcs.size(); ++count)
+    {
+        console->Step();
+        if (console->IsBreakRequested())
+        {
+            if (breakLine == 0)
+            {
+                breakLine = count;
+            }
+            console->Resume();
+        }
+    }
+    if (breakLine != BREAK_LINE)
+    {
+        LOGI("Break at line %d, expected %d", breakLine, BREAK_LINE);
+        ++failures;
+    }
+    MemoryWatch &cpuWatch = console->memoryCPU->GetWatch();
+    std::map<uint16_t, uint32_t> executes;
+    for (size_t i = 0; i < pcs.size(); ++i)
+    {
+        ++executes[pcs[i]];
+    }
+    for (std::map<uint16_t, uint32_t>::iterator it = executes.begin(); it != executes.end(); ++it)
+    {
+        if (cpuWatch.GetCount(WatchExecute, it->first) != it->second)
+        {
+            LOGI("$%04X executed %d times, expected %d", it->first, cpuWatch.GetCount(WatchExecute, it->first), it->second);
+            if (++failures >= 5)
+            {
+                break;
+            }
+        }
+    }
+    if (cpuWatch.GetCount(WatchWrite, BREAK_ADDRESS) == 0)
+    {
+        LOGI("No write counted at $%04X", BREAK_ADDRESS);
+        ++failures;
+    }
+    if (console->memoryPPU->GetWatch().size != 0x4000)
+    {
+        LOGI("The PPU heatmap must have 16K addresses");
+        ++failures;
+    }
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d check(s)", failures);
+    }
+    else
+    {
+        LOGI("PASSED: break at line %d, %d addresses executed", breakLine, int(executes.size()));
+    }
+    SAFE_DEL(console);
+    return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+#define private public
+#define protected public
+#include "Console.h"
+#include "PPU.h"
+#include "Platforms.h"
+#include "MemoryCPU.h"
+#include "CPU.h"
+
+/*
+ * PPU thread test, built with _PARALLEL_PPU_ and _JIT_ (see PPUPipeline.h). The idle loops are skipped as in the default build, so
+ * the JIT and the idle loop skipping run with the PPU behind the CPU
+ * - The bundled games run for GAME_FRAMES frames with the Start button pressed once. The hash of the last frame, the RAM,
+ *   the CPU registers and the cycle count must be equal to the hash of the single thread build (see test/cpu/jit)
+ * - The sprite 0 hit ROMs poll $2002 in timed loops, so they must give the same results as test/ppu/sprite0hit
+ * Return 0 if everything matches
+ */
+
+#define GAME_FRAMES 600
+#define START_FRAME 200
+#define SPRITE0_DIR "../sprite0hit/"
+#define RESULT_ADDRESS 0x00F8
+#define RESULT_PASSED 1
+#define MAX_FRAMES 600
+
+struct Game
+{
+    const char *fileName;
+    uint32_t hash;
+};
+
+const Game games[] =
+{
+    {"../../../rom/Mario.nes", 0x3865DE09},
+    {"../../../rom/Contra.nes", 0x6EFD8B43},
+};
+
+struct TestROM
+{
+    const char *fileName;
+    uint8_t expectedResult;
+};
+
+static const TestROM testROMs[] =
+{
+    {"01.basics.nes", RESULT_PASSED},
+    {"02.alignment.nes", RESULT_PASSED},
+    {"03.corners.nes", RESULT_PASSED},
+    {"04.flip.nes", RESULT_PASSED},
+    {"05.left_clip.nes", 2},
+    {"06.right_edge.nes", 2},
+    {"07.screen_bottom.nes", RESULT_PASSED},
+    {"08.double_height.nes", RESULT_PASSED},
+    {"09.timing_basics.nes", 3},
+    {"10.timing_order.nes", RESULT_PASSED},
+    {"11.edge_timing.nes", 2},
+};
+
+#define NUM_TEST_ROMS (sizeof(testROMs) / sizeof(testROMs[0]))
+
+uint32_t failures = 0;
+
+void Hash(uint32_t &hash, const void *data, size_t size)
+{
+    // FNV-1a
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619;
+    }
+}
+
+void TestGame(const Game &game)
+{
+    Console *console = new Console();
+    if (!console->LoadNESFile(game.fileName))
+    {
+        LOGI("FAIL: Can't load %s", game.fileName);
+        ++failures;
+        return;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < GAME_FRAMES; ++frame)
+    {
+        console->GetController()->SetButton(ButtonStart, (frame >= START_FRAME) && (frame < START_FRAME + 5));
+        console->StepFrame();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    // Stop the PPU thread while the frame is read
+    console->pipeline->BeginAccess();
+    CPU *cpu = console->cpu;
+    uint32_t hash = 2166136261u;
+    Hash(hash, console->ppu->frontBuffer, SCREEN_WIDTH * SCREEN_HEIGHT);
+    Hash(hash, static_cast<MemoryCPU *>(console->memoryCPU)->GetRAM(), 0x800);
+    uint8_t registers[] = {cpu->A, cpu->X, cpu->Y, cpu->GetStatus(), cpu->SP, uint8_t(cpu->PC), uint8_t(cpu->PC >> 8)};
+    Hash(hash, registers, sizeof(registers));
+    Hash(hash, &cpu->cycles, sizeof(cpu->cycles));
+    console->pipeline->EndAccess();
+    LOGI("%s: hash %08X (%.0f ms)", game.fileName, hash, ms);
+    if (hash != game.hash)
+    {
+        LOGI("FAIL: %s hash %08X, expected %08X", game.fileName, hash, game.hash);
+        ++failures;
+    }
+    SAFE_DEL(console);
+}
+
+// The test ROMs end with "forever: jmp forever"
+bool IsInEndlessLoop(Console &console)
+{
+    uint16_t pc = console.cpu->PC;
+    return (console.memoryCPU->Read(pc) == 0x4C) && (console.memoryCPU->Read(pc + 1) == (pc & 0xFF)) &&
+           (console.memoryCPU->Read(pc + 2) == (pc >> 8));
+}
+
+void TestSprite0Hit(const TestROM &testROM)
+{
+    Console console;
+    std::string fileName = std::string(SPRITE0_DIR) + testROM.fileName;
+    if (!console.LoadNESFile(fileName))
+    {
+        LOGI("FAIL: Can't load %s", fileName.c_str());
+        ++failures;
+        return;
+    }
+    bool isFinished = false;
+    for (uint32_t frames = 0; (frames < MAX_FRAMES) && !isFinished; ++frames)
+    {
+        console.StepFrame();
+        isFinished = IsInEndlessLoop(console);
+    }
+    uint8_t result = console.memoryCPU->Read(RESULT_ADDRESS);
+    if (!isFinished || (result != testROM.expectedResult))
+    {
+        LOGI("FAIL: %s result %d, expected %d%s", testROM.fileName, result, testROM.expectedResult, isFinished ? "" : " (timeout)");
+        ++failures;
+    }
+}
+
+int main()
+{
+    for (size_t i = 0; i < sizeof(games) / sizeof(games[0]); ++i)
+    {
+        TestGame(games[i]);
+    }
+    for (uint32_t i = 0; i < NUM_TEST_ROMS; ++i)
+    {
+        TestSprite0Hit(testROMs[i]);
+    }
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d check(s)", failures);
+        return 1;
+    }
+    LOGI("PASSED");
+    return 0;
+}
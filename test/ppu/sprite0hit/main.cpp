@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+
+#define private public
+
+#include "Console.h"
+#include "Platforms.h"
+
+/*
+ * Headless runner of the sprite 0 hit test ROMs (see readme.txt)
+ * A test ROM writes the number of the running test to $F8, then 1 when all tests passed or the failure code (2, 3, ...)
+ * and finally loops forever on a JMP to itself. The runner steps frame by frame until the CPU is in that loop
+ * and reads the result code from $F8
+ * The ROMs are independent consoles so they run in parallel, one thread per core
+ * Some ROMs don't pass yet, their failure code is expected below. The runner fails if any result differs from
+ * the expected one, so a fix must update the table
+ */
+
+#define RESULT_ADDRESS 0x00F8
+#define RESULT_PASSED 1
+// The longest ROM finishes in ~70 frames
+#define MAX_FRAMES 600
+
+struct TestROM
+{
+    const char *fileName;
+    uint8_t expectedResult;
+};
+
+static const TestROM testROMs[] =
+{
+    {"01.basics.nes", RESULT_PASSED},
+    {"02.alignment.nes", RESULT_PASSED},
+    {"03.corners.nes", RESULT_PASSED},
+    {"04.flip.nes", RESULT_PASSED},
+    {"05.left_clip.nes", 2}, // Should miss when entirely in left-edge clipping
+    {"06.right_edge.nes", 2}, // Should always miss when X = 255
+    {"07.screen_bottom.nes", RESULT_PASSED},
+    {"08.double_height.nes", RESULT_PASSED},
+    {"09.timing_basics.nes", 3}, // Upper-left corner too late
+    {"10.timing_order.nes", RESULT_PASSED},
+    {"11.edge_timing.nes", 2}, // Hit time shouldn't be based on pixels under left clip
+};
+
+#define NUM_TEST_ROMS (sizeof(testROMs) / sizeof(testROMs[0]))
+
+struct TestResult
+{
+    bool isLoaded;
+    bool isFinished;
+    uint8_t result;
+    uint32_t frames;
+};
+
+// The test ROMs end with "forever: jmp forever"
+bool IsInEndlessLoop(Console &console)
+{
+    uint16_t pc = console.cpu->PC;
+    return (console.memoryCPU->Read(pc) == 0x4C) && (console.memoryCPU->Read(pc + 1) == (pc & 0xFF)) &&
+           (console.memoryCPU->Read(pc + 2) == (pc >> 8));
+}
+
+void RunTestROM(const TestROM &testROM, TestResult &testResult)
+{
+    testResult.isLoaded = false;
+    testResult.isFinished = false;
+    testResult.result = 0;
+    testResult.frames = 0;
+    Console console;
+    if (!console.LoadNESFile(testROM.fileName))
+    {
+        return;
+    }
+    testResult.isLoaded = true;
+    while ((testResult.frames < MAX_FRAMES) && !testResult.isFinished)
+    {
+        console.StepFrame();
+        ++testResult.frames;
+        testResult.isFinished = IsInEndlessLoop(console);
+    }
+    testResult.result = console.memoryCPU->Read(RESULT_ADDRESS);
+}
+
+int main()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    TestResult testResults[NUM_TEST_ROMS];
+    std::atomic<uint32_t> next(0);
+    uint32_t numThreads = std::max(1u, std::min(std::thread::hardware_concurrency(), uint32_t(NUM_TEST_ROMS)));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < numThreads; ++i)
+    {
+        threads.push_back(std::thread([&testResults, &next]()
+        {
+            for (uint32_t index = next++; index < NUM_TEST_ROMS; index = next++)
+            {
+                RunTestROM(testROMs[index], testResults[index]);
+            }
+        }));
+    }
+    for (uint32_t i = 0; i < numThreads; ++i)
+    {
+        threads[i].join();
+    }
+    // Report
+    uint32_t failures = 0;
+    LOGI("%-22s %-10s %-10s %s", "ROM", "Result", "Expected", "Frames");
+    for (uint32_t i = 0; i < NUM_TEST_ROMS; ++i)
+    {
+        const TestResult &testResult = testResults[i];
+        char result[16];
+        char expected[16];
+        if (!testResult.isLoaded)
+        {
+            strcpy(result, "NOT LOADED");
+        }
+        else if (!testResult.isFinished)
+        {
+            strcpy(result, "TIMEOUT");
+        }
+        else if (testResult.result == RESULT_PASSED)
+        {
+            strcpy(result, "PASSED");
+        }
+        else
+        {
+            sprintf(result, "FAILED #%d", testResult.result);
+        }
+        if (testROMs[i].expectedResult == RESULT_PASSED)
+        {
+            strcpy(expected, "PASSED");
+        }
+        else
+        {
+            sprintf(expected, "FAILED #%d", testROMs[i].expectedResult);
+        }
+        bool isExpected = testResult.isFinished && (testResult.result == testROMs[i].expectedResult);
+        if (!isExpected)
+        {
+            ++failures;
+        }
+        LOGI("%-22s %-10s %-10s %d%s", testROMs[i].fileName, result, expected, testResult.frames, isExpected ? "" : " <== UNEXPECTED");
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d unexpected result(s) (%.0f ms, %d threads)", failures, ms, numThreads);
+        return 1;
+    }
+    LOGI("PASSED: all results are expected (%.0f ms, %d threads)", ms, numThreads);
+    return 0;
+}
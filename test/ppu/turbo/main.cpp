@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#define private public
+#define protected public
+#include "Console.h"
+#include "PPU.h"
+#include "Platforms.h"
+#include "MemoryCPU.h"
+#include "CPU.h"
+
+/*
+ * Turbo mode test (see Console::SetTurbo)
+ * The bundled games run for GAME_FRAMES frames with the Start button pressed once, without and with the turbo mode
+ * - The game state (RAM, CPU registers, cycle count, PPU status) must be the same: the skipped frames still compute the
+ *   sprite 0 hit and overflow flags
+ * - GAME_FRAMES - 1 is a multiple of TURBO_RENDER_INTERVAL, so the last frame is output by both runs and must be the same
+ * - Only 1 frame out of TURBO_RENDER_INTERVAL is output
+ * Return 0 if everything matches
+ */
+
+#define GAME_FRAMES (75 * TURBO_RENDER_INTERVAL + 1)
+#define START_FRAME 200
+
+const char *games[] =
+{
+    "../../../rom/Mario.nes",
+    "../../../rom/Contra.nes",
+};
+
+uint32_t failures = 0;
+
+void Hash(uint32_t &hash, const void *data, size_t size)
+{
+    // FNV-1a
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619;
+    }
+}
+
+struct Result
+{
+    uint32_t stateHash;
+    uint32_t frameHash;
+    uint32_t renderedFrames;
+    double ms;
+};
+
+bool Run(const char *fileName, bool isTurbo, Result &result)
+{
+    Console *console = new Console();
+    if (!console->LoadNESFile(fileName))
+    {
+        LOGI("FAIL: Can't load %s", fileName);
+        ++failures;
+        SAFE_DEL(console);
+        return false;
+    }
+    console->SetTurbo(isTurbo);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < GAME_FRAMES; ++frame)
+    {
+        console->GetController()->SetButton(ButtonStart, (frame >= START_FRAME) && (frame < START_FRAME + 5));
+        console->StepFrame();
+    }
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    console->pipeline->BeginAccess();
+    CPU *cpu = console->cpu;
+    result.stateHash = 2166136261u;
+    Hash(result.stateHash, static_cast<MemoryCPU *>(console->memoryCPU)->GetRAM(), 0x800);
+    uint8_t registers[] = {cpu->A, cpu->X, cpu->Y, cpu->GetStatus(), cpu->SP, uint8_t(cpu->PC), uint8_t(cpu->PC >> 8),
+                           console->ppu->GetStatus()};
+    Hash(result.stateHash, registers, sizeof(registers));
+    Hash(result.stateHash, &cpu->cycles, sizeof(cpu->cycles));
+    result.frameHash = 2166136261u;
+    Hash(result.frameHash, console->ppu->frontBuffer, SCREEN_WIDTH * SCREEN_HEIGHT);
+    result.renderedFrames = console->ppu->GetRenderedFrameCount();
+    console->pipeline->EndAccess();
+    SAFE_DEL(console);
+    return true;
+}
+
+void TestGame(const char *fileName)
+{
+    Result normal;
+    Result turbo;
+    if (!Run(fileName, false, normal) || !Run(fileName, true, turbo))
+    {
+        return;
+    }
+    LOGI("%s: %d frames in %.0f ms, turbo %.0f ms (%.2fx), %d frames rendered", fileName, GAME_FRAMES, normal.ms, turbo.ms,
+         normal.ms / turbo.ms, turbo.renderedFrames);
+    if (turbo.stateHash != normal.stateHash)
+    {
+        LOGI("FAIL: %s state hash %08X, expected %08X", fileName, turbo.stateHash, normal.stateHash);
+        ++failures;
+    }
+    if (turbo.frameHash != normal.frameHash)
+    {
+        LOGI("FAIL: %s frame hash %08X, expected %08X", fileName, turbo.frameHash, normal.frameHash);
+        ++failures;
+    }
+    if ((normal.renderedFrames != GAME_FRAMES) || (turbo.renderedFrames != (GAME_FRAMES - 1) / TURBO_RENDER_INTERVAL + 1))
+    {
+        LOGI("FAIL: %s rendered %d and %d frames", fileName, normal.renderedFrames, turbo.renderedFrames);
+        ++failures;
+    }
+}
+
+int main()
+{
+    for (size_t i = 0; i < sizeof(games) / sizeof(games[0]); ++i)
+    {
+        TestGame(games[i]);
+    }
+    if (failures > 0)
+    {
+        LOGI("FAILED: %d check(s)", failures);
+        return 1;
+    }
+    LOGI("PASSED");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "InstructionTrace.h"
+
+/*
+ * Decode an instruction trace (see InstructionTrace.h) into nestest.log-style text on the standard output
+ * Usage: ./tracedecode [-n last instructions] [-c] trace.bin
+ * -n: only decode the last instructions of the trace
+ * -c: append the CPU cycle of every instruction
+ */
+
+int main(int argc, char **argv)
+{
+    uint64_t last = 0;
+    bool showCycles = false;
+    const char *fileName = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+        {
+            last = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+        {
+            showCycles = true;
+        }
+        else
+        {
+            fileName = argv[i];
+        }
+    }
+    if (fileName == NULL)
+    {
+        LOGI("Usage: %s [-n last instructions] [-c] trace.bin", argv[0]);
+        return 1;
+    }
+    size_t size = 0;
+    const TraceHeader *header = InstructionTrace::Map(fileName, size);
+    if (header == NULL)
+    {
+        LOGI("Invalid trace file %s", fileName);
+        return 1;
+    }
+    // The emulator may still be writing the file: decode the records written so far
+    uint64_t first = InstructionTrace::GetFirstRecord(header);
+    uint64_t count = InstructionTrace::GetCount(header);
+    if ((last > 0) && (count - first > last))
+    {
+        first = count - last;
+    }
+    char line[128];
+    for (uint64_t index = first; index < count; ++index)
+    {
+        const TraceRecord &record = InstructionTrace::GetRecord(header, index);
+        InstructionTrace::Format(header, record, line);
+        if (showCycles)
+        {
+            printf("%s CPU:%llu\n", line, (unsigned long long)record.cycle);
+        }
+        else
+        {
+            puts(line);
+        }
+    }
+    InstructionTrace::Unmap(header, size);
+    return 0;
+}